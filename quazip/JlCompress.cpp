@@ -24,82 +24,307 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "JlCompress.h"
+#include "quazipentryview.h"
+#include "quazipextractor.h"
+#include "private/quazipdirscanner.h"
+#include "private/quazipextractsink.h"
+#include "private/quazippipeline.h"
 #include <QDebug>
+#include <QFileDevice>
+#include <QHash>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+/// An entry to extract, found before extracting.
+struct JlCompressBatchEntry {
+    unz64_file_pos filePos;
+    /// Position of the local header in the archive file.
+    quint64 headerPos;
+    /// The local header and the data, guessed from the central header.
+    quint64 size;
+};
+
+/// Hints the kernel to read ahead the parts of the archive to extract.
+class JlCompressReadAhead {
+public:
+    /// Runs closer than this are read together.
+    static const quint64 MAX_GAP = 64 * 1024;
+    /// How far ahead of the extracted entry to ask for.
+    static const quint64 WINDOW = 32 * 1024 * 1024;
+
+    JlCompressReadAhead(QuaZip &zip);
+    /// Adds the next range, in the order of the positions.
+    void add(quint64 pos, quint64 size);
+    /// Asks for the ranges up to the window after \a pos.
+    void advance(quint64 pos);
+
+private:
+    struct Run {
+        quint64 pos;
+        quint64 end;
+    };
+
+    /// The archive opened again if QuaZip has opened it by name.
+    /**
+      The page cache is shared, so the hints work through any handle.
+    */
+    QFile file;
+    int fd;
+    QVector<Run> runs;
+    int nextRun;
+};
+
+JlCompressReadAhead::JlCompressReadAhead(QuaZip &zip)
+    : fd(-1)
+    , nextRun(0)
+{
+#ifdef Q_OS_LINUX
+    QFileDevice *device = qobject_cast<QFileDevice *>(zip.getIoDevice());
+    if (device != NULL) {
+        fd = device->handle();
+    } else if (!zip.getZipName().isEmpty()) {
+        file.setFileName(zip.getZipName());
+        if (file.open(QIODevice::ReadOnly))
+            fd = file.handle();
+    }
+#else
+    Q_UNUSED(zip);
+#endif
+}
+
+void JlCompressReadAhead::add(quint64 pos, quint64 size)
+{
+    if (fd < 0)
+        return;
+    if (!runs.isEmpty() && pos <= runs.last().end + MAX_GAP
+            && pos + size - runs.last().pos <= WINDOW) {
+        runs.last().end = qMax(runs.last().end, pos + size);
+        return;
+    }
+    Run run;
+    run.pos = pos;
+    run.end = pos + size;
+    runs.append(run);
+}
+
+void JlCompressReadAhead::advance(quint64 pos)
+{
+    while (nextRun < runs.size() && runs.at(nextRun).pos < pos + WINDOW) {
+#ifdef Q_OS_LINUX
+        const Run &run = runs.at(nextRun);
+        posix_fadvise(fd, off_t(run.pos), off_t(run.end - run.pos),
+                POSIX_FADV_WILLNEED);
+#endif
+        ++nextRun;
+    }
+}
+
+/// A piece of a file to compress.
+struct JlCompressSourceChunk {
+    int file;
+    QByteArray data;
+    /// The data ends the file, it may be empty.
+    bool last;
+    /// The file could not be read.
+    bool failed;
+    /// Size of the file, as listed or found when it was opened.
+    qint64 size;
+};
+
+typedef QuaZipBoundedQueue<JlCompressSourceChunk> JlCompressSourceQueue;
+
+/// Reads the files to compress ahead of the compression, in a thread.
+class JlCompressSourceReader {
+public:
+    /// Size of the reads.
+    static const int CHUNK_SIZE = 1024 * 1024;
+    /// Size of the data read ahead.
+    static const qint64 BUFFER_SIZE = 8 * 1024 * 1024;
+
+    JlCompressSourceReader(const QStringList &fileNames,
+                           const QList<QuaZipNewInfo> &infos,
+                           const QVector<qint64> &sizes,
+                           JlCompressSourceQueue &out);
+    /// Queues the data of the files, skipping the directories.
+    void run();
+
+private:
+    bool push(int file, const QByteArray &data, bool last, bool failed,
+              qint64 size = 0);
+    bool readFile(int index);
+
+    const QStringList &fileNames;
+    const QList<QuaZipNewInfo> &infos;
+    const QVector<qint64> &sizes;
+    JlCompressSourceQueue &out;
+};
+
+JlCompressSourceReader::JlCompressSourceReader(const QStringList &fileNames,
+                                               const QList<QuaZipNewInfo> &infos,
+                                               const QVector<qint64> &sizes,
+                                               JlCompressSourceQueue &out)
+    : fileNames(fileNames)
+    , infos(infos)
+    , sizes(sizes)
+    , out(out)
+{
+}
+
+void JlCompressSourceReader::run()
+{
+    for (int i = 0; i < fileNames.size(); ++i) {
+        if (infos.at(i).name.endsWith('/'))
+            continue;
+        if (!readFile(i))
+            return;
+    }
+}
+
+bool JlCompressSourceReader::push(int file, const QByteArray &data,
+                                  bool last, bool failed, qint64 size)
+{
+    JlCompressSourceChunk chunk;
+    chunk.file = file;
+    chunk.data = data;
+    chunk.last = last;
+    chunk.failed = failed;
+    chunk.size = size;
+    return out.push(chunk, data.size());
+}
 
-static bool copyData(QIODevice &inFile, QIODevice &outFile)
+bool JlCompressSourceReader::readFile(int index)
 {
-    while (true) {
-        char buf[8192];
-        qint64 readLen = inFile.read(buf, 8192);
-        if (readLen < 0)
+    QFile inFile(fileNames.at(index));
+    if (!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        push(index, QByteArray(), true, true);
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    posix_fadvise(inFile.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    // the open file is examined if the size was not listed
+    qint64 fileSize = index < sizes.size() ? sizes.at(index) : inFile.size();
+    forever {
+        QByteArray data(CHUNK_SIZE, Qt::Uninitialized);
+        qint64 size = inFile.read(data.data(), CHUNK_SIZE);
+        if (size < 0) {
+            push(index, QByteArray(), true, true);
             return false;
-        if (readLen == 0)
-            return true;
-        if (outFile.write(buf, readLen) != readLen)
+        }
+        data.resize(int(size));
+        bool last = size == 0 || inFile.atEnd();
+        if (!push(index, data, last, false, fileSize))
             return false;
+        if (last)
+            return true;
     }
-    return true;
 }
 
-bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest) {
+bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest,
+                              const QuaZipCompressionPolicy &policy) {
     // zip: oggetto dove aggiungere il file
     // fileName: nome del file reale
     // fileDest: nome del file all'interno del file compresso
+    return compressList(zip, QStringList(fileName),
+                        QList<QuaZipNewInfo>() << QuaZipNewInfo(fileDest, fileName),
+                        QVector<qint64>(), policy);
+}
 
-    // Controllo l'apertura dello zip
-    if (!zip) return false;
-    if (zip->getMode()!=QuaZip::mdCreate &&
-        zip->getMode()!=QuaZip::mdAppend &&
-        zip->getMode()!=QuaZip::mdAdd) return false;
-
-    // Apro il file originale
-    QFile inFile;
-    inFile.setFileName(fileName);
-    if(!inFile.open(QIODevice::ReadOnly)) return false;
+static bool compressSource(QuaZip* zip, int index, const QString &fileName,
+                           const QuaZipNewInfo &info,
+                           JlCompressSourceQueue &sources,
+                           const QuaZipCompressionPolicy &policy) {
+    // Apro il file originale, il primo pezzo dice se si e aperto
+    JlCompressSourceChunk chunk;
+    if (!sources.pop(&chunk) || chunk.file != index || chunk.failed)
+        return false;
 
     // Apro il file risulato
+    // the rules check the size listed and the first chunk, not the file
+    QuaZipCompressionPolicy::Settings settings =
+            policy.settingsFor(fileName, info.name, chunk.size, chunk.data);
     QuaZipFile outFile(zip);
-    if(!outFile.open(QIODevice::WriteOnly, QuaZipNewInfo(fileDest, inFile.fileName()))) return false;
+    outFile.setAutoStoreEnabled(policy.isAutoStoreEnabled());
+    if(!outFile.open(QIODevice::WriteOnly, info,
+                     NULL, 0, settings.method, settings.level, false,
+                     -MAX_WBITS, DEF_MEM_LEVEL, settings.strategy)) return false;
 
     // Copio i dati
-    if (!copyData(inFile, outFile) || outFile.getZipError()!=UNZ_OK) {
-        return false;
+    forever {
+        if (outFile.write(chunk.data) != chunk.data.size()
+            || outFile.getZipError()!=UNZ_OK) {
+            return false;
+        }
+        if (chunk.last)
+            break;
+        if (!sources.pop(&chunk) || chunk.file != index || chunk.failed)
+            return false;
     }
 
     // Chiudo i file
     outFile.close();
     if (outFile.getZipError()!=UNZ_OK) return false;
-    inFile.close();
 
     return true;
 }
 
-bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool recursive, QDir::Filters filters) {
-    // zip: oggetto dove aggiungere il file
-    // dir: cartella reale corrente
-    // origDir: cartella reale originale
-    // (path(dir)-path(origDir)) = path interno all'oggetto zip
-
+bool JlCompress::compressList(QuaZip* zip, const QStringList &fileNames,
+                              const QList<QuaZipNewInfo> &infos,
+                              const QVector<qint64> &sizes,
+                              const QuaZipCompressionPolicy &policy) {
     // Controllo l'apertura dello zip
     if (!zip) return false;
     if (zip->getMode()!=QuaZip::mdCreate &&
         zip->getMode()!=QuaZip::mdAppend &&
         zip->getMode()!=QuaZip::mdAdd) return false;
 
+    // the files are read in another thread while this one compresses
+    JlCompressSourceQueue sources(JlCompressSourceReader::BUFFER_SIZE);
+    JlCompressSourceReader reader(fileNames, infos, sizes, sources);
+    QuaZipPipelineStage readerStage([&reader]() { reader.run(); });
+    readerStage.start();
+    bool ok = true;
+    for (int i = 0; ok && i < fileNames.size(); ++i) {
+        const QString &fileName = fileNames.at(i);
+        const QuaZipNewInfo &info = infos.at(i);
+        if (info.name.endsWith('/')) {
+            QuaZipFile dirZipFile(zip);
+            ok = dirZipFile.open(QIODevice::WriteOnly, info, 0, 0, 0);
+            if (ok)
+                dirZipFile.close();
+            continue;
+        }
+        ok = compressSource(zip, i, fileName, info, sources, policy);
+    }
+    sources.abort();
+    readerStage.wait();
+    return ok;
+}
+
+bool JlCompress::collectSubDir(QString dir, QString origDir, bool recursive,
+                               QDir::Filters filters, const QString &zipName,
+                               QStringList *fileNames, QList<QuaZipNewInfo> *infos,
+                               QVector<qint64> *sizes) {
+    // dir: cartella reale corrente
+    // origDir: cartella reale originale
+    // (path(dir)-path(origDir)) = path interno all'oggetto zip
+
     // Controllo la cartella
     QDir directory(dir);
     if (!directory.exists()) return false;
 
     QDir origDirectory(origDir);
-	if (dir != origDir) {
-		QuaZipFile dirZipFile(zip);
-		if (!dirZipFile.open(QIODevice::WriteOnly,
-			QuaZipNewInfo(origDirectory.relativeFilePath(dir) + "/", dir), 0, 0, 0)) {
-				return false;
-		}
-		dirZipFile.close();
-	}
-
+    if (dir != origDir) {
+        fileNames->append(dir);
+        infos->append(QuaZipNewInfo(origDirectory.relativeFilePath(dir) + "/", dir));
+        sizes->append(0);
+    }
 
     // Se comprimo anche le sotto cartelle
     if (recursive) {
@@ -108,7 +333,8 @@ bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool
         for (int index = 0; index < files.size(); ++index ) {
             const QFileInfo & file( files.at( index ) );
             // Comprimo la sotto cartella
-            if(!compressSubDir(zip,file.absoluteFilePath(),origDir,recursive,filters)) return false;
+            if(!collectSubDir(file.absoluteFilePath(),origDir,recursive,filters,
+                              zipName,fileNames,infos,sizes)) return false;
         }
     }
 
@@ -117,83 +343,87 @@ bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool
     for (int index = 0; index < files.size(); ++index ) {
         const QFileInfo & file( files.at( index ) );
         // Se non e un file o e il file compresso che sto creando
-        if(!file.isFile()||file.absoluteFilePath()==zip->getZipName()) continue;
+        if(!file.isFile()||file.absoluteFilePath()==zipName) continue;
 
         // Creo il nome relativo da usare all'interno del file compresso
-        QString filename = origDirectory.relativeFilePath(file.absoluteFilePath());
-
-        // Comprimo il file
-        if (!compressFile(zip,file.absoluteFilePath(),filename)) return false;
+        fileNames->append(file.absoluteFilePath());
+        infos->append(QuaZipNewInfo(origDirectory.relativeFilePath(file.absoluteFilePath()),
+                                    file.absoluteFilePath()));
+        sizes->append(file.size());
     }
 
     return true;
 }
 
-bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
-    // zip: oggetto dove aggiungere il file
-    // filename: nome del file reale
-    // fileincompress: nome del file all'interno del file compresso
-
-    // Controllo l'apertura dello zip
-    if (!zip) return false;
-    if (zip->getMode()!=QuaZip::mdUnzip) return false;
-
+/// Extracts the current file of \a zip to \a fileDest through \a sink.
+/**
+  Sets the permissions and the modification time of the entry, like
+  QuaZipExtractor, and removes the file on failure.
+  */
+static bool extractCurrentFile(QuaZip* zip, const QString &fileDest,
+                               QuaZipExtractSink &sink) {
     // Apro il file compresso
-    if (!fileName.isEmpty())
-        zip->setCurrentFile(fileName);
     QuaZipFile inFile(zip);
-    if(!inFile.open(QIODevice::ReadOnly) || inFile.getZipError()!=UNZ_OK) return false;
-
-    // Controllo esistenza cartella file risultato
-    QDir curDir;
-    if (fileDest.endsWith('/')) {
-        if (!curDir.mkpath(fileDest)) {
-            return false;
-        }
-    } else {
-        if (!curDir.mkpath(QFileInfo(fileDest).absolutePath())) {
-            return false;
-        }
-    }
+    if(!inFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered)
+        || inFile.getZipError()!=UNZ_OK) return false;
 
     QuaZipFileInfo64 info;
     if (!zip->getCurrentFileInfo(&info))
         return false;
 
     QFile::Permissions srcPerm = info.getPermissions();
-    if (fileDest.endsWith('/') && QFileInfo(fileDest).isDir()) {
-        if (srcPerm != 0) {
-            QFile(fileDest).setPermissions(srcPerm);
-        }
-        return true;
-    }
+    if (fileDest.endsWith('/'))
+        return sink.makeDir(fileDest, srcPerm);
 
-    // Apro il file risultato
-    QFile outFile;
-    outFile.setFileName(fileDest);
-    if(!outFile.open(QIODevice::WriteOnly)) return false;
+    // Apro il file risultato, con la sua cartella
+    if (!sink.open(fileDest, info.uncompressedSize))
+        return false;
 
     // Copio i dati
-    if (!copyData(inFile, outFile) || inFile.getZipError()!=UNZ_OK) {
-        outFile.close();
-        removeFile(QStringList(fileDest));
-        return false;
+    QByteArray buffer(JlCompressSourceReader::CHUNK_SIZE, Qt::Uninitialized);
+    bool ok = true;
+    forever {
+        qint64 readLen = inFile.read(buffer.data(), buffer.size());
+        if (readLen <= 0) {
+            ok = readLen == 0;
+            break;
+        }
+        if (!sink.write(QByteArray::fromRawData(buffer.constData(),
+                                                int(readLen)))) {
+            ok = false;
+            break;
+        }
     }
-    outFile.close();
 
-    // Chiudo i file
+    // Chiudo i file, il CRC e controllato qui
     inFile.close();
-    if (inFile.getZipError()!=UNZ_OK) {
-        removeFile(QStringList(fileDest));
+    if (!ok || inFile.getZipError()!=UNZ_OK) {
+        sink.close(QFile::Permissions(), QDateTime());
+        QFile::remove(fileDest);
         return false;
     }
-
-    if (srcPerm != 0) {
-        outFile.setPermissions(srcPerm);
+    if (!sink.close(srcPerm, info.dateTime)) {
+        QFile::remove(fileDest);
+        return false;
     }
     return true;
 }
 
+bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
+    // zip: oggetto dove aggiungere il file
+    // filename: nome del file reale
+    // fileincompress: nome del file all'interno del file compresso
+
+    // Controllo l'apertura dello zip
+    if (!zip) return false;
+    if (zip->getMode()!=QuaZip::mdUnzip) return false;
+
+    if (!fileName.isEmpty())
+        zip->setCurrentFile(fileName);
+    QuaZipExtractSink sink;
+    return extractCurrentFile(zip, fileDest, sink);
+}
+
 bool JlCompress::removeFile(QStringList listFile) {
     bool ret = true;
     // Per ogni file
@@ -205,6 +435,11 @@ bool JlCompress::removeFile(QStringList listFile) {
 }
 
 bool JlCompress::compressFile(QString fileCompressed, QString file) {
+    return compressFile(fileCompressed, file, QuaZipCompressionPolicy());
+}
+
+bool JlCompress::compressFile(QString fileCompressed, QString file,
+                              const QuaZipCompressionPolicy &policy) {
     // Creo lo zip
     QuaZip zip(fileCompressed);
     QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
@@ -214,7 +449,7 @@ bool JlCompress::compressFile(QString fileCompressed, QString file) {
     }
 
     // Aggiungo il file
-    if (!compressFile(&zip,file,QFileInfo(file).fileName())) {
+    if (!compressFile(&zip,file,QFileInfo(file).fileName(),policy)) {
         QFile::remove(fileCompressed);
         return false;
     }
@@ -230,6 +465,11 @@ bool JlCompress::compressFile(QString fileCompressed, QString file) {
 }
 
 bool JlCompress::compressFiles(QString fileCompressed, QStringList files) {
+    return compressFiles(fileCompressed, files, QuaZipCompressionPolicy());
+}
+
+bool JlCompress::compressFiles(QString fileCompressed, QStringList files,
+                               const QuaZipCompressionPolicy &policy) {
     // Creo lo zip
     QuaZip zip(fileCompressed);
     QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
@@ -240,13 +480,21 @@ bool JlCompress::compressFiles(QString fileCompressed, QStringList files) {
 
     // Comprimo i file
     QFileInfo info;
+    QList<QuaZipNewInfo> infos;
+    QVector<qint64> sizes;
     for (int index = 0; index < files.size(); ++index ) {
         const QString & file( files.at( index ) );
         info.setFile(file);
-        if (!info.exists() || !compressFile(&zip,file,info.fileName())) {
+        if (!info.exists()) {
             QFile::remove(fileCompressed);
             return false;
         }
+        infos.append(QuaZipNewInfo(info.fileName(), file));
+        sizes.append(info.size());
+    }
+    if (!compressList(&zip,files,infos,sizes,policy)) {
+        QFile::remove(fileCompressed);
+        return false;
     }
 
     // Chiudo il file zip
@@ -265,6 +513,14 @@ bool JlCompress::compressDir(QString fileCompressed, QString dir, bool recursive
 
 bool JlCompress::compressDir(QString fileCompressed, QString dir,
                              bool recursive, QDir::Filters filters)
+{
+    return compressDir(fileCompressed, dir, recursive, filters,
+                       QuaZipCompressionPolicy());
+}
+
+bool JlCompress::compressDir(QString fileCompressed, QString dir,
+                             bool recursive, QDir::Filters filters,
+                             const QuaZipCompressionPolicy &policy)
 {
     // Creo lo zip
     QuaZip zip(fileCompressed);
@@ -275,7 +531,16 @@ bool JlCompress::compressDir(QString fileCompressed, QString dir,
     }
 
     // Aggiungo i file e le sotto cartelle
-    if (!compressSubDir(&zip,dir,dir,recursive, filters)) {
+    // one status call per entry, see QuaZipDirScanner
+    QStringList fileNames;
+    QList<QuaZipNewInfo> infos;
+    QVector<qint64> sizes;
+    bool listed = QuaZipDirScanner::supports(filters)
+        ? QuaZipDirScanner::scan(dir,recursive,filters,zip.getZipName(),
+                                 QThreadPool::globalInstance(),&fileNames,&infos,&sizes)
+        : collectSubDir(dir,dir,recursive,filters,zip.getZipName(),
+                        &fileNames,&infos,&sizes);
+    if (!listed || !compressList(&zip,fileNames,infos,sizes,policy)) {
         QFile::remove(fileCompressed);
         return false;
     }
@@ -330,16 +595,101 @@ QStringList JlCompress::extractFiles(QuaZip &zip, const QStringList &files, cons
         return QStringList();
     }
 
-    // Estraggo i file
-    QStringList extracted;
+    // Find all the files in one pass over the central directory,
+    // the first entry wins like in QuaZip::setCurrentFile()
+    bool caseSensitive = QuaZip::convertCaseSensitivity(QuaZip::csDefault)
+            == Qt::CaseSensitive;
+    QHash<QString, QVector<int> > wanted;
     for (int i=0; i<files.count(); i++) {
+        wanted[caseSensitive ? files.at(i) : files.at(i).toLower()].append(i);
+    }
+    QVector<JlCompressBatchEntry> entries(files.count());
+    bool ok = zip.forEachFile([&](const QuaZipEntryView &entry) {
+        QHash<QString, QVector<int> >::iterator it = wanted.find(
+                caseSensitive ? entry.name() : entry.name().toLower());
+        if (it == wanted.end())
+            return true;
+        JlCompressBatchEntry found;
+        found.filePos = entry.filePos();
+        found.headerPos = entry.headerPos();
+        // local header, name, extra field, data and data descriptor
+        found.size = 30 + entry.rawName().size() + entry.extra().size()
+                + entry.compressedSize() + 24;
+        foreach (int i, it.value()) {
+            entries[i] = found;
+        }
+        wanted.erase(it);
+        return !wanted.isEmpty();
+    });
+    if (!ok || !wanted.isEmpty())
+        return QStringList();
+
+    // Extract in the order of the data in the archive
+    QVector<int> order(files.count());
+    for (int i=0; i<order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&entries](int a, int b) {
+        return entries.at(a).headerPos < entries.at(b).headerPos;
+    });
+    JlCompressReadAhead readAhead(zip);
+    foreach (int i, order) {
+        readAhead.add(entries.at(i).headerPos, entries.at(i).size);
+    }
+    // one sink keeps the directories open across the files
+    QuaZipExtractSink sink;
+    QStringList extracted;
+    foreach (int i, order) {
+        readAhead.advance(entries.at(i).headerPos);
         QString absPath = QDir(dir).absoluteFilePath(files.at(i));
-        if (!extractFile(&zip, files.at(i), absPath)) {
+        if (!zip.goToFilePos(entries.at(i).filePos)
+                || !extractCurrentFile(&zip, absPath, sink)) {
             removeFile(extracted);
             return QStringList();
         }
         extracted.append(absPath);
     }
+    // Return the paths in the order of the files
+    extracted.clear();
+    for (int i=0; i<files.count(); i++) {
+        extracted.append(QDir(dir).absoluteFilePath(files.at(i)));
+    }
+
+    // Chiudo il file zip
+    zip.close();
+    if(zip.getZipError()!=0) {
+        removeFile(extracted);
+        return QStringList();
+    }
+
+    return extracted;
+}
+
+QStringList JlCompress::extractFiles(QString fileCompressed, const QuaZipNameFilter &filter, QString dir) {
+    QuaZip zip(fileCompressed);
+    return extractFiles(zip, filter, dir);
+}
+
+QStringList JlCompress::extractFiles(QuaZip &zip, const QuaZipNameFilter &filter, const QString &dir)
+{
+    if(!zip.open(QuaZip::mdUnzip)) {
+        return QStringList();
+    }
+    QDir directory(QDir::cleanPath(dir));
+    QString absCleanDir = directory.absolutePath();
+    QStringList extracted;
+    QuaZipExtractor extractor(&zip);
+    bool ok = zip.forEachFile(filter, [&](const QuaZipEntryView &entry) {
+        QString absFilePath = directory.absoluteFilePath(entry.name());
+        if (!QDir::cleanPath(absFilePath).startsWith(absCleanDir + "/"))
+            return true;
+        extractor.addFile(entry.filePos(), absFilePath);
+        extracted.append(absFilePath);
+        return true;
+    });
+    if (!ok || !extractor.extract()) {
+        return QStringList();
+    }
 
     // Chiudo il file zip
     zip.close();
@@ -366,21 +716,20 @@ QStringList JlCompress::extractDir(QuaZip &zip, const QString &dir)
     QDir directory(cleanDir);
     QString absCleanDir = directory.absolutePath();
     QStringList extracted;
-    if (!zip.goToFirstFile()) {
-        return QStringList();
-    }
-    do {
-        QString name = zip.getCurrentFileName();
-        QString absFilePath = directory.absoluteFilePath(name);
+    // read, inflate and write in parallel, see QuaZipExtractor
+    QuaZipExtractor extractor(&zip);
+    bool ok = zip.forEachFile([&](const QuaZipEntryView &entry) {
+        QString absFilePath = directory.absoluteFilePath(entry.name());
         QString absCleanPath = QDir::cleanPath(absFilePath);
         if (!absCleanPath.startsWith(absCleanDir + "/"))
-            continue;
-        if (!extractFile(&zip, "", absFilePath)) {
-            removeFile(extracted);
-            return QStringList();
-        }
+            return true;
+        extractor.addFile(entry.filePos(), absFilePath);
         extracted.append(absFilePath);
-    } while (zip.goToNextFile());
+        return true;
+    });
+    if (!ok || !extractor.extract()) {
+        return QStringList();
+    }
 
     // Chiudo il file zip
     zip.close();
@@ -407,14 +756,13 @@ QStringList JlCompress::getFileList(QuaZip *zip)
 
     // Estraggo i nomi dei file
     QStringList lst;
-    QuaZipFileInfo64 info;
-    for(bool more=zip->goToFirstFile(); more; more=zip->goToNextFile()) {
-      if(!zip->getCurrentFileInfo(&info)) {
-          delete zip;
-          return QStringList();
-      }
-      lst << info.name;
-      //info.name.toLocal8Bit().constData()
+    bool ok = zip->forEachFile([&lst](const QuaZipEntryView &entry) {
+        lst << entry.name();
+        return true;
+    });
+    if (!ok) {
+        delete zip;
+        return QStringList();
     }
 
     // Chiudo il file zip
@@ -439,6 +787,12 @@ QStringList JlCompress::getFileList(QIODevice *ioDevice)
     return getFileList(zip);
 }
 
+QStringList JlCompress::extractFiles(QIODevice *ioDevice, const QuaZipNameFilter &filter, QString dir)
+{
+    QuaZip zip(ioDevice);
+    return extractFiles(zip, filter, dir);
+}
+
 QString JlCompress::extractFile(QIODevice *ioDevice, QString fileName, QString fileDest)
 {
     QuaZip zip(ioDevice);
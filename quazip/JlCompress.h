@@ -29,10 +29,13 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "quazip.h"
 #include "quazipfile.h"
 #include "quazipfileinfo.h"
+#include "quazipcompressionpolicy.h"
+#include "quazipnamefilter.h"
 #include <QString>
 #include <QDir>
 #include <QFileInfo>
 #include <QFile>
+#include <QVector>
 
 /// Utility class for typical operations.
 /**
@@ -45,26 +48,54 @@ private:
     static QStringList getFileList(QuaZip *zip);
     static QString extractFile(QuaZip &zip, QString fileName, QString fileDest);
     static QStringList extractFiles(QuaZip &zip, const QStringList &files, const QString &dir);
+    static QStringList extractFiles(QuaZip &zip, const QuaZipNameFilter &filter, const QString &dir);
     /// Compress a single file.
     /**
       \param zip Opened zip to compress the file to.
       \param fileName The full path to the source file.
       \param fileDest The full name of the file inside the archive.
+      \param policy The compression settings.
       \return true if success, false otherwise.
       */
-    static bool compressFile(QuaZip* zip, QString fileName, QString fileDest);
-    /// Compress a subdirectory.
+    static bool compressFile(QuaZip* zip, QString fileName, QString fileDest,
+                             const QuaZipCompressionPolicy &policy);
+    /// Compress a list of files and directories.
+    /**
+      The files are read ahead in another thread with large reads, while
+      the calling thread compresses them through QuaZipFile, so reading
+      and compression overlap. The data read ahead is bounded.
+      \param zip Opened zip to compress the files to.
+      \param fileNames The full paths to the source files and directories.
+      \param infos The entries to write for them, the names of the
+      directories end with '/'.
+      \param sizes The sizes of the files, if known when listing them, or
+      empty. The policy uses them and the data read, so the files are not
+      examined again.
+      \param policy The compression settings.
+      \return true if success, false otherwise.
+      */
+    static bool compressList(QuaZip* zip, const QStringList &fileNames,
+                             const QList<QuaZipNewInfo> &infos,
+                             const QVector<qint64> &sizes,
+                             const QuaZipCompressionPolicy &policy);
+    /// Collect the contents of a subdirectory to compress.
     /**
-      \param parentZip Opened zip containing the parent directory.
       \param dir The full path to the directory to pack.
       \param parentDir The full path to the directory corresponding to
       the root of the ZIP.
       \param recursive Whether to pack sub-directories as well or only
       files.
+      \param zipName The archive being created, skipped if found.
+      \param fileNames Receives the full paths to the files and directories.
+      \param infos Receives the entries to write for them, see
+      compressList().
+      \param sizes Receives their sizes, 0 for the directories.
       \return true if success, false otherwise.
       */
-    static bool compressSubDir(QuaZip* parentZip, QString dir, QString parentDir, bool recursive,
-                               QDir::Filters filters);
+    static bool collectSubDir(QString dir, QString parentDir, bool recursive,
+                              QDir::Filters filters, const QString &zipName,
+                              QStringList *fileNames, QList<QuaZipNewInfo> *infos,
+                              QVector<qint64> *sizes);
     /// Extract a single file.
     /**
       \param zip The opened zip archive to extract from.
@@ -88,6 +119,15 @@ public:
       \return true if success, false otherwise.
       */
     static bool compressFile(QString fileCompressed, QString file);
+    /// Compress a single file with a compression policy.
+    /**
+      \param fileCompressed The name of the archive.
+      \param file The file to compress.
+      \param policy The compression settings.
+      \return true if success, false otherwise.
+      */
+    static bool compressFile(QString fileCompressed, QString file,
+                             const QuaZipCompressionPolicy &policy);
     /// Compress a list of files.
     /**
       \param fileCompressed The name of the archive.
@@ -95,6 +135,15 @@ public:
       \return true if success, false otherwise.
       */
     static bool compressFiles(QString fileCompressed, QStringList files);
+    /// Compress a list of files with a compression policy.
+    /**
+      \param fileCompressed The name of the archive.
+      \param files The file list to compress.
+      \param policy The compression settings of each file.
+      \return true if success, false otherwise.
+      */
+    static bool compressFiles(QString fileCompressed, QStringList files,
+                              const QuaZipCompressionPolicy &policy);
     /// Compress a whole directory.
     /**
       Does not compress hidden files. See compressDir(QString, QString, bool, QDir::Filters).
@@ -124,6 +173,23 @@ public:
      */
     static bool compressDir(QString fileCompressed, QString dir,
                             bool recursive, QDir::Filters filters);
+    /**
+     * @brief Compress a whole directory with a compression policy.
+     *
+     * Same as compressDir(QString, QString, bool, QDir::Filters), but
+     * the compression method, level and strategy of each file are chosen
+     * by @c policy.
+     *
+     * @param fileCompressed path to the resulting archive
+     * @param dir path to the directory being compressed
+     * @param recursive if true, then the subdirectories are packed as well
+     * @param filters what to pack
+     * @param policy the compression settings of each file
+     * @return true on success, false otherwise
+     */
+    static bool compressDir(QString fileCompressed, QString dir,
+                            bool recursive, QDir::Filters filters,
+                            const QuaZipCompressionPolicy &policy);
 
 public:
     /// Extract a single file.
@@ -137,6 +203,10 @@ public:
     static QString extractFile(QString fileCompressed, QString fileName, QString fileDest = QString());
     /// Extract a list of files.
     /**
+      The names are looked up in one pass over the central directory,
+      then the files are extracted in the order of their data in the
+      archive, so that the archive is read forward. The returned paths
+      are in the order of \a files.
       \param fileCompressed The name of the archive.
       \param files The file list to extract.
       \param dir The directory to put the files to, the current
@@ -144,6 +214,18 @@ public:
       \return The list of the full paths of the files extracted, empty on failure.
       */
     static QStringList extractFiles(QString fileCompressed, QStringList files, QString dir = QString());
+    /// Extract the files matching a filter.
+    /**
+      The archive is scanned once and the filter is checked on the raw
+      names, so only the matching names are decoded. Entries that would
+      be extracted outside of \a dir are skipped, like in extractDir().
+      \param fileCompressed The name of the archive.
+      \param filter The names to extract.
+      \param dir The directory to put the files to, the current
+      directory if left empty.
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractFiles(QString fileCompressed, const QuaZipNameFilter &filter, QString dir = QString());
     /// Extract a whole archive.
     /**
       \param fileCompressed The name of the archive.
@@ -170,6 +252,7 @@ public:
     static QString extractFile(QIODevice *ioDevice, QString fileName, QString fileDest = QString());
     /// Extract a list of files.
     /**
+      \sa extractFiles(QString, QStringList, QString)
       \param ioDevice pointer to device with compressed data.
       \param files The file list to extract.
       \param dir The directory to put the files to, the current
@@ -177,6 +260,16 @@ public:
       \return The list of the full paths of the files extracted, empty on failure.
       */
     static QStringList extractFiles(QIODevice *ioDevice, QStringList files, QString dir = QString());
+    /// Extract the files matching a filter.
+    /**
+      \param ioDevice pointer to device with compressed data.
+      \param filter The names to extract.
+      \param dir The directory to put the files to, the current
+      directory if left empty.
+      \return The list of the full paths of the files extracted, empty on failure.
+      \sa extractFiles(QString, const QuaZipNameFilter&, QString)
+      */
+    static QStringList extractFiles(QIODevice *ioDevice, const QuaZipNameFilter &filter, QString dir = QString());
     /// Extract a whole archive.
     /**
       \param ioDevice pointer to device with compressed data.
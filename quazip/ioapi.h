@@ -172,6 +172,22 @@ typedef struct zlib_filefunc64_def_s
 void fill_qiodevice64_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def));
 void fill_qiodevice_filefunc OF((zlib_filefunc_def* pzlib_filefunc_def));
 
+typedef voidpf   (ZCALLBACK *alloc_mem_func)      OF((voidpf opaque, size_t size));
+typedef void     (ZCALLBACK *free_mem_func)       OF((voidpf opaque, voidpf address));
+
+/* memory allocation functions, NULL functions mean malloc() and free() */
+typedef struct zlib_allocfunc_def_s
+{
+    alloc_mem_func      zalloc_mem;
+    free_mem_func       zfree_mem;
+    voidpf              opaque;
+} zlib_allocfunc_def;
+
+/* copies the functions used by default by the archives opened afterwards */
+void fill_default_allocfunc OF((zlib_allocfunc_def* pzlib_allocfunc_def));
+/* sets the default functions, NULL resets them to malloc() and free() */
+void set_default_allocfunc OF((const zlib_allocfunc_def* pzlib_allocfunc_def));
+
 /* now internal definition, only for zip.c and unzip.h */
 typedef struct zlib_filefunc64_32_def_s
 {
@@ -179,6 +195,7 @@ typedef struct zlib_filefunc64_32_def_s
     open_file_func      zopen32_file;
     tell_file_func      ztell32_file;
     seek_file_func      zseek32_file;
+    zlib_allocfunc_def  zalloc_mem;
 } zlib_filefunc64_32_def;
 
 
@@ -196,6 +213,14 @@ ZPOS64_T call_ztell64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf filestr
 
 void    fill_zlib_filefunc64_32_def_from_filefunc32(zlib_filefunc64_32_def* p_filefunc64_32,const zlib_filefunc_def* p_filefunc32);
 
+voidpf call_zalloc OF((const zlib_allocfunc_def* pallocfunc,size_t size));
+void   call_zfree OF((const zlib_allocfunc_def* pallocfunc,voidpf address));
+/* zlib alloc_func and free_func, opaque is zlib_allocfunc_def* */
+voidpf call_zlib_alloc OF((voidpf opaque,uInt items,uInt size));
+void   call_zlib_free OF((voidpf opaque,voidpf address));
+
+#define ZALLOC64(filefunc,size)                 (call_zalloc((&(filefunc).zalloc_mem),(size)))
+#define ZTRYFREE64(filefunc,p)                  {if (p) call_zfree((&(filefunc).zalloc_mem),(p));}
 #define ZOPEN64(filefunc,filename,mode)         (call_zopen64((&(filefunc)),(filename),(mode)))
 #define ZTELL64(filefunc,filestream)            (call_ztell64((&(filefunc)),(filestream)))
 #define ZSEEK64(filefunc,filestream,pos,mode)   (call_zseek64((&(filefunc)),(filestream),(pos),(mode)))
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "quazallocator.h"
+
+#include "ioapi.h"
+
+/// \cond internal
+struct QuaZAllocatorPrivate {
+    static voidpf ZCALLBACK allocMem(voidpf opaque, size_t size);
+    static void ZCALLBACK freeMem(voidpf opaque, voidpf address);
+    static voidpf zlibAlloc(voidpf opaque, uInt items, uInt size);
+    static void zlibFree(voidpf opaque, voidpf address);
+
+    /// Returns \a allocator, or the global allocator if it is nullptr
+    static QuaZAllocator *effective(QuaZAllocator *allocator);
+    /// Fills ZIP/UNZIP allocation functions for \a allocator
+    static void fillAllocFunc(
+        zlib_allocfunc_def *allocFunc, QuaZAllocator *allocator);
+    /// Sets zlib allocation functions for \a allocator
+    static void setupStream(z_stream &stream, QuaZAllocator *allocator);
+};
+/// \endcond
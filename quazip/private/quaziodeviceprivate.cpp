@@ -26,19 +26,37 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "quaziodeviceprivate.h"
 
 #include "quaziodevice.h"
+#include "quazallocatorprivate.h"
 
 QuaZIODevicePrivate::QuaZIODevicePrivate(QuaZIODevice *owner)
     : owner(owner)
     , io(nullptr)
+    , allocator(nullptr)
     , ioStartPosition(0)
     , ioPosition(0)
     , compressionLevel(Z_DEFAULT_COMPRESSION)
     , strategy(Z_DEFAULT_STRATEGY)
+    , windowBits(MAX_WBITS)
+    , memLevel(MAX_MEM_LEVEL)
+    , writeBufferThreshold(0)
+    , autoFlushMode(Z_NO_FLUSH)
+    , autoFlushInterval(0)
+    , autoFlushBytes(0)
+    , flushedInput(0)
+    , adaptiveMinLevel(Z_BEST_SPEED)
+    , adaptiveMaxLevel(Z_BEST_COMPRESSION)
+    , adaptiveInterval(QuaZIODevice::ADAPTIVE_INTERVAL)
+    , adaptiveMaxLoad(0.5)
+    , backpressureLimit(QuaZIODevice::ADAPTIVE_BACKPRESSURE_LIMIT)
+    , sampleInput(0)
+    , sampleDeflateTime(0)
     , uncompressedSize(0)
     , hasError(false)
     , atEnd(false)
     , hasUncompressedSize(false)
     , transaction(false)
+    , transactionalRead(true)
+    , adaptive(false)
 {
     memset(&zstream, 0, sizeof(zstream));
 }
@@ -152,6 +170,11 @@ qint64 QuaZIODevicePrivate::readCompressedData(Bytef *zbuffer, size_t size)
 {
     auto readResult = io->read(reinterpret_cast<char *>(zbuffer), qint64(size));
 
+    if (readResult == 0 && isBoundedSequentialRead()) {
+        // No more input yet, the rest will come with the next readyRead()
+        return 0;
+    }
+
     if (readResult <= 0) {
         setError(readResult < 0 ? io->errorString()
                                 : QStringLiteral("Unexpected end of file."));
@@ -160,6 +183,11 @@ qint64 QuaZIODevicePrivate::readCompressedData(Bytef *zbuffer, size_t size)
     return readResult;
 }
 
+bool QuaZIODevicePrivate::isBoundedSequentialRead() const
+{
+    return !transactionalRead && io && io->isSequential();
+}
+
 void QuaZIODevicePrivate::finishReadTransaction(qint64 savedPosition)
 {
     if (!transaction)
@@ -189,8 +217,8 @@ void QuaZIODevicePrivate::setCompressionLevel(int level)
 
     compressionLevel = level;
 
-    if (owner->isWritable()) {
-        check(deflateParams(&zstream, compressionLevel, strategy));
+    if (owner->isWritable() && flushPendingInput()) {
+        applyDeflateParams();
     }
 }
 
@@ -201,9 +229,91 @@ void QuaZIODevicePrivate::setStrategy(int value)
 
     strategy = value;
 
-    if (owner->isWritable()) {
-        check(deflateParams(&zstream, compressionLevel, strategy));
+    if (owner->isWritable() && flushPendingInput()) {
+        applyDeflateParams();
+    }
+}
+
+bool QuaZIODevicePrivate::applyDeflateParams()
+{
+    forever {
+        int result = deflateParams(&zstream, compressionLevel, strategy);
+        if (result != Z_BUF_ERROR || zstream.avail_out == sizeof(zbuffer))
+            return check(result);
+
+        // Not enough output space to finish the current block
+        if (!flushBuffer(int(sizeof(zbuffer) - zstream.avail_out)))
+            return false;
+    }
+}
+
+bool QuaZIODevicePrivate::adaptCompression()
+{
+    if (!adaptive || hasError)
+        return !hasError;
+
+    if (!sampleTimer.isValid()) {
+        startSample();
+        return true;
+    }
+
+    qint64 elapsed = sampleTimer.nsecsElapsed();
+    if (elapsed <= 0 || elapsed < qint64(adaptiveInterval) * 1000000)
+        return true;
+
+    qint64 input = qint64(zstream.total_in) + writeBuffer.size() - sampleInput;
+    auto &stats = adaptiveStats;
+    stats.inputRate = qint64(input * 1e9 / elapsed);
+    stats.compressionRate = sampleDeflateTime > 0
+        ? qint64(input * 1e9 / sampleDeflateTime)
+        : 0;
+    stats.load = qMin(qreal(sampleDeflateTime) / elapsed, qreal(1));
+    stats.bytesToWrite = io->bytesToWrite();
+    stats.samples++;
+    startSample();
+
+    int level = compressionLevel;
+    auto decision = QuaZIODevice::KeepLevel;
+    if (stats.load > adaptiveMaxLoad) {
+        if (level > adaptiveMinLevel) {
+            level--;
+            decision = QuaZIODevice::LowerLevelForLoad;
+        }
+    } else if (backpressureLimit > 0 &&
+        stats.bytesToWrite > backpressureLimit) {
+        if (level < adaptiveMaxLevel) {
+            level++;
+            decision = QuaZIODevice::RaiseLevelForBackpressure;
+        }
+    } else if (stats.load < adaptiveMaxLoad / 2) {
+        if (level < adaptiveMaxLevel) {
+            level++;
+            decision = QuaZIODevice::RaiseLevelForIdle;
+        }
     }
+    stats.decision = decision;
+
+    if (decision == QuaZIODevice::KeepLevel)
+        return true;
+
+    if (decision == QuaZIODevice::LowerLevelForLoad)
+        stats.lowered++;
+    else
+        stats.raised++;
+
+    setCompressionLevel(level);
+    if (hasError)
+        return false;
+
+    emit owner->compressionLevelAdapted(level, decision);
+    return true;
+}
+
+void QuaZIODevicePrivate::startSample()
+{
+    sampleInput = qint64(zstream.total_in) + writeBuffer.size();
+    sampleDeflateTime = 0;
+    sampleTimer.start();
 }
 
 qint64 QuaZIODevicePrivate::readInternal(char *data, qint64 maxlen)
@@ -243,7 +353,8 @@ qint64 QuaZIODevicePrivate::readInternal(char *data, qint64 maxlen)
                 if (transaction)
                     io->commitTransaction();
 
-                transaction = !io->isTransactionStarted() && io->isSequential();
+                transaction = transactionalRead && io->isSequential() &&
+                    !io->isTransactionStarted();
                 if (transaction) {
                     io->startTransaction();
                 }
@@ -270,8 +381,10 @@ qint64 QuaZIODevicePrivate::readInternal(char *data, qint64 maxlen)
             }
 
             if (code == Z_NEED_DICT) {
-                setError("External zlib dictionary is not supported.");
-                break;
+                if (!setInflateDictionary(quint32(zstream.adler)))
+                    break;
+
+                continue;
             }
 
             if (!check(code)) {
@@ -300,6 +413,7 @@ bool QuaZIODevicePrivate::initRead()
 
     zstream.next_in = zbuffer;
     zstream.avail_in = 0;
+    QuaZAllocatorPrivate::setupStream(zstream, allocator);
 
     return doInflateInit();
 }
@@ -316,11 +430,55 @@ qint64 QuaZIODevicePrivate::writeInternal(const char *data, qint64 maxlen)
     if (maxlen <= 0)
         return maxlen;
 
+    if (maxlen < writeBufferThreshold) {
+        writeBuffer.append(data, int(maxlen));
+        if (writeBuffer.size() >= writeBufferThreshold && !flushWriteBuffer())
+            return -1;
+    } else if (!flushWriteBuffer() || !deflateInput(data, maxlen)) {
+        return -1;
+    }
+
+    return adaptCompression() && autoFlush() ? maxlen : -1;
+}
+
+qint64 QuaZIODevicePrivate::writeFragments(const QByteArrayList &fragments)
+{
+    if (hasError || !seekInit()) {
+        return -1;
+    }
+
+    Q_ASSERT(io->isWritable());
+    Q_ASSERT(!io->isTextModeEnabled());
+
+    qint64 total = 0;
+    for (const auto &fragment : fragments) {
+        if (fragment.size() < writeBufferThreshold) {
+            writeBuffer.append(fragment);
+            if (writeBuffer.size() >= writeBufferThreshold &&
+                !flushWriteBuffer()) {
+                return -1;
+            }
+        } else if (!flushWriteBuffer() ||
+            !deflateInput(fragment.constData(), fragment.size())) {
+            return -1;
+        }
+
+        total += fragment.size();
+    }
+
+    return adaptCompression() && autoFlush() ? total : -1;
+}
+
+bool QuaZIODevicePrivate::deflateInput(const char *data, qint64 size)
+{
     using DataType = decltype(zstream.next_in);
     using BlockSize = decltype(zstream.avail_in);
 
-    qint64 count = maxlen;
+    qint64 count = size;
     auto blockSize = QuaZIODeviceUtils::maxBlockSize<BlockSize>();
+    QElapsedTimer deflateTimer;
+    if (adaptive)
+        deflateTimer.start();
 
     zstream.next_in = reinterpret_cast<DataType>(const_cast<char *>(data));
 
@@ -331,11 +489,11 @@ qint64 QuaZIODevicePrivate::writeInternal(const char *data, qint64 maxlen)
 
         while (zstream.avail_in > 0) {
             if (!check(deflate(&zstream, Z_NO_FLUSH))) {
-                return -1;
+                return false;
             }
             if (zstream.avail_out == 0) {
                 if (!flushBuffer()) {
-                    return -1;
+                    return false;
                 }
             }
         }
@@ -343,7 +501,76 @@ qint64 QuaZIODevicePrivate::writeInternal(const char *data, qint64 maxlen)
         count -= qint64(blockSize);
     }
 
-    return maxlen - count;
+    if (adaptive)
+        sampleDeflateTime += deflateTimer.nsecsElapsed();
+
+    return true;
+}
+
+bool QuaZIODevicePrivate::flushOutput(int mode)
+{
+    flushTimer.stop();
+
+    if (hasError || !seekInit() || !flushWriteBuffer())
+        return false;
+
+    zstream.next_in = Z_NULL;
+    zstream.avail_in = 0;
+    forever {
+        int result = deflate(&zstream, mode);
+        if (result != Z_BUF_ERROR && !check(result))
+            return false;
+
+        // Unused output space means deflate() has emitted everything
+        if (zstream.avail_out != 0)
+            break;
+
+        if (!flushBuffer())
+            return false;
+    }
+
+    flushedInput = qint64(zstream.total_in);
+    return flushBuffer(int(sizeof(zbuffer) - zstream.avail_out));
+}
+
+bool QuaZIODevicePrivate::autoFlush()
+{
+    if (autoFlushMode == Z_NO_FLUSH || hasError)
+        return !hasError;
+
+    if (autoFlushBytes > 0 && unflushedInput() >= autoFlushBytes)
+        return flushOutput(autoFlushMode);
+
+    if (autoFlushInterval > 0 && !flushTimer.isActive() &&
+        unflushedInput() > 0) {
+        flushTimer.start(autoFlushInterval, owner);
+    }
+
+    return true;
+}
+
+qint64 QuaZIODevicePrivate::unflushedInput() const
+{
+    return qint64(zstream.total_in) + writeBuffer.size() - flushedInput;
+}
+
+bool QuaZIODevicePrivate::flushPendingInput()
+{
+    if (writeBuffer.isEmpty())
+        return !hasError;
+
+    return seekInit() && flushWriteBuffer();
+}
+
+bool QuaZIODevicePrivate::flushWriteBuffer()
+{
+    if (writeBuffer.isEmpty())
+        return !hasError;
+
+    bool ok = !hasError &&
+        deflateInput(writeBuffer.constData(), writeBuffer.size());
+    writeBuffer.clear();
+    return ok;
 }
 
 bool QuaZIODevicePrivate::seekInit()
@@ -375,24 +602,105 @@ bool QuaZIODevicePrivate::initWrite()
 
     zstream.next_out = zbuffer;
     zstream.avail_out = sizeof(zbuffer);
+    writeBuffer.clear();
+    flushedInput = 0;
+    adaptiveStats = QuaZIODevice::AdaptiveCompressionStats();
+    sampleTimer.invalidate();
+    QuaZAllocatorPrivate::setupStream(zstream, allocator);
 
-    return doDeflateInit();
+    return doDeflateInit() && setDeflateDictionary();
+}
+
+bool QuaZIODevicePrivate::setDeflateDictionary()
+{
+    if (dictionary.isEmpty())
+        return true;
+
+    if (deflateSetDictionary(&zstream,
+            reinterpret_cast<const Bytef *>(dictionary.constData()),
+            uInt(dictionary.size())) != Z_OK) {
+        setError("Unable to set zlib dictionary.");
+        return false;
+    }
+
+    return true;
+}
+
+bool QuaZIODevicePrivate::setRawInflateDictionary()
+{
+    // Raw deflate stream has no header to request the dictionary
+    if (windowBits >= 0 || dictionary.isEmpty())
+        return true;
+
+    if (inflateSetDictionary(&zstream,
+            reinterpret_cast<const Bytef *>(dictionary.constData()),
+            uInt(dictionary.size())) != Z_OK) {
+        setError("Unable to set zlib dictionary.");
+        return false;
+    }
+
+    return true;
+}
+
+bool QuaZIODevicePrivate::setInflateDictionary(quint32 id)
+{
+    QByteArray bytes;
+    if (dictionaryResolver)
+        bytes = dictionaryResolver(id);
+
+    if (bytes.isEmpty())
+        bytes = dictionary;
+
+    if (bytes.isEmpty()) {
+        setError(QStringLiteral("Unknown zlib dictionary %1.")
+                     .arg(id, 8, 16, QLatin1Char('0')));
+        return false;
+    }
+
+    if (inflateSetDictionary(&zstream,
+            reinterpret_cast<const Bytef *>(bytes.constData()),
+            uInt(bytes.size())) != Z_OK) {
+        setError("zlib dictionary does not match.");
+        return false;
+    }
+
+    return true;
 }
 
 bool QuaZIODevicePrivate::doInflateInit()
 {
-    return check(inflateInit(&zstream));
+    return check(inflateInit2(&zstream, windowBits)) &&
+        setRawInflateDictionary();
 }
 
 bool QuaZIODevicePrivate::doInflateReset()
 {
-    return check(inflateReset(&zstream));
+    return check(inflateReset(&zstream)) && setRawInflateDictionary();
 }
 
 bool QuaZIODevicePrivate::doDeflateInit()
 {
-    return check(deflateInit2(&zstream, compressionLevel, Z_DEFLATED, MAX_WBITS,
-        MAX_MEM_LEVEL, strategy));
+    return check(deflateInit2(&zstream, compressionLevel, Z_DEFLATED,
+        windowBits, memLevel, strategy));
+}
+
+size_t QuaZIODevicePrivate::objectSize() const
+{
+    return sizeof(*this);
+}
+
+qint64 QuaZIODevicePrivate::memoryUsage() const
+{
+    qint64 result = qint64(objectSize()) + seekBuffer.capacity() +
+        writeBuffer.capacity() + dictionary.capacity();
+
+    if (owner->isWritable()) {
+        result += QuaZIODevice::deflateMemoryUsage(windowBits, memLevel);
+    } else if (owner->isReadable()) {
+        result += QuaZIODevice::inflateMemoryUsage(windowBits);
+    }
+
+    return result;
 }
 
 void QuaZIODevicePrivate::endRead()
@@ -412,9 +720,10 @@ void QuaZIODevicePrivate::endRead()
 void QuaZIODevicePrivate::endWrite()
 {
     Q_ASSERT(owner->isWritable());
-    zstream.next_in = Z_NULL;
-    zstream.avail_in = 0;
-    if (seekInit()) {
+    flushTimer.stop();
+    if (seekInit() && flushWriteBuffer()) {
+        zstream.next_in = Z_NULL;
+        zstream.avail_in = 0;
         while (!hasError) {
             int result = deflate(&zstream, Z_FINISH);
             if (result != Z_BUF_ERROR && !check(result))
@@ -435,6 +744,7 @@ void QuaZIODevicePrivate::endWrite()
     if (!hasError) {
         seekInit(); // HACK: ensure QFileDevice flushed
     }
+    writeBuffer.clear();
     check(deflateEnd(&zstream));
 }
 
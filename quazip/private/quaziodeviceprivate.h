@@ -25,13 +25,20 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #pragma once
 
+#include "quaziodevice.h"
 #include "quaziodevice_utils.h"
 
+#include <QBasicTimer>
 #include <QByteArray>
+#include <QByteArrayList>
+#include <QElapsedTimer>
 #include <zlib.h>
 
+#include <functional>
+
 class QIODevice;
 class QuaZIODevice;
+class QuaZAllocator;
 
 /// \cond internal
 enum
@@ -46,16 +53,39 @@ public:
 
     QuaZIODevice *owner;
     QIODevice *io;
+    QuaZAllocator *allocator;
     qint64 ioStartPosition;
     qint64 ioPosition;
     int compressionLevel;
     int strategy;
+    int windowBits;
+    int memLevel;
+    int writeBufferThreshold;
+    int autoFlushMode;
+    int autoFlushInterval;
+    qint64 autoFlushBytes;
+    qint64 flushedInput;
+    int adaptiveMinLevel;
+    int adaptiveMaxLevel;
+    int adaptiveInterval;
+    qreal adaptiveMaxLoad;
+    qint64 backpressureLimit;
+    qint64 sampleInput;
+    qint64 sampleDeflateTime;
     SizeType uncompressedSize;
     bool hasError : 1;
     bool atEnd : 1;
     bool hasUncompressedSize : 1;
     bool transaction : 1;
+    bool transactionalRead : 1;
+    bool adaptive : 1;
     QByteArray seekBuffer;
+    QByteArray writeBuffer;
+    QByteArray dictionary;
+    std::function<QByteArray(quint32)> dictionaryResolver;
+    QBasicTimer flushTimer;
+    QElapsedTimer sampleTimer;
+    QuaZIODevice::AdaptiveCompressionStats adaptiveStats;
     z_stream zstream;
     Byte zbuffer[QUAZIO_BUFFER_SIZE];
 
@@ -68,6 +98,7 @@ public:
     virtual bool doInflateInit();
     virtual bool doInflateReset();
     virtual bool doDeflateInit();
+    virtual size_t objectSize() const;
 
     bool flushBuffer(int size = QUAZIO_BUFFER_SIZE);
     bool seekInternal(qint64 newPos);
@@ -75,12 +106,27 @@ public:
     bool skipInput(qint64 skipCount);
     qint64 readInternal(char *data, qint64 maxlen);
     qint64 writeInternal(const char *data, qint64 maxlen);
+    qint64 writeFragments(const QByteArrayList &fragments);
+    bool deflateInput(const char *data, qint64 size);
+    bool flushWriteBuffer();
+    bool flushPendingInput();
+    bool flushOutput(int mode);
+    bool applyDeflateParams();
+    bool adaptCompression();
+    void startSample();
+    bool setDeflateDictionary();
+    bool setInflateDictionary(quint32 id);
+    bool setRawInflateDictionary();
+    qint64 memoryUsage() const;
+    bool autoFlush();
+    qint64 unflushedInput() const;
     bool seekInit();
     bool check(int code);
     void endRead();
     void endWrite();
     void setError(const QString &message);
     qint64 readCompressedData(Bytef *zbuffer, size_t size);
+    bool isBoundedSequentialRead() const;
     void finishReadTransaction(qint64 savedPosition);
     void setCompressionLevel(int level);
     void setStrategy(int value);
@@ -0,0 +1,124 @@
+#include "quazipdirindex.h"
+
+#include "quazip.h"
+
+bool QuaZipDirIndex::build(QuaZip *zip)
+{
+    nodes.clear();
+    Node root;
+    root.parent = -1;
+    root.isReal = false;
+    root.pos.pos_in_zip_directory = 0;
+    root.pos.num_of_file = 0;
+    nodes.append(root);
+
+    for (bool more = zip->goToFirstFile(); more; more = zip->goToNextFile()) {
+        QString name = zip->getCurrentFileName();
+        if (name.isEmpty()) {
+            if (zip->getZipError() != UNZ_OK)
+                return false;
+            continue;
+        }
+        unz64_file_pos pos;
+        if (!zip->getCurrentFilePos(&pos))
+            return false;
+        add(name, pos);
+    }
+
+    return zip->getZipError() == UNZ_OK;
+}
+
+bool QuaZipDirIndex::isDir(int index) const
+{
+    return index == ROOT || nodes.at(index).name.endsWith('/');
+}
+
+QString QuaZipDirIndex::path(int index) const
+{
+    QString result;
+    for (; index > ROOT; index = nodes.at(index).parent) {
+        result.prepend(nodes.at(index).name);
+    }
+    return result;
+}
+
+int QuaZipDirIndex::findDir(const QString &path, Qt::CaseSensitivity cs) const
+{
+    int index = ROOT;
+    if (path.isEmpty())
+        return index;
+
+    int start = 0;
+    forever {
+        int slash = path.indexOf('/', start);
+        int end = slash < 0 ? path.length() : slash;
+        index = findChild(index, path.mid(start, end - start) + '/', cs);
+        if (index < 0 || slash < 0)
+            return index;
+
+        start = slash + 1;
+    }
+}
+
+int QuaZipDirIndex::findChild(
+    int dir, const QString &name, Qt::CaseSensitivity cs) const
+{
+    const Node &parent = nodes.at(dir);
+    int index = parent.childByName.value(name, -1);
+    if (index >= 0 || cs == Qt::CaseSensitive)
+        return index;
+
+    for (int child : parent.children) {
+        if (nodes.at(child).name.compare(name, cs) == 0)
+            return child;
+    }
+
+    return -1;
+}
+
+void QuaZipDirIndex::add(const QString &name, const unz64_file_pos &pos)
+{
+    int index = ROOT;
+    int start = 0;
+    forever {
+        int slash = name.indexOf('/', start);
+        if (slash < 0) {
+            addChild(index, name.mid(start), true, pos);
+            return;
+        }
+
+        bool last = slash == name.length() - 1;
+        index = addChild(index, name.mid(start, slash - start + 1), last,
+                         pos);
+        if (last)
+            return;
+
+        start = slash + 1;
+    }
+}
+
+int QuaZipDirIndex::addChild(int parent, const QString &name, bool isReal,
+                             const unz64_file_pos &pos)
+{
+    int index = nodes.at(parent).childByName.value(name, -1);
+    // files with the same name are all listed, like in the archive
+    if (index >= 0 && name.endsWith('/')) {
+        if (isReal && !nodes.at(index).isReal) {
+            nodes[index].isReal = true;
+            nodes[index].pos = pos;
+        }
+        return index;
+    }
+
+    Node node;
+    node.name = name;
+    node.parent = parent;
+    node.isReal = isReal;
+    node.pos = pos;
+    index = nodes.size();
+    nodes.append(node);
+    nodes[parent].children.append(index);
+    if (!nodes.at(parent).childByName.contains(name))
+        nodes[parent].childByName.insert(name, index);
+    return index;
+}
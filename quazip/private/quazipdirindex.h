@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include "unzip.h"
+
+class QuaZip;
+
+/// \cond internal
+/// Tree of the directories and files of an archive, for QuaZipDir.
+/**
+  Built once by walking the central directory, then cached by QuaZip until
+  the archive is closed. Directories that only appear as a part of other
+  names are added as well.
+*/
+class QuaZipDirIndex {
+public:
+    struct Node {
+        /// The name in the parent, with a trailing '/' for directories.
+        QString name;
+        int parent;
+        /// Whether the archive has an entry for this node.
+        bool isReal;
+        /// Position of the entry, for QuaZip::goToFilePos() if real.
+        unz64_file_pos pos;
+        /// Children in the order of the archive.
+        QVector<int> children;
+        /// Children by name.
+        QHash<QString, int> childByName;
+    };
+
+    enum
+    {
+        ROOT = 0
+    };
+
+    /// Walks all the entries of \a zip, returns false on error.
+    bool build(QuaZip *zip);
+
+    const Node &node(int index) const { return nodes.at(index); }
+    bool isDir(int index) const;
+    /// Path of the node in the archive.
+    QString path(int index) const;
+    /// Finds a directory by its path without leading and trailing '/'.
+    /**
+      Returns -1 if there is no such directory.
+    */
+    int findDir(const QString &path, Qt::CaseSensitivity cs) const;
+    /// Finds a child of \a dir by name, with a trailing '/' for directories.
+    /**
+      Returns -1 if there is no such child.
+    */
+    int findChild(int dir, const QString &name, Qt::CaseSensitivity cs) const;
+
+private:
+    void add(const QString &name, const unz64_file_pos &pos);
+    int addChild(int parent, const QString &name, bool isReal,
+                 const unz64_file_pos &pos);
+
+    QVector<Node> nodes;
+};
+/// \endcond
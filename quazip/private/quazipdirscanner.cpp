@@ -0,0 +1,399 @@
+#include "quazipdirscanner.h"
+
+#include <QThreadPool>
+
+#ifdef Q_OS_LINUX
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+const int DENTS_BUFFER_SIZE = 64 * 1024;
+const QDir::Filters SCANNED_FILTERS = QDir::Hidden | QDir::System
+    | QDir::NoSymLinks | QDir::Dirs | QDir::AllDirs | QDir::Files
+    | QDir::NoDotAndDotDot | QDir::NoDot | QDir::NoDotDot;
+
+/// A file or a directory found.
+struct Item {
+    QString name;
+    qint64 size;
+    qint64 modified;
+    quint32 mode;
+    bool isSymLink;
+};
+
+/// An open directory, closed with the last reference.
+class DirHandle {
+public:
+    explicit DirHandle(int fd)
+        : fd(fd)
+    {
+    }
+
+    ~DirHandle()
+    {
+        ::close(fd);
+    }
+
+    const int fd;
+
+private:
+    Q_DISABLE_COPY(DirHandle)
+};
+
+struct Dir {
+    /// Name in the parent directory, the absolute path for the root.
+    QByteArray name;
+    /// The parent directory, kept open until this one is opened.
+    QSharedPointer<DirHandle> parent;
+    /// Name inside the archive, empty for the root.
+    QString dest;
+    /// The parent directory, nullptr for the root.
+    const Dir *up;
+    /// Identity of the directory, to find the loops made by links.
+    dev_t device;
+    ino_t inode;
+    Item self;
+    QVector<Item> files;
+    QVector<Dir *> subdirs;
+
+    Dir()
+        : up(nullptr)
+        , device(0)
+        , inode(0)
+    {
+    }
+
+    ~Dir()
+    {
+        qDeleteAll(subdirs);
+    }
+
+    /// Whether this directory or one of its parents is \a status.
+    bool isOnPath(const struct stat &status) const
+    {
+        for (const Dir *dir = this; dir; dir = dir->up) {
+            if (dir->device == status.st_dev && dir->inode == status.st_ino)
+                return true;
+        }
+        return false;
+    }
+};
+
+struct Options {
+    bool recursive;
+    bool hidden;
+    bool noSymLinks;
+};
+
+/// Same order as QDir::Name | QDir::IgnoreCase.
+bool lessByName(const QString &a, const QString &b)
+{
+    int result = a.compare(b, Qt::CaseInsensitive);
+    return result != 0 ? result < 0 : a < b;
+}
+
+QFile::Permissions permissionsFromMode(quint32 mode)
+{
+    QFile::Permissions result;
+    if (mode & S_IRUSR)
+        result |= QFile::ReadOwner;
+    if (mode & S_IWUSR)
+        result |= QFile::WriteOwner;
+    if (mode & S_IXUSR)
+        result |= QFile::ExeOwner;
+    if (mode & S_IRGRP)
+        result |= QFile::ReadGroup;
+    if (mode & S_IWGRP)
+        result |= QFile::WriteGroup;
+    if (mode & S_IXGRP)
+        result |= QFile::ExeGroup;
+    if (mode & S_IROTH)
+        result |= QFile::ReadOther;
+    if (mode & S_IWOTH)
+        result |= QFile::WriteOther;
+    if (mode & S_IXOTH)
+        result |= QFile::ExeOther;
+    return result;
+}
+
+/// Reads the entries of \a dir, returning the subdirectories to scan.
+bool scanDir(Dir *dir, const Options &options, QVector<Dir *> *subdirs)
+{
+    // subdirectories are opened relative to their parent, so that the
+    // kernel does not resolve the whole path again
+    const int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    int fd = dir->parent ? openat(dir->parent->fd, dir->name.constData(), flags)
+                         : open(dir->name.constData(), flags);
+    dir->parent.reset();
+    // like QDir, a subdirectory that can not be read is listed as empty
+    if (fd < 0)
+        return !dir->dest.isEmpty();
+
+    QSharedPointer<DirHandle> handle(new DirHandle(fd));
+    if (!dir->up) {
+        struct stat status;
+        if (fstat(fd, &status) != 0)
+            return false;
+        dir->device = status.st_dev;
+        dir->inode = status.st_ino;
+    }
+
+    QByteArray buffer(DENTS_BUFFER_SIZE, Qt::Uninitialized);
+    forever {
+        long size = syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+        if (size < 0)
+            return false;
+        if (size == 0)
+            break;
+
+        for (long pos = 0; pos < size;) {
+            auto entry = reinterpret_cast<const struct dirent64 *>(
+                buffer.constData() + pos);
+            pos += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (name[0] == '.'
+                && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            if (name[0] == '.' && !options.hidden)
+                continue;
+
+            // devices, pipes and sockets are neither files nor directories
+            unsigned char type = entry->d_type;
+            if (type != DT_REG && type != DT_DIR && type != DT_LNK
+                && type != DT_UNKNOWN) {
+                continue;
+            }
+
+            bool isSymLink = type == DT_LNK;
+            struct stat status;
+            if (type == DT_UNKNOWN) {
+                if (fstatat(fd, name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+                    continue;
+                isSymLink = S_ISLNK(status.st_mode);
+            }
+            if (isSymLink && options.noSymLinks)
+                continue;
+
+            // symbolic links are followed, broken ones are skipped
+            if ((isSymLink || type != DT_UNKNOWN)
+                && fstatat(fd, name, &status, 0) != 0) {
+                continue;
+            }
+
+            Item item;
+            item.name = QFile::decodeName(name);
+            item.size = qint64(status.st_size);
+            item.modified = qint64(status.st_mtim.tv_sec) * 1000
+                + status.st_mtim.tv_nsec / 1000000;
+            item.mode = quint32(status.st_mode);
+            item.isSymLink = isSymLink;
+            if (S_ISREG(status.st_mode)) {
+                dir->files.append(item);
+            } else if (S_ISDIR(status.st_mode) && options.recursive) {
+                // a link to a parent would be listed endlessly
+                if (dir->isOnPath(status))
+                    continue;
+                auto subdir = new Dir;
+                subdir->up = dir;
+                subdir->device = status.st_dev;
+                subdir->inode = status.st_ino;
+                subdir->name = name;
+                subdir->parent = handle;
+                subdir->dest = dir->dest + item.name + '/';
+                subdir->self = item;
+                dir->subdirs.append(subdir);
+            }
+        }
+    }
+
+    std::sort(dir->files.begin(), dir->files.end(),
+        [](const Item &a, const Item &b) { return lessByName(a.name, b.name); });
+    std::sort(dir->subdirs.begin(), dir->subdirs.end(),
+        [](const Dir *a, const Dir *b) {
+            return lessByName(a->self.name, b->self.name);
+        });
+    *subdirs = dir->subdirs;
+    return true;
+}
+
+/// Directories waiting to be scanned, shared by the scanning threads.
+class ScanJobs {
+public:
+    explicit ScanJobs(Dir *root)
+        : pending(1)
+        , failed(false)
+    {
+        queue.append(root);
+    }
+
+    /// Takes the next directory, false when all are scanned or on failure.
+    bool next(Dir **dir)
+    {
+        QMutexLocker locker(&mutex);
+        while (queue.isEmpty() && pending > 0 && !failed)
+            changed.wait(&mutex);
+        if (failed || queue.isEmpty())
+            return false;
+
+        *dir = queue.takeLast();
+        return true;
+    }
+
+    /// Adds the subdirectories of a directory scanned.
+    void finish(const QVector<Dir *> &subdirs, bool ok)
+    {
+        QMutexLocker locker(&mutex);
+        if (!ok)
+            failed = true;
+        queue += subdirs;
+        pending += subdirs.size() - 1;
+        changed.wakeAll();
+    }
+
+    bool isFailed() const
+    {
+        QMutexLocker locker(&mutex);
+        return failed;
+    }
+
+private:
+    mutable QMutex mutex;
+    QWaitCondition changed;
+    QVector<Dir *> queue;
+    int pending;
+    bool failed;
+};
+
+class ScanTask : public QRunnable {
+public:
+    ScanTask(ScanJobs &jobs, const Options &options, QSemaphore *done)
+        : jobs(jobs)
+        , options(options)
+        , done(done)
+    {
+    }
+
+    virtual void run() override
+    {
+        Dir *dir = nullptr;
+        while (jobs.next(&dir)) {
+            QVector<Dir *> subdirs;
+            bool ok = scanDir(dir, options, &subdirs);
+            jobs.finish(subdirs, ok);
+        }
+
+        if (done)
+            done->release();
+    }
+
+private:
+    ScanJobs &jobs;
+    Options options;
+    QSemaphore *done;
+};
+
+QuaZipNewInfo newInfo(const QString &dest, const Item &item, bool isDir)
+{
+    QuaZipNewInfo info(dest);
+    info.setFileStatus(QDateTime::fromMSecsSinceEpoch(item.modified),
+        permissionsFromMode(item.mode), isDir, item.isSymLink);
+    return info;
+}
+
+void appendDir(const Dir &dir, const QString &root, const QString &skipFile,
+    QStringList *fileNames, QList<QuaZipNewInfo> *infos,
+    QVector<qint64> *sizes)
+{
+    if (!dir.dest.isEmpty()) {
+        fileNames->append(root + '/' + dir.dest.left(dir.dest.size() - 1));
+        infos->append(newInfo(dir.dest, dir.self, true));
+        sizes->append(0);
+    }
+    for (const Dir *subdir : dir.subdirs) {
+        appendDir(*subdir, root, skipFile, fileNames, infos, sizes);
+    }
+    for (const Item &file : dir.files) {
+        QString dest = dir.dest + file.name;
+        QString fileName = root + '/' + dest;
+        if (fileName == skipFile)
+            continue;
+
+        fileNames->append(fileName);
+        infos->append(newInfo(dest, file, false));
+        sizes->append(file.size);
+    }
+}
+} // namespace
+
+bool QuaZipDirScanner::supports(QDir::Filters filters)
+{
+    return (filters & ~SCANNED_FILTERS) == 0;
+}
+
+bool QuaZipDirScanner::scan(const QString &dir, bool recursive,
+    QDir::Filters filters, const QString &skipFile, QThreadPool *pool,
+    QStringList *fileNames, QList<QuaZipNewInfo> *infos,
+    QVector<qint64> *sizes)
+{
+    QString root = QDir(dir).absolutePath();
+    Dir rootDir;
+    rootDir.name = QFile::encodeName(root);
+    Options options;
+    options.recursive = recursive;
+    options.hidden = filters & QDir::Hidden;
+    options.noSymLinks = filters & QDir::NoSymLinks;
+
+    // the calling thread scans too, idle threads of the pool help it
+    ScanJobs jobs(&rootDir);
+    QSemaphore done;
+    int helpers = 0;
+    if (pool && recursive) {
+        int wanted = pool->maxThreadCount() - 1;
+        for (; helpers < wanted; ++helpers) {
+            auto task = new ScanTask(jobs, options, &done);
+            if (!pool->tryStart(task)) {
+                delete task;
+                break;
+            }
+        }
+    }
+    ScanTask(jobs, options, nullptr).run();
+    done.acquire(helpers);
+    if (jobs.isFailed())
+        return false;
+
+    QString skip = skipFile.isEmpty()
+        ? QString()
+        : QFileInfo(skipFile).absoluteFilePath();
+    appendDir(rootDir, root == "/" ? QString() : root, skip, fileNames, infos,
+        sizes);
+    return true;
+}
+#else
+bool QuaZipDirScanner::supports(QDir::Filters)
+{
+    return false;
+}
+
+bool QuaZipDirScanner::scan(const QString &, bool, QDir::Filters,
+    const QString &, QThreadPool *, QStringList *, QList<QuaZipNewInfo> *,
+    QVector<qint64> *)
+{
+    return false;
+}
+#endif
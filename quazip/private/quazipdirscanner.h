@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QDir>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+#include "quazipnewinfo.h"
+
+class QThreadPool;
+
+/// \cond internal
+/// Lists a directory tree to compress with one status call per entry.
+/**
+  On Linux, the directories are read with getdents64() into large
+  buffers and their entries are examined with fstatat() relative to the
+  directory, in parallel across the subdirectories. Each subdirectory
+  is opened with openat() relative to its parent, which is kept open
+  until all of its subdirectories are. A link to a directory that is
+  already on the path being listed is skipped, so loops end. The status is then
+  used to fill QuaZipNewInfo, so the files are not examined again.
+
+  The result has the same entries in the same order as the QDir based
+  walk of JlCompress: each directory, then its subdirectories, then its
+  files, sorted by name ignoring case.
+*/
+class QuaZipDirScanner {
+public:
+    /// Whether scan() can be used for \a filters on this platform.
+    /**
+      Only QDir::Hidden, QDir::System and QDir::NoSymLinks change the
+      result, the other filters need QDir.
+    */
+    static bool supports(QDir::Filters filters);
+
+    /// Lists the contents of \a dir.
+    /**
+      \param dir The directory to pack, not included itself.
+      \param recursive Whether to list the subdirectories as well.
+      \param filters See supports().
+      \param skipFile A file not to list, the archive being created.
+      \param pool Threads helping the calling thread, nullptr for none.
+      \param fileNames Receives the full paths to the files and directories.
+      \param infos Receives their names inside the archive, the names of
+      the directories end with '/', with their times and permissions.
+      \param sizes Receives their sizes, 0 for the directories.
+      \return false if a directory can not be read.
+    */
+    static bool scan(const QString &dir, bool recursive,
+        QDir::Filters filters, const QString &skipFile, QThreadPool *pool,
+        QStringList *fileNames, QList<QuaZipNewInfo> *infos,
+        QVector<qint64> *sizes);
+};
+/// \endcond
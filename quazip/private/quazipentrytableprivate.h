@@ -0,0 +1,57 @@
+#pragma once
+
+#include "quazipentrytable.h"
+#include "unzip.h"
+
+#include <QSharedData>
+#include <QVector>
+
+class QTextCodec;
+
+/// \cond internal
+class QuaZipEntryTablePrivate : public QSharedData {
+public:
+    QuaZipEntryTablePrivate()
+        : openId(0)
+        , fileNameCodec(nullptr)
+        , commentCodec(nullptr)
+    {
+        nameOffsets.append(0);
+    }
+
+    /// Appends the current entry of \a file, returns an unzip error code.
+    int append(unzFile file, QByteArray &nameBuffer);
+    void reserve(int count);
+    void squeeze();
+    /// Reads the variable fields of an entry from the central directory.
+    /**
+      Fails unless \a zip is still open on the archive listed.
+    */
+    bool readVariable(QuaZip *zip, int index, QByteArray *extra,
+        QByteArray *comment) const;
+
+    /// QuaZip::getOpenId() of the archive listed.
+    int openId;
+    QTextCodec *fileNameCodec;
+    QTextCodec *commentCodec;
+
+    /// All names one after another.
+    QByteArray names;
+    /// Start of each name in names, plus the end of the last one.
+    QVector<int> nameOffsets;
+    QVector<quint64> compressedSizes;
+    QVector<quint64> uncompressedSizes;
+    QVector<quint32> crcs;
+    QVector<quint32> dosDates;
+    QVector<quint32> externalAttrs;
+    QVector<quint16> versionsCreated;
+    QVector<quint16> versionsNeeded;
+    QVector<quint16> flags;
+    QVector<quint16> methods;
+    QVector<quint16> internalAttrs;
+    QVector<quint16> extraSizes;
+    QVector<quint16> commentSizes;
+    /// Positions in the central directory.
+    QVector<unz64_file_pos> positions;
+};
+/// \endcond
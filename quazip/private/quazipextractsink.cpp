@@ -0,0 +1,252 @@
+#include "quazipextractsink.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+const int BLOCK_SIZE = 1024 * 1024;
+const size_t BLOCK_ALIGNMENT = 4096;
+/// Directories kept open, all are closed when there are more.
+const int MAX_OPEN_DIRS = 64;
+
+mode_t modeFromPermissions(QFile::Permissions permissions)
+{
+    mode_t mode = 0;
+    if (permissions & (QFile::ReadOwner | QFile::ReadUser))
+        mode |= S_IRUSR;
+    if (permissions & (QFile::WriteOwner | QFile::WriteUser))
+        mode |= S_IWUSR;
+    if (permissions & (QFile::ExeOwner | QFile::ExeUser))
+        mode |= S_IXUSR;
+    if (permissions & QFile::ReadGroup)
+        mode |= S_IRGRP;
+    if (permissions & QFile::WriteGroup)
+        mode |= S_IWGRP;
+    if (permissions & QFile::ExeGroup)
+        mode |= S_IXGRP;
+    if (permissions & QFile::ReadOther)
+        mode |= S_IROTH;
+    if (permissions & QFile::WriteOther)
+        mode |= S_IWOTH;
+    if (permissions & QFile::ExeOther)
+        mode |= S_IXOTH;
+    return mode;
+}
+
+bool writeAll(int fd, const char *data, qint64 size)
+{
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size_t(size));
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+} // namespace
+
+QuaZipExtractSink::QuaZipExtractSink()
+    : fd(-1)
+    , buffer(nullptr)
+    , buffered(0)
+{
+}
+
+QuaZipExtractSink::~QuaZipExtractSink()
+{
+    if (fd >= 0)
+        ::close(fd);
+    closeDirs();
+    free(buffer);
+}
+
+int QuaZipExtractSink::dirFd(const QString &path)
+{
+    auto it = dirs.constFind(path);
+    if (it != dirs.constEnd())
+        return it.value();
+
+    if (!QDir().mkpath(path))
+        return -1;
+
+    int result = ::open(QFile::encodeName(path).constData(),
+        O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (result < 0)
+        return -1;
+
+    if (dirs.size() >= MAX_OPEN_DIRS)
+        closeDirs();
+    dirs.insert(path, result);
+    return result;
+}
+
+void QuaZipExtractSink::closeDirs()
+{
+    for (int dirFd : dirs) {
+        ::close(dirFd);
+    }
+    dirs.clear();
+}
+
+bool QuaZipExtractSink::makeDir(
+    const QString &path, QFile::Permissions permissions)
+{
+    int result = dirFd(QDir(path).absolutePath());
+    if (result < 0)
+        return false;
+
+    if (permissions != 0)
+        fchmod(result, modeFromPermissions(permissions));
+    return true;
+}
+
+bool QuaZipExtractSink::open(const QString &path, quint64 size)
+{
+    if (!buffer) {
+        void *block = nullptr;
+        if (posix_memalign(&block, BLOCK_ALIGNMENT, BLOCK_SIZE) != 0)
+            return false;
+        buffer = static_cast<char *>(block);
+    }
+
+    QFileInfo info(path);
+    int parent = dirFd(info.absolutePath());
+    if (parent < 0)
+        return false;
+
+    QByteArray name = QFile::encodeName(info.fileName());
+    fd = openat(parent, name.constData(),
+        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return false;
+
+    // keeps the size, so a wrong size in the archive does not show
+    if (size > 0
+        && fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, off_t(size)) != 0
+        && errno == ENOSPC) {
+        ::close(fd);
+        fd = -1;
+        unlinkat(parent, name.constData(), 0);
+        return false;
+    }
+
+    buffered = 0;
+    return true;
+}
+
+bool QuaZipExtractSink::write(const QByteArray &data)
+{
+    const char *in = data.constData();
+    int left = data.size();
+    while (left > 0) {
+        // whole blocks bypass the buffer
+        if (buffered == 0 && left >= BLOCK_SIZE) {
+            int size = left - left % BLOCK_SIZE;
+            if (!writeAll(fd, in, size))
+                return false;
+            in += size;
+            left -= size;
+            continue;
+        }
+
+        int size = qMin(left, BLOCK_SIZE - buffered);
+        memcpy(buffer + buffered, in, size_t(size));
+        buffered += size;
+        in += size;
+        left -= size;
+        if (buffered == BLOCK_SIZE && !flush())
+            return false;
+    }
+    return true;
+}
+
+bool QuaZipExtractSink::flush()
+{
+    bool ok = writeAll(fd, buffer, buffered);
+    buffered = 0;
+    return ok;
+}
+
+bool QuaZipExtractSink::close(
+    QFile::Permissions permissions, const QDateTime &modified)
+{
+    bool ok = flush();
+    if (ok && permissions != 0)
+        fchmod(fd, modeFromPermissions(permissions));
+    if (ok && modified.isValid()) {
+        qint64 msecs = modified.toMSecsSinceEpoch();
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = time_t(msecs / 1000);
+        times[1].tv_nsec = long(msecs % 1000) * 1000000;
+        futimens(fd, times);
+    }
+    ok = ::close(fd) == 0 && ok;
+    fd = -1;
+    return ok;
+}
+#else
+QuaZipExtractSink::QuaZipExtractSink()
+{
+}
+
+QuaZipExtractSink::~QuaZipExtractSink()
+{
+}
+
+bool QuaZipExtractSink::makeDir(
+    const QString &path, QFile::Permissions permissions)
+{
+    if (!QDir().mkpath(path))
+        return false;
+
+    if (permissions != 0)
+        QFile(path).setPermissions(permissions);
+    return true;
+}
+
+bool QuaZipExtractSink::open(const QString &path, quint64 size)
+{
+    Q_UNUSED(size);
+    if (!QDir().mkpath(QFileInfo(path).absolutePath()))
+        return false;
+
+    file.setFileName(path);
+    return file.open(QIODevice::WriteOnly);
+}
+
+bool QuaZipExtractSink::write(const QByteArray &data)
+{
+    return file.write(data) == data.size();
+}
+
+bool QuaZipExtractSink::close(
+    QFile::Permissions permissions, const QDateTime &modified)
+{
+    bool ok = file.flush();
+#if QT_VERSION >= 0x050A00
+    if (ok && modified.isValid())
+        file.setFileTime(modified, QFileDevice::FileModificationTime);
+#else
+    Q_UNUSED(modified);
+#endif
+    file.close();
+    if (ok && permissions != 0)
+        file.setPermissions(permissions);
+    return ok;
+}
+#endif
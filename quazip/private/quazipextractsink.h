@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QString>
+
+/// \cond internal
+/// Creates the files and the directories extracted by QuaZipExtractor.
+/**
+  On Linux, the directories are created once and kept open, the files are
+  created with openat() relative to them, preallocated to their size and
+  written in large page aligned blocks, and their mode and time are set through the
+  open descriptor. Elsewhere QDir and QFile are used.
+
+  Only one file is open at a time.
+*/
+class QuaZipExtractSink {
+public:
+    QuaZipExtractSink();
+    ~QuaZipExtractSink();
+
+    /// Creates a directory with its parents, setting the permissions if
+    /// not 0.
+    bool makeDir(const QString &path, QFile::Permissions permissions);
+    /// Creates the file \a path, \a size bytes long, and its directory.
+    bool open(const QString &path, quint64 size);
+    /// Appends to the open file.
+    bool write(const QByteArray &data);
+    /// Closes the open file, setting the permissions if not 0 and the
+    /// modification time if valid.
+    bool close(QFile::Permissions permissions, const QDateTime &modified);
+
+private:
+    Q_DISABLE_COPY(QuaZipExtractSink)
+
+#ifdef Q_OS_LINUX
+    /// Descriptor of the directory, created if needed, or -1.
+    int dirFd(const QString &path);
+    void closeDirs();
+    bool flush();
+
+    QHash<QString, int> dirs;
+    int fd;
+    /// A block aligned to the page size, allocated on the first open().
+    char *buffer;
+    int buffered;
+#else
+    QFile file;
+#endif
+};
+/// \endcond
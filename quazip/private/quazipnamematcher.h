@@ -0,0 +1,33 @@
+#pragma once
+
+#include "quazipnamefilter.h"
+
+#include <QByteArray>
+#include <QVector>
+
+class QTextCodec;
+
+/// \cond internal
+/// QuaZipNameFilter prepared for the raw names of an archive.
+class QuaZipNameMatcher {
+public:
+    QuaZipNameMatcher(const QuaZipNameFilter &filter, QTextCodec *codec);
+
+    /// Checks a name as stored in the central directory.
+    bool matches(const char *name, int size) const;
+
+private:
+    struct ByteCondition {
+        bool isPrefix;
+        bool caseInsensitive;
+        QByteArray pattern;
+    };
+
+    QuaZipNameFilter filter;
+    QTextCodec *codec;
+    bool utf8;
+    QVector<ByteCondition> byteConditions;
+    /// Conditions of the filter checked on the decoded name.
+    QVector<int> decodedConditions;
+};
+/// \endcond
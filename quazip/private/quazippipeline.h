@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <functional>
+
+/// \cond internal
+/// Queue between the stages of a pipeline, bounded by the size of the items.
+/**
+  push() waits while the queue is full and pop() waits while it is empty.
+  An item bigger than the capacity is accepted when the queue is empty,
+  so any item gets through. After abort(), the waiting and the next calls
+  return false at once, which stops the stages on both sides.
+*/
+template<typename T>
+class QuaZipBoundedQueue {
+public:
+    explicit QuaZipBoundedQueue(qint64 capacity)
+        : capacity(capacity)
+        , size(0)
+        , closed(false)
+        , aborted(false)
+    {
+    }
+
+    /// Adds an item of \a itemSize bytes, false if the queue is aborted.
+    bool push(const T &value, qint64 itemSize)
+    {
+        QMutexLocker locker(&mutex);
+        while (!aborted && !items.isEmpty() && size + itemSize > capacity)
+            notFull.wait(&mutex);
+        if (aborted)
+            return false;
+
+        Item item;
+        item.value = value;
+        item.size = itemSize;
+        items.enqueue(item);
+        size += itemSize;
+        notEmpty.wakeOne();
+        return true;
+    }
+
+    /// Takes the next item.
+    /**
+      Returns false if the queue is aborted, or closed and empty.
+    */
+    bool pop(T *value)
+    {
+        QMutexLocker locker(&mutex);
+        while (!aborted && !closed && items.isEmpty())
+            notEmpty.wait(&mutex);
+        if (aborted || items.isEmpty())
+            return false;
+
+        Item item = items.dequeue();
+        size -= item.size;
+        *value = item.value;
+        notFull.wakeAll();
+        return true;
+    }
+
+    /// Tells the consumers that no more items come.
+    void close()
+    {
+        QMutexLocker locker(&mutex);
+        closed = true;
+        notEmpty.wakeAll();
+    }
+
+    /// Drops the items and wakes up both sides.
+    void abort()
+    {
+        QMutexLocker locker(&mutex);
+        aborted = true;
+        items.clear();
+        size = 0;
+        notEmpty.wakeAll();
+        notFull.wakeAll();
+    }
+
+    bool isAborted() const
+    {
+        QMutexLocker locker(&mutex);
+        return aborted;
+    }
+
+private:
+    struct Item {
+        T value;
+        qint64 size;
+    };
+
+    mutable QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QQueue<Item> items;
+    qint64 capacity;
+    qint64 size;
+    bool closed;
+    bool aborted;
+};
+
+/// Thread running one stage of a pipeline.
+class QuaZipPipelineStage : public QThread {
+public:
+    explicit QuaZipPipelineStage(std::function<void()> stage)
+        : stage(std::move(stage))
+    {
+    }
+
+protected:
+    virtual void run() override
+    {
+        stage();
+    }
+
+private:
+    std::function<void()> stage;
+};
+/// \endcond
@@ -75,6 +75,51 @@ ZPOS64_T call_ztell64 (const zlib_filefunc64_32_def* pfilefunc,voidpf filestream
     }
 }
 
+static zlib_allocfunc_def default_allocfunc = { NULL, NULL, NULL };
+
+void fill_default_allocfunc (zlib_allocfunc_def* pzlib_allocfunc_def)
+{
+    *pzlib_allocfunc_def = default_allocfunc;
+}
+
+void set_default_allocfunc (const zlib_allocfunc_def* pzlib_allocfunc_def)
+{
+    if (pzlib_allocfunc_def != NULL)
+        default_allocfunc = *pzlib_allocfunc_def;
+    else
+        memset(&default_allocfunc, 0, sizeof(default_allocfunc));
+}
+
+voidpf call_zalloc (const zlib_allocfunc_def* pallocfunc,size_t size)
+{
+    if (pallocfunc == NULL)
+        pallocfunc = &default_allocfunc;
+    if (pallocfunc->zalloc_mem != NULL)
+        return (*(pallocfunc->zalloc_mem))(pallocfunc->opaque,size);
+    else
+        return malloc(size);
+}
+
+void call_zfree (const zlib_allocfunc_def* pallocfunc,voidpf address)
+{
+    if (pallocfunc == NULL)
+        pallocfunc = &default_allocfunc;
+    if (pallocfunc->zfree_mem != NULL)
+        (*(pallocfunc->zfree_mem))(pallocfunc->opaque,address);
+    else
+        free(address);
+}
+
+voidpf call_zlib_alloc (voidpf opaque,uInt items,uInt size)
+{
+    return call_zalloc((const zlib_allocfunc_def*)opaque,(size_t)items*size);
+}
+
+void call_zlib_free (voidpf opaque,voidpf address)
+{
+    call_zfree((const zlib_allocfunc_def*)opaque,address);
+}
+
 /// @cond internal
 struct QIODevice_descriptor {
     // Position only used for writing to sequential devices.
@@ -360,4 +405,5 @@ void fill_zlib_filefunc64_32_def_from_filefunc32(zlib_filefunc64_32_def* p_filef
     p_filefunc64_32->zfile_func64.zfakeclose_file = NULL;
     p_filefunc64_32->zseek32_file = p_filefunc32->zseek_file;
     p_filefunc64_32->ztell32_file = p_filefunc32->ztell_file;
+    fill_default_allocfunc(&p_filefunc64_32->zalloc_mem);
 }
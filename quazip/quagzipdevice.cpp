@@ -50,6 +50,7 @@ public:
     virtual bool doInflateInit() override;
     virtual bool doInflateReset() override;
     virtual bool doDeflateInit() override;
+    virtual size_t objectSize() const override;
 
     bool gzInflateInit();
     bool gzDeflateInit();
@@ -246,7 +247,7 @@ bool QuaGzipDevicePrivate::doInflateInit()
 
 bool QuaGzipDevicePrivate::doInflateReset()
 {
-    return QuaZIODevicePrivate::doInflateReset() && gzReadHeader();
+    return check(inflateReset(&zstream)) && gzReadHeader();
 }
 
 bool QuaGzipDevicePrivate::doDeflateInit()
@@ -254,15 +255,20 @@ bool QuaGzipDevicePrivate::doDeflateInit()
     return gzDeflateInit() && gzSetHeader();
 }
 
+size_t QuaGzipDevicePrivate::objectSize() const
+{
+    return sizeof(*this);
+}
+
 bool QuaGzipDevicePrivate::gzInflateInit()
 {
-    return check(inflateInit2(&zstream, GZIP_FLAG));
+    return check(inflateInit2(&zstream, qAbs(windowBits) | GZIP_FLAG));
 }
 
 bool QuaGzipDevicePrivate::gzDeflateInit()
 {
     return check(deflateInit2(&zstream, compressionLevel, Z_DEFLATED,
-        MAX_WBITS | GZIP_FLAG, MAX_MEM_LEVEL, strategy));
+        qAbs(windowBits) | GZIP_FLAG, memLevel, strategy));
 }
 
 bool QuaGzipDevicePrivate::gzReadHeader()
@@ -0,0 +1,77 @@
+#include "quazallocator.h"
+
+#include "private/quazallocatorprivate.h"
+
+static QuaZAllocator *quazGlobalAllocator = nullptr;
+
+QuaZAllocator::~QuaZAllocator()
+{
+    // do nothing
+}
+
+QuaZAllocator *QuaZAllocator::globalAllocator()
+{
+    return quazGlobalAllocator;
+}
+
+void QuaZAllocator::setGlobalAllocator(QuaZAllocator *allocator)
+{
+    quazGlobalAllocator = allocator;
+
+    zlib_allocfunc_def allocFunc;
+    QuaZAllocatorPrivate::fillAllocFunc(&allocFunc, allocator);
+    set_default_allocfunc(&allocFunc);
+}
+
+voidpf QuaZAllocatorPrivate::allocMem(voidpf opaque, size_t size)
+{
+    return static_cast<QuaZAllocator *>(opaque)->allocate(size);
+}
+
+void QuaZAllocatorPrivate::freeMem(voidpf opaque, voidpf address)
+{
+    static_cast<QuaZAllocator *>(opaque)->deallocate(address);
+}
+
+voidpf QuaZAllocatorPrivate::zlibAlloc(voidpf opaque, uInt items, uInt size)
+{
+    return static_cast<QuaZAllocator *>(opaque)->allocate(size_t(items) * size);
+}
+
+void QuaZAllocatorPrivate::zlibFree(voidpf opaque, voidpf address)
+{
+    static_cast<QuaZAllocator *>(opaque)->deallocate(address);
+}
+
+QuaZAllocator *QuaZAllocatorPrivate::effective(QuaZAllocator *allocator)
+{
+    return allocator ? allocator : quazGlobalAllocator;
+}
+
+void QuaZAllocatorPrivate::fillAllocFunc(
+    zlib_allocfunc_def *allocFunc, QuaZAllocator *allocator)
+{
+    if (allocator) {
+        allocFunc->zalloc_mem = allocMem;
+        allocFunc->zfree_mem = freeMem;
+        allocFunc->opaque = allocator;
+    } else {
+        allocFunc->zalloc_mem = nullptr;
+        allocFunc->zfree_mem = nullptr;
+        allocFunc->opaque = nullptr;
+    }
+}
+
+void QuaZAllocatorPrivate::setupStream(z_stream &stream, QuaZAllocator *allocator)
+{
+    allocator = effective(allocator);
+    if (allocator) {
+        stream.zalloc = zlibAlloc;
+        stream.zfree = zlibFree;
+        stream.opaque = allocator;
+    } else {
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+#include "quazip_global.h"
+
+/// Interface to provide memory for zlib and ZIP/UNZIP internal structures
+/**
+  An allocator can be set for a QuaZip archive, for a QuaZIODevice, or
+  globally with setGlobalAllocator(). It is used for zlib compression
+  state, the archive handles and buffers, central directory data and
+  comments, so short-lived jobs can allocate from an arena released at
+  once, and memory can be tracked or capped per job.
+
+  The allocator must outlive all the objects that use it. It may be
+  called from any thread that uses these objects.
+*/
+class QUAZIP_EXPORT QuaZAllocator {
+public:
+    virtual ~QuaZAllocator();
+
+    /// Returns a block of \a size bytes, or nullptr on failure.
+    virtual void *allocate(size_t size) = 0;
+    /// Releases a block returned by allocate(). Never called with nullptr.
+    virtual void deallocate(void *address) = 0;
+
+    /// Returns the global allocator, nullptr by default.
+    static QuaZAllocator *globalAllocator();
+    /// Sets the allocator used when no allocator is set for an object.
+    /**
+      Affects archives and devices opened afterwards.
+      Should be called before any other thread uses QuaZIP.
+
+      \param allocator The allocator, or nullptr to use malloc() and free().
+    */
+    static void setGlobalAllocator(QuaZAllocator *allocator);
+};
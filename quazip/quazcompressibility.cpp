@@ -0,0 +1,134 @@
+#include "quazcompressibility.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+struct Magic {
+    int offset;
+    const char *bytes;
+    int size;
+};
+
+// Signatures of compressed formats
+const Magic magics[] = {
+    {0, "\xFF\xD8\xFF", 3}, // JPEG
+    {0, "\x89PNG\r\n\x1A\n", 8}, // PNG
+    {0, "GIF8", 4}, // GIF
+    {8, "WEBP", 4}, // WebP
+    {0, "PK\x03\x04", 4}, // ZIP
+    {0, "PK\x05\x06", 4}, // empty ZIP
+    {0, "PK\x07\x08", 4}, // spanned ZIP
+    {0, "\x1F\x8B", 2}, // gzip
+    {0, "BZh", 3}, // bzip2
+    {0, "\xFD" "7zXZ\0", 6}, // xz
+    {0, "\x28\xB5\x2F\xFD", 4}, // zstd
+    {0, "\x04\x22\x4D\x18", 4}, // lz4
+    {0, "7z\xBC\xAF\x27\x1C", 6}, // 7-Zip
+    {0, "Rar!\x1A\x07", 6}, // RAR
+    {4, "ftyp", 4}, // MP4, MOV, HEIC
+    {0, "\x1A\x45\xDF\xA3", 4}, // Matroska, WebM
+    {0, "OggS", 4}, // Ogg
+    {0, "fLaC", 4}, // FLAC
+    {0, "ID3", 3}, // MP3
+    {0, "wOFF", 4}, // WOFF
+    {0, "wOF2", 4}, // WOFF2
+};
+
+// Entropy of a sample worth the trial deflate
+const qreal HIGH_ENTROPY = 7.5;
+} // namespace
+
+QStringList QuaZCompressibility::defaultStoredExtensions()
+{
+    return {
+        "jpg", "jpeg", "png", "gif", "webp", "heic", "avif",
+        "mp3", "m4a", "aac", "ogg", "oga", "opus", "flac",
+        "mp4", "m4v", "mov", "mkv", "webm", "avi", "ogv",
+        "zip", "jar", "apk", "docx", "xlsx", "pptx", "odt", "ods", "odp",
+        "epub", "gz", "tgz", "bz2", "tbz2", "xz", "txz", "zst", "lz4",
+        "lzma", "7z", "rar", "cab", "woff", "woff2",
+    };
+}
+
+bool QuaZCompressibility::hasStoredExtension(
+    const QString &fileName, const QStringList &extensions)
+{
+    int dot = fileName.lastIndexOf('.');
+    if (dot < 0 || fileName.indexOf('/', dot) >= 0)
+        return false;
+
+    return extensions.contains(fileName.mid(dot + 1), Qt::CaseInsensitive);
+}
+
+bool QuaZCompressibility::hasCompressedMagic(const QByteArray &head)
+{
+    for (const auto &magic : magics) {
+        if (head.size() < magic.offset + magic.size)
+            continue;
+
+        if (memcmp(head.constData() + magic.offset, magic.bytes,
+                size_t(magic.size)) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+qreal QuaZCompressibility::entropy(const QByteArray &sample)
+{
+    if (sample.isEmpty())
+        return 0;
+
+    int counts[256] = {};
+    for (char c : sample) {
+        counts[quint8(c)]++;
+    }
+
+    qreal result = 0;
+    for (int count : counts) {
+        if (count == 0)
+            continue;
+
+        qreal p = qreal(count) / sample.size();
+        result -= p * std::log2(p);
+    }
+
+    return result;
+}
+
+bool QuaZCompressibility::isIncompressible(const QByteArray &sample)
+{
+    if (sample.size() < MIN_SAMPLE_SIZE || entropy(sample) < HIGH_ENTROPY)
+        return false;
+
+    auto trialSize = uLong(qMin(sample.size(), int(TRIAL_SIZE)));
+    auto compressedSize = compressBound(trialSize);
+    QByteArray compressed(int(compressedSize), Qt::Uninitialized);
+    if (compress2(reinterpret_cast<Bytef *>(compressed.data()),
+            &compressedSize,
+            reinterpret_cast<const Bytef *>(sample.constData()), trialSize,
+            Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+
+    return compressedSize * 100 >= trialSize * 97;
+}
+
+QuaZCompressibility::Decision QuaZCompressibility::decide(
+    const QString &fileName, const QByteArray &head)
+{
+    if (hasStoredExtension(fileName))
+        return StoreByExtension;
+
+    if (hasCompressedMagic(head))
+        return StoreByMagic;
+
+    if (isIncompressible(head))
+        return StoreBySample;
+
+    return Compress;
+}
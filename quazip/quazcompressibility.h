@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include "quazip_global.h"
+
+/// Utility class to tell incompressible data from compressible one
+/**
+  Deflating data that is already compressed, such as JPEG images, videos
+  or other archives, takes time and makes it slightly bigger. Such data
+  is better stored.
+
+  The decision is made from the file name and the first bytes of the data,
+  so that it does not require a second pass over the data.
+
+  \sa QuaZipFile::setAutoStoreEnabled()
+*/
+struct QUAZIP_EXPORT QuaZCompressibility {
+    /// Whether to compress the data, and why.
+    enum Decision
+    {
+        /// The data looks compressible, deflate it.
+        Compress,
+        /// The file name extension is a known compressed format.
+        StoreByExtension,
+        /// The data starts with a signature of a compressed format.
+        StoreByMagic,
+        /// A sample of the data has high entropy and does not deflate.
+        StoreBySample
+    };
+
+    enum
+    {
+        /// Bytes of the data enough to make a decision
+        SAMPLE_SIZE = 65536,
+        /// Bytes of the sample deflated by isIncompressible()
+        TRIAL_SIZE = 16384,
+        /// Samples shorter than this are always compressed
+        MIN_SAMPLE_SIZE = 512
+    };
+
+    /// File name extensions of compressed formats, lower case.
+    static QStringList defaultStoredExtensions();
+
+    /// Returns true if the file name extension is in \a extensions.
+    /**
+      The comparison is case insensitive.
+    */
+    static bool hasStoredExtension(const QString &fileName,
+        const QStringList &extensions = defaultStoredExtensions());
+
+    /// Returns true if \a head starts with a signature of a compressed
+    /// format, such as JPEG, PNG, ZIP, gzip or MP4.
+    static bool hasCompressedMagic(const QByteArray &head);
+
+    /// Shannon entropy of the bytes in bits per byte, from 0 to 8.
+    static qreal entropy(const QByteArray &sample);
+
+    /// Returns true if \a sample is not worth compressing.
+    /**
+      The sample should have high entropy, and deflating its first
+      TRIAL_SIZE bytes with the fastest level should save less than 3%.
+    */
+    static bool isIncompressible(const QByteArray &sample);
+
+    /// Decides whether to compress the data.
+    /**
+      \param fileName The file name, checked with hasStoredExtension().
+      \param head The first bytes of the data, up to SAMPLE_SIZE,
+      checked with hasCompressedMagic() and isIncompressible().
+    */
+    static Decision decide(const QString &fileName, const QByteArray &head);
+};
@@ -0,0 +1,364 @@
+#include "quazcompression.h"
+
+#include "quaziodevice_utils.h"
+#include "zip.h"
+#include "private/quazallocatorprivate.h"
+
+#include <QtEndian>
+
+#include <cstring>
+
+#include <limits>
+
+namespace {
+const int FORMAT_COUNT = 3;
+// Deflate can not compress better than 1032:1
+const qint64 MAX_RATIO = 1032;
+const qint64 MIN_CAPACITY = 256;
+// Decompressed size guessed for zlib and raw deflate data
+const qint64 GUESS_RATIO = 4;
+// gzip header and trailer
+const qint64 GZIP_OVERHEAD = 18;
+
+int windowBits(QuaZCompression::Format format)
+{
+    switch (format) {
+        case QuaZCompression::Deflate:
+            return -MAX_WBITS;
+        case QuaZCompression::Gzip:
+            return MAX_WBITS + 16;
+        case QuaZCompression::Zlib:
+            break;
+    }
+    return MAX_WBITS;
+}
+
+bool isValidLevel(int level)
+{
+    return level == Z_DEFAULT_COMPRESSION
+        || (level >= Z_NO_COMPRESSION && level <= Z_BEST_COMPRESSION);
+}
+
+/// zlib streams of a thread, reset for each call
+class StreamPool {
+public:
+    StreamPool();
+    ~StreamPool();
+
+    z_stream *deflater(QuaZCompression::Format format, int level);
+    z_stream *inflater(QuaZCompression::Format format);
+    void release();
+
+private:
+    Q_DISABLE_COPY(StreamPool)
+
+    /// One per format, the level is changed with deflateParams()
+    z_stream *deflaters[FORMAT_COUNT];
+    z_stream *inflaterStream;
+};
+
+StreamPool::StreamPool()
+    : inflaterStream(nullptr)
+{
+    for (auto &stream : deflaters) {
+        stream = nullptr;
+    }
+}
+
+StreamPool::~StreamPool()
+{
+    release();
+}
+
+z_stream *StreamPool::deflater(QuaZCompression::Format format, int level)
+{
+    if (!isValidLevel(level) || format < 0 || format >= FORMAT_COUNT)
+        return nullptr;
+
+    auto &stream = deflaters[format];
+    if (stream) {
+        if (deflateReset(stream) == Z_OK
+                && deflateParams(stream, level, Z_DEFAULT_STRATEGY) == Z_OK)
+            return stream;
+
+        deflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+
+    auto newStream = new z_stream;
+    memset(newStream, 0, sizeof(z_stream));
+    QuaZAllocatorPrivate::setupStream(*newStream, nullptr);
+    if (deflateInit2(newStream, level, Z_DEFLATED, windowBits(format),
+            DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        delete newStream;
+        return nullptr;
+    }
+
+    stream = newStream;
+    return stream;
+}
+
+z_stream *StreamPool::inflater(QuaZCompression::Format format)
+{
+    if (format < 0 || format >= FORMAT_COUNT)
+        return nullptr;
+
+    if (inflaterStream) {
+        if (inflateReset2(inflaterStream, windowBits(format)) == Z_OK)
+            return inflaterStream;
+
+        inflateEnd(inflaterStream);
+        delete inflaterStream;
+        inflaterStream = nullptr;
+    }
+
+    auto newStream = new z_stream;
+    memset(newStream, 0, sizeof(z_stream));
+    QuaZAllocatorPrivate::setupStream(*newStream, nullptr);
+    if (inflateInit2(newStream, windowBits(format)) != Z_OK) {
+        delete newStream;
+        return nullptr;
+    }
+
+    inflaterStream = newStream;
+    return inflaterStream;
+}
+
+void StreamPool::release()
+{
+    for (auto &stream : deflaters) {
+        if (!stream)
+            continue;
+
+        deflateEnd(stream);
+        delete stream;
+        stream = nullptr;
+    }
+
+    if (inflaterStream) {
+        inflateEnd(inflaterStream);
+        delete inflaterStream;
+        inflaterStream = nullptr;
+    }
+}
+
+StreamPool &threadPool()
+{
+    static thread_local StreamPool pool;
+    return pool;
+}
+
+void setOk(bool *ok, bool value)
+{
+    if (ok)
+        *ok = value;
+}
+
+/// Passes the next block of the input to the stream.
+void feedInput(z_stream *stream, const char *data, qint64 size, qint64 &inLeft)
+{
+    if (stream->avail_in != 0 || inLeft == 0)
+        return;
+
+    auto blockSize = QuaZIODeviceUtils::maxBlockSize<uInt>();
+    QuaZIODeviceUtils::adjustBlockSize(blockSize, inLeft);
+    stream->next_in = reinterpret_cast<z_const Bytef *>(
+        const_cast<char *>(data + (size - inLeft)));
+    stream->avail_in = blockSize;
+    inLeft -= blockSize;
+}
+
+/// Gives the next block of the output to the stream.
+void feedOutput(z_stream *stream, char *out, qint64 outSize, qint64 &outLeft)
+{
+    if (stream->avail_out != 0 || outLeft == 0)
+        return;
+
+    auto blockSize = QuaZIODeviceUtils::maxBlockSize<uInt>();
+    QuaZIODeviceUtils::adjustBlockSize(blockSize, outLeft);
+    stream->next_out = reinterpret_cast<Bytef *>(out + (outSize - outLeft));
+    stream->avail_out = blockSize;
+    outLeft -= blockSize;
+}
+
+qint64 deflateAll(z_stream *stream, const char *data, qint64 size, char *out,
+    qint64 outSize)
+{
+    qint64 inLeft = size;
+    qint64 outLeft = outSize;
+    stream->avail_in = 0;
+    stream->avail_out = 0;
+    forever {
+        feedInput(stream, data, size, inLeft);
+        feedOutput(stream, out, outSize, outLeft);
+        int result = deflate(stream, inLeft == 0 ? Z_FINISH : Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+            return outSize - outLeft - stream->avail_out;
+
+        if (result != Z_OK)
+            return -1;
+    }
+}
+
+qint64 inflateAll(z_stream *stream, const char *data, qint64 size, char *out,
+    qint64 outSize)
+{
+    qint64 inLeft = size;
+    qint64 outLeft = outSize;
+    stream->avail_in = 0;
+    stream->avail_out = 0;
+    forever {
+        feedInput(stream, data, size, inLeft);
+        feedOutput(stream, out, outSize, outLeft);
+        int result = inflate(stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+            return outSize - outLeft - stream->avail_out;
+
+        if (result != Z_OK)
+            return -1;
+    }
+}
+
+/// Decompressed size told by the data, or guessed
+qint64 expectedSize(
+    const char *data, qint64 size, QuaZCompression::Format format)
+{
+    if (format == QuaZCompression::Gzip && size >= GZIP_OVERHEAD) {
+        // ISIZE, the size modulo 2^32
+        return qFromLittleEndian<quint32>(data + size - 4);
+    }
+
+    return size * GUESS_RATIO;
+}
+} // namespace
+
+qint64 QuaZCompression::compressBound(qint64 size, Format format, int level)
+{
+    if (size < 0)
+        return -1;
+
+    auto stream = threadPool().deflater(format, level);
+    if (!stream)
+        return -1;
+
+    if (quint64(size) > std::numeric_limits<uLong>::max()) {
+        // deflateBound() can not tell, stored blocks are the worst case
+        return size + (size / 16383 + 1) * 5 + GZIP_OVERHEAD;
+    }
+
+    return qint64(deflateBound(stream, uLong(size)));
+}
+
+qint64 QuaZCompression::compress(const char *data, qint64 size, char *out,
+    qint64 outSize, Format format, int level)
+{
+    if (size < 0 || outSize < 0)
+        return -1;
+
+    auto stream = threadPool().deflater(format, level);
+    if (!stream)
+        return -1;
+
+    return deflateAll(stream, data, size, out, outSize);
+}
+
+QByteArray QuaZCompression::compress(
+    const char *data, qint64 size, Format format, int level, bool *ok)
+{
+    setOk(ok, false);
+    qint64 bound = compressBound(size, format, level);
+    if (bound < 0 || bound > std::numeric_limits<int>::max())
+        return QByteArray();
+
+    QByteArray result(int(bound), Qt::Uninitialized);
+    qint64 resultSize = compress(
+        data, size, result.data(), result.size(), format, level);
+    if (resultSize < 0)
+        return QByteArray();
+
+    result.resize(int(resultSize));
+    setOk(ok, true);
+    return result;
+}
+
+QByteArray QuaZCompression::compress(
+    const QByteArray &data, Format format, int level, bool *ok)
+{
+    return compress(data.constData(), data.size(), format, level, ok);
+}
+
+qint64 QuaZCompression::uncompress(const char *data, qint64 size, char *out,
+    qint64 outSize, Format format)
+{
+    if (size < 0 || outSize < 0)
+        return -1;
+
+    auto stream = threadPool().inflater(format);
+    if (!stream)
+        return -1;
+
+    return inflateAll(stream, data, size, out, outSize);
+}
+
+QByteArray QuaZCompression::uncompress(
+    const char *data, qint64 size, Format format, qint64 sizeHint, bool *ok)
+{
+    setOk(ok, false);
+    if (size < 0)
+        return QByteArray();
+
+    auto stream = threadPool().inflater(format);
+    if (!stream)
+        return QByteArray();
+
+    const qint64 maxSize = std::numeric_limits<int>::max();
+    if (sizeHint < 0)
+        sizeHint = expectedSize(data, size, format);
+    // do not trust a size that the data can not have
+    qint64 capacity = qMin(sizeHint, qMin(size * MAX_RATIO + MIN_CAPACITY, maxSize));
+
+    QByteArray result(int(capacity), Qt::Uninitialized);
+    qint64 inLeft = size;
+    qint64 outLeft = result.size();
+    stream->avail_in = 0;
+    stream->avail_out = 0;
+    forever {
+        if (stream->avail_out == 0 && outLeft == 0) {
+            // the guess was too small
+            qint64 used = result.size();
+            if (used == maxSize)
+                return QByteArray();
+
+            result.resize(int(qBound(MIN_CAPACITY, used * 2, maxSize)));
+            outLeft = result.size() - used;
+        }
+
+        feedInput(stream, data, size, inLeft);
+        feedOutput(stream, result.data(), result.size(), outLeft);
+        int code = inflate(stream, Z_NO_FLUSH);
+        if (code == Z_STREAM_END)
+            break;
+
+        if (code == Z_BUF_ERROR && stream->avail_out == 0 && outLeft == 0)
+            continue;
+
+        if (code != Z_OK)
+            return QByteArray();
+    }
+
+    result.resize(int(result.size() - outLeft - stream->avail_out));
+    setOk(ok, true);
+    return result;
+}
+
+QByteArray QuaZCompression::uncompress(
+    const QByteArray &data, Format format, qint64 sizeHint, bool *ok)
+{
+    return uncompress(data.constData(), data.size(), format, sizeHint, ok);
+}
+
+void QuaZCompression::releaseThreadStreams()
+{
+    threadPool().release();
+}
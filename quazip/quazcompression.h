@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QByteArray>
+
+#include <zlib.h>
+
+#include "quazip_global.h"
+
+/// Compresses and decompresses data in memory with one call
+/**
+  The helpers deflate a whole buffer without a QBuffer and a QuaZIODevice.
+  Each thread keeps a deflater per format and one inflater, and reuses
+  them with deflateReset() and deflateParams() or inflateReset2(), so
+  small payloads do not pay for the stream setup.
+  The streams are allocated with the global allocator at first use, see
+  QuaZAllocator::setGlobalAllocator().
+
+  Example:
+  \code
+  QByteArray packed = QuaZCompression::compress(message, QuaZCompression::Gzip);
+  bool ok;
+  QByteArray unpacked = QuaZCompression::uncompress(
+      packed, QuaZCompression::Gzip, -1, &ok);
+  \endcode
+
+  \sa QuaZIODevice, QuaGzipDevice
+*/
+struct QUAZIP_EXPORT QuaZCompression {
+    /// Stream format
+    enum Format
+    {
+        /// Raw deflate stream without a header
+        Deflate,
+        /// zlib header and Adler-32 checksum
+        Zlib,
+        /// gzip header, CRC-32 and size
+        Gzip
+    };
+
+    /// Maximum size of \a size bytes compressed to \a format.
+    /**
+      Computed with deflateBound() for the level. Returns -1 if the level
+      is invalid.
+    */
+    static qint64 compressBound(qint64 size, Format format = Zlib,
+        int level = Z_DEFAULT_COMPRESSION);
+
+    /// Compresses \a size bytes of \a data into \a out.
+    /**
+      \a outSize should be at least compressBound(size).
+      \return The size of the compressed data, or -1 on error or if
+      \a out is too small.
+    */
+    static qint64 compress(const char *data, qint64 size, char *out,
+        qint64 outSize, Format format = Zlib,
+        int level = Z_DEFAULT_COMPRESSION);
+    /// Compresses \a size bytes of \a data.
+    /**
+      The result is allocated once, with compressBound().
+      Returns an empty array on error, and sets \a ok if not nullptr.
+    */
+    static QByteArray compress(const char *data, qint64 size,
+        Format format = Zlib, int level = Z_DEFAULT_COMPRESSION,
+        bool *ok = nullptr);
+    /// Compresses \a data.
+    static QByteArray compress(const QByteArray &data, Format format = Zlib,
+        int level = Z_DEFAULT_COMPRESSION, bool *ok = nullptr);
+
+    /// Decompresses \a size bytes of \a data into \a out.
+    /**
+      \return The size of the decompressed data, or -1 if the data is
+      corrupted, truncated or does not fit into \a outSize bytes.
+    */
+    static qint64 uncompress(const char *data, qint64 size, char *out,
+        qint64 outSize, Format format = Zlib);
+    /// Decompresses \a size bytes of \a data.
+    /**
+      \param sizeHint The expected decompressed size. The result is
+      allocated once if it is right. If -1, the gzip ISIZE field is used
+      for Gzip, and a multiple of \a size otherwise.
+      \param ok Set to whether the data was decompressed, if not nullptr.
+      \return The decompressed data, or an empty array on error.
+    */
+    static QByteArray uncompress(const char *data, qint64 size,
+        Format format = Zlib, qint64 sizeHint = -1, bool *ok = nullptr);
+    /// Decompresses \a data.
+    static QByteArray uncompress(const QByteArray &data, Format format = Zlib,
+        qint64 sizeHint = -1, bool *ok = nullptr);
+
+    /// Frees the zlib streams kept by the calling thread.
+    /**
+      They are also freed when the thread exits.
+    */
+    static void releaseThreadStreams();
+};
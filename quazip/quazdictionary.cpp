@@ -0,0 +1,117 @@
+#include "quazdictionary.h"
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include <algorithm>
+
+#include <zlib.h>
+
+namespace {
+struct Segment {
+    QByteArray bytes;
+    int count;
+
+    bool operator<(const Segment &other) const
+    {
+        if (count != other.count)
+            return count > other.count;
+
+        return bytes < other.bytes;
+    }
+};
+} // namespace
+
+quint32 QuaZDictionary::id(const QByteArray &dictionary)
+{
+    auto value = adler32(0L, Z_NULL, 0);
+    return quint32(adler32(value,
+        reinterpret_cast<const Bytef *>(dictionary.constData()),
+        uInt(dictionary.size())));
+}
+
+QByteArray QuaZDictionary::train(const QByteArrayList &samples, int maxSize)
+{
+    maxSize = qBound(0, maxSize, int(MAX_SIZE));
+
+    // In how many samples each segment occurs
+    QHash<QByteArray, int> counts;
+    for (const auto &sample : samples) {
+        QSet<QByteArray> seen;
+        for (int i = 0; i + SEGMENT_SIZE <= sample.size(); i++) {
+            auto bytes = QByteArray::fromRawData(
+                sample.constData() + i, SEGMENT_SIZE);
+            if (seen.contains(bytes))
+                continue;
+
+            seen.insert(bytes);
+            counts[bytes]++;
+        }
+    }
+
+    int minCount = samples.size() > 1 ? 2 : 1;
+
+    QVector<Segment> segments;
+    // Most common segment starting with given SEGMENT_SIZE - 1 bytes
+    QHash<QByteArray, Segment> successors;
+    for (auto it = counts.cbegin(); it != counts.cend(); ++it) {
+        if (it.value() < minCount)
+            continue;
+
+        Segment segment = {it.key(), it.value()};
+        segments.append(segment);
+
+        auto prefix = segment.bytes.left(SEGMENT_SIZE - 1);
+        auto successor = successors.find(prefix);
+        if (successor == successors.end()) {
+            successors.insert(prefix, segment);
+        } else if (segment < successor.value()) {
+            successor.value() = segment;
+        }
+    }
+
+    std::sort(segments.begin(), segments.end());
+
+    // Join common segments into longer strings
+    QByteArrayList pieces;
+    QSet<QByteArray> used;
+    int totalSize = 0;
+    for (const auto &segment : segments) {
+        if (totalSize >= maxSize)
+            break;
+
+        if (used.contains(segment.bytes))
+            continue;
+
+        used.insert(segment.bytes);
+        auto piece = segment.bytes;
+        forever {
+            auto successor = successors.constFind(piece.right(SEGMENT_SIZE - 1));
+            if (successor == successors.cend() ||
+                used.contains(successor.value().bytes)) {
+                break;
+            }
+
+            used.insert(successor.value().bytes);
+            piece.append(successor.value().bytes.at(SEGMENT_SIZE - 1));
+        }
+
+        pieces.append(piece);
+        totalSize += piece.size();
+    }
+
+    // zlib finds closer matches cheaper, so the most common strings go last
+    QByteArray result;
+    result.reserve(totalSize);
+    for (int i = pieces.size() - 1; i >= 0; i--) {
+        result.append(pieces.at(i));
+    }
+
+    if (result.size() > maxSize)
+        result.remove(0, result.size() - maxSize);
+
+    // Raw data segments refer to samples, which are not owned
+    result.detach();
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayList>
+
+#include "quazip_global.h"
+
+/// Utility class to build preset dictionaries for zlib compression
+/**
+  A preset dictionary helps to compress small payloads, which are too short
+  for zlib to find repetitions inside them. The dictionary should contain
+  strings likely to appear in the data, the most common ones at the end.
+
+  \sa QuaZIODevice::setDictionary()
+*/
+struct QUAZIP_EXPORT QuaZDictionary {
+    enum
+    {
+        /// zlib only uses the last 32K bytes of a dictionary
+        MAX_SIZE = 32768,
+        /// Length of the strings counted by train()
+        SEGMENT_SIZE = 8
+    };
+
+    /// Returns the dictionary id stored in zlib stream header.
+    /**
+      The id is the Adler-32 checksum of the dictionary.
+    */
+    static quint32 id(const QByteArray &dictionary);
+
+    /// Builds a dictionary from sample payloads
+    /**
+      Counts in how many samples each string of SEGMENT_SIZE bytes occurs,
+      joins overlapping common strings together and puts them into the
+      dictionary ordered by that count, the most common ones at the end.
+      Strings found in only one sample are ignored, unless there is only
+      one sample.
+
+      \param samples Payloads similar to the data to compress.
+      \param maxSize Maximum size of the dictionary, up to MAX_SIZE.
+      \return Dictionary bytes, empty if the samples have nothing in common.
+    */
+    static QByteArray train(
+        const QByteArrayList &samples, int maxSize = MAX_SIZE);
+};
@@ -27,6 +27,16 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "private/quaziodeviceprivate.h"
 
+#include <QTimerEvent>
+
+#include <utility>
+
+static_assert(QuaZIODevice::NoFlush == Z_NO_FLUSH &&
+        QuaZIODevice::PartialFlush == Z_PARTIAL_FLUSH &&
+        QuaZIODevice::SyncFlush == Z_SYNC_FLUSH &&
+        QuaZIODevice::FullFlush == Z_FULL_FLUSH,
+    "FlushMode should match zlib flush values");
+
 QuaZIODevice::QuaZIODevice(QuaZIODevicePrivate *p, QObject *parent)
     : QIODevice(parent)
     , d(p)
@@ -58,6 +68,9 @@ QIODevice *QuaZIODevice::ioDevice() const
 
 bool QuaZIODevice::atEnd() const
 {
+    if (isReadable() && d->isBoundedSequentialRead())
+        return d->atEnd || d->hasError;
+
     return bytesAvailable() == 0;
 }
 
@@ -228,6 +241,13 @@ qint64 QuaZIODevice::bytesAvailable() const
         return 0;
 
     if (isReadable()) {
+        if (d->isBoundedSequentialRead()) {
+            // Unknown without decompressing; report pending input
+            if (d->atEnd)
+                return 0;
+            return qint64(d->zstream.avail_in) + d->io->bytesAvailable();
+        }
+
         return size() - pos();
     }
 
@@ -237,9 +257,14 @@ qint64 QuaZIODevice::bytesAvailable() const
 qint64 QuaZIODevice::size() const
 {
     if (isWritable())
-        return qint64(d->zstream.total_in);
+        return qint64(d->zstream.total_in) + d->writeBuffer.size();
 
     if (isReadable()) {
+        if (!d->hasUncompressedSize && d->isBoundedSequentialRead()) {
+            // Looking ahead would buffer the whole stream
+            return qint64(d->zstream.total_out);
+        }
+
         if (!d->hasUncompressedSize) {
             auto io = d->io;
             bool sequential = io->isSequential();
@@ -288,3 +313,266 @@ int QuaZIODevice::compressionLevel() const
 {
     return d->compressionLevel;
 }
+
+bool QuaZIODevice::isTransactionalReadEnabled() const
+{
+    return d->transactionalRead;
+}
+
+void QuaZIODevice::setTransactionalReadEnabled(bool enabled)
+{
+    if (isOpen()) {
+        qWarning("QuaZIODevice::setTransactionalReadEnabled(): "
+                 "device is already open");
+        return;
+    }
+
+    d->transactionalRead = enabled;
+}
+
+QByteArray QuaZIODevice::trailingInput() const
+{
+    if (!isReadable() || !d->atEnd || !d->isBoundedSequentialRead())
+        return QByteArray();
+
+    return QByteArray(reinterpret_cast<const char *>(d->zstream.next_in),
+        int(d->zstream.avail_in));
+}
+
+int QuaZIODevice::writeBufferThreshold() const
+{
+    return d->writeBufferThreshold;
+}
+
+void QuaZIODevice::setWriteBufferThreshold(int threshold)
+{
+    d->writeBufferThreshold = qMax(threshold, 0);
+    if (isWritable() && d->writeBuffer.size() >= d->writeBufferThreshold) {
+        d->flushPendingInput();
+    }
+}
+
+qint64 QuaZIODevice::writeFragments(const QByteArrayList &fragments)
+{
+    if (!isWritable()) {
+        qWarning("QuaZIODevice::writeFragments(): device is not open for "
+                 "writing");
+        return -1;
+    }
+
+    return d->writeFragments(fragments);
+}
+
+bool QuaZIODevice::flush(FlushMode mode)
+{
+    if (!isWritable()) {
+        qWarning("QuaZIODevice::flush(): device is not open for writing");
+        return false;
+    }
+
+    return d->flushOutput(int(mode));
+}
+
+QuaZIODevice::FlushMode QuaZIODevice::autoFlushMode() const
+{
+    return FlushMode(d->autoFlushMode);
+}
+
+void QuaZIODevice::setAutoFlush(FlushMode mode, int msecs, qint64 bytes)
+{
+    d->autoFlushMode = int(mode);
+    d->autoFlushInterval = qMax(msecs, 0);
+    d->autoFlushBytes = qMax(bytes, qint64(0));
+    d->flushTimer.stop();
+
+    if (isWritable()) {
+        d->autoFlush();
+    }
+}
+
+int QuaZIODevice::autoFlushInterval() const
+{
+    return d->autoFlushInterval;
+}
+
+qint64 QuaZIODevice::autoFlushBytes() const
+{
+    return d->autoFlushBytes;
+}
+
+void QuaZIODevice::setAdaptiveCompression(
+    int minLevel, int maxLevel, int msecs, qreal maxLoad)
+{
+    minLevel = qBound(Z_NO_COMPRESSION, minLevel, Z_BEST_COMPRESSION);
+    maxLevel = qBound(Z_NO_COMPRESSION, maxLevel, Z_BEST_COMPRESSION);
+    if (minLevel > maxLevel)
+        std::swap(minLevel, maxLevel);
+
+    d->adaptive = true;
+    d->adaptiveMinLevel = minLevel;
+    d->adaptiveMaxLevel = maxLevel;
+    d->adaptiveInterval = qMax(msecs, 0);
+    d->adaptiveMaxLoad = qBound(qreal(0), maxLoad, qreal(1));
+    d->sampleTimer.invalidate();
+
+    // zlib maps the default compression to level 6
+    int level = d->compressionLevel == Z_DEFAULT_COMPRESSION
+        ? 6
+        : d->compressionLevel;
+    d->setCompressionLevel(qBound(minLevel, level, maxLevel));
+}
+
+void QuaZIODevice::disableAdaptiveCompression()
+{
+    d->adaptive = false;
+    d->sampleTimer.invalidate();
+}
+
+bool QuaZIODevice::isAdaptiveCompression() const
+{
+    return d->adaptive;
+}
+
+int QuaZIODevice::adaptiveMinLevel() const
+{
+    return d->adaptiveMinLevel;
+}
+
+int QuaZIODevice::adaptiveMaxLevel() const
+{
+    return d->adaptiveMaxLevel;
+}
+
+int QuaZIODevice::adaptiveInterval() const
+{
+    return d->adaptiveInterval;
+}
+
+qreal QuaZIODevice::adaptiveMaxLoad() const
+{
+    return d->adaptiveMaxLoad;
+}
+
+qint64 QuaZIODevice::backpressureLimit() const
+{
+    return d->backpressureLimit;
+}
+
+void QuaZIODevice::setBackpressureLimit(qint64 bytes)
+{
+    d->backpressureLimit = qMax(bytes, qint64(0));
+}
+
+QuaZIODevice::AdaptiveCompressionStats
+QuaZIODevice::adaptiveCompressionStats() const
+{
+    return d->adaptiveStats;
+}
+
+void QuaZIODevice::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != d->flushTimer.timerId()) {
+        QIODevice::timerEvent(event);
+        return;
+    }
+
+    d->flushTimer.stop();
+    if (isWritable() && d->autoFlushMode != Z_NO_FLUSH) {
+        d->flushOutput(d->autoFlushMode);
+    }
+}
+
+QByteArray QuaZIODevice::dictionary() const
+{
+    return d->dictionary;
+}
+
+void QuaZIODevice::setDictionary(const QByteArray &dictionary)
+{
+    if (isOpen()) {
+        qWarning("QuaZIODevice::setDictionary(): device is already open");
+        return;
+    }
+
+    d->dictionary = dictionary;
+}
+
+void QuaZIODevice::setDictionaryResolver(const DictionaryResolver &resolver)
+{
+    d->dictionaryResolver = resolver;
+}
+
+int QuaZIODevice::windowBits() const
+{
+    return d->windowBits;
+}
+
+void QuaZIODevice::setWindowBits(int value)
+{
+    if (isOpen()) {
+        qWarning("QuaZIODevice::setWindowBits(): device is already open");
+        return;
+    }
+
+    // zlib 1.2.9 and later reject 8 for raw deflate and gzip
+    int bits = qBound(9, qAbs(value), MAX_WBITS);
+    d->windowBits = value < 0 ? -bits : bits;
+}
+
+int QuaZIODevice::memLevel() const
+{
+    return d->memLevel;
+}
+
+void QuaZIODevice::setMemLevel(int value)
+{
+    if (isOpen()) {
+        qWarning("QuaZIODevice::setMemLevel(): device is already open");
+        return;
+    }
+
+    d->memLevel = qBound(1, value, MAX_MEM_LEVEL);
+}
+
+void QuaZIODevice::setLowMemoryProfile()
+{
+    setWindowBits(d->windowBits < 0 ? -LOW_MEMORY_WINDOW_BITS
+                                    : LOW_MEMORY_WINDOW_BITS);
+    setMemLevel(LOW_MEMORY_MEM_LEVEL);
+}
+
+qint64 QuaZIODevice::memoryUsage() const
+{
+    return d->memoryUsage();
+}
+
+qint64 QuaZIODevice::deflateMemoryUsage(int windowBits, int memLevel)
+{
+    // See "Memory Footprint" in zconf.h; zlib uses at least 9 bits window
+    int bits = qBound(9, qAbs(windowBits) & 15, MAX_WBITS);
+    return (qint64(1) << (bits + 2)) +
+        (qint64(1) << (qBound(1, memLevel, MAX_MEM_LEVEL) + 9)) + 6 * 1024;
+}
+
+qint64 QuaZIODevice::inflateMemoryUsage(int windowBits)
+{
+    int bits = qAbs(windowBits) & 15;
+    if (bits == 0)
+        bits = MAX_WBITS;
+    return (qint64(1) << bits) + 7 * 1024;
+}
+
+QuaZAllocator *QuaZIODevice::allocator() const
+{
+    return d->allocator;
+}
+
+void QuaZIODevice::setAllocator(QuaZAllocator *allocator)
+{
+    if (isOpen()) {
+        qWarning("QuaZIODevice::setAllocator(): device is already open");
+        return;
+    }
+
+    d->allocator = allocator;
+}
@@ -27,8 +27,12 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "quazip_global.h"
+#include <QByteArrayList>
 #include <QIODevice>
 
+#include <functional>
+
+class QuaZAllocator;
 class QuaZIODevicePrivate;
 
 /// A class to compress/decompress QIODevice.
@@ -44,6 +48,81 @@ class QUAZIP_EXPORT QuaZIODevice : public QIODevice {
     /// @endcond
 
 public:
+    /// How to flush the compressed stream.
+    enum FlushMode
+    {
+        /// Do not flush, let zlib decide when to emit output.
+        NoFlush = 0,
+        /// Emit all pending output and enough bits to decode it.
+        /// Adds less overhead than SyncFlush. Same as Z_PARTIAL_FLUSH.
+        PartialFlush = 1,
+        /// Emit all pending output aligned to a byte boundary.
+        /// Same as Z_SYNC_FLUSH.
+        SyncFlush = 2,
+        /// Same as SyncFlush and also reset the compression state,
+        /// so that decompression can restart from this point.
+        /// Degrades compression if used often. Same as Z_FULL_FLUSH.
+        FullFlush = 3
+    };
+
+    enum
+    {
+        /// Window bits of the low memory profile
+        LOW_MEMORY_WINDOW_BITS = 12,
+        /// Memory level of the low memory profile
+        LOW_MEMORY_MEM_LEVEL = 4
+    };
+
+    enum
+    {
+        /// Default sample interval of adaptive compression in milliseconds
+        ADAPTIVE_INTERVAL = 1000,
+        /// Default backpressure limit of adaptive compression in bytes
+        ADAPTIVE_BACKPRESSURE_LIMIT = 262144
+    };
+
+    /// Last decision of the adaptive compression controller.
+    enum AdaptiveDecision
+    {
+        /// The level was kept.
+        KeepLevel,
+        /// The level was lowered because compression took too much time.
+        LowerLevelForLoad,
+        /// The level was raised because the dependent device is behind.
+        RaiseLevelForBackpressure,
+        /// The level was raised because compression had spare time.
+        RaiseLevelForIdle
+    };
+    Q_ENUM(AdaptiveDecision)
+
+    /// Measurements of the adaptive compression controller.
+    struct AdaptiveCompressionStats {
+        /// Input bytes per second in the last sample.
+        qint64 inputRate = 0;
+        /// Input bytes compressed per second of compression time
+        /// in the last sample.
+        qint64 compressionRate = 0;
+        /// Part of the last sample time spent compressing, from 0 to 1.
+        qreal load = 0;
+        /// Bytes waiting to be written by the dependent device.
+        qint64 bytesToWrite = 0;
+        /// Decision made after the last sample.
+        AdaptiveDecision decision = KeepLevel;
+        /// Number of samples taken.
+        int samples = 0;
+        /// Number of times the level was lowered.
+        int lowered = 0;
+        /// Number of times the level was raised.
+        int raised = 0;
+    };
+
+    /// Returns dictionary bytes for the dictionary id.
+    /**
+      The id is the Adler-32 checksum of the dictionary,
+      see QuaZDictionary::id().
+    */
+    using DictionaryResolver = std::function<QByteArray(quint32 id)>;
+
     /// Constructor.
     /**
       \param parent The parent object, as per QObject logic.
@@ -109,6 +188,240 @@ public:
     */
     void setCompressionStrategy(int value);
 
+    /// Base two logarithm of the zlib window size.
+    /// Default is MAX_WBITS.
+    int windowBits() const;
+    /// Set base two logarithm of the zlib window size
+    /**
+      Smaller window uses less memory, but compresses worse.
+      Data compressed with a window cannot be decompressed with a smaller
+      one. Should be called before open().
+
+      \param value From 9 to 15 for zlib format, from -15 to -9 for raw
+      deflate without zlib header and checksum. QuaGzipDevice always
+      writes gzip format and ignores the sign. 8 is raised to 9, zlib
+      rejects it for raw deflate and gzip, and uses 9 anyway.
+    */
+    void setWindowBits(int value);
+    /// Memory level for compression.
+    /// Default is MAX_MEM_LEVEL.
+    int memLevel() const;
+    /// Set memory level for compression
+    /**
+      Lower level uses less memory, but is slower and compresses worse.
+      Should be called before open().
+
+      \param value From 1 to MAX_MEM_LEVEL.
+    */
+    void setMemLevel(int value);
+    /// Set low memory profile
+    /**
+      Sets window bits to LOW_MEMORY_WINDOW_BITS and memory level to
+      LOW_MEMORY_MEM_LEVEL, keeping the sign of window bits. Compression
+      state then takes about 30K instead of about 390K, which matters
+      when a lot of streams are open at once, at the cost of some
+      compression ratio. Decompression with the low memory profile needs
+      data compressed with the same or smaller window.
+    */
+    void setLowMemoryProfile();
+    /// Returns estimated memory used by this device in bytes.
+    /**
+      Includes the state of zlib for the current open mode, internal
+      buffers and the device data.
+    */
+    qint64 memoryUsage() const;
+    /// Returns estimated memory used by zlib compression state.
+    static qint64 deflateMemoryUsage(int windowBits, int memLevel);
+    /// Returns estimated memory used by zlib decompression state.
+    static qint64 inflateMemoryUsage(int windowBits);
+
+    /// Returns true if over-read input is given back to sequential device.
+    /// Default is true.
+    bool isTransactionalReadEnabled() const;
+    /// Set how compressed input is read from a sequential dependent device.
+    /**
+      When enabled, each refill of the internal input buffer is done inside
+      a QIODevice transaction of the dependent device, and at the end of
+      the compressed stream the bytes read past it are rolled back into
+      the dependent device. Qt keeps all the bytes read during
+      a transaction, so memory usage grows with slow input.
+
+      When disabled, compressed input is read straight into the fixed-size
+      internal buffer, so memory usage does not depend on stream length.
+      Reading less than requested is not an error: read() returns what
+      could be decompressed so far, and the rest comes with the next
+      readyRead(). The bytes read past the end of the compressed stream
+      stay in this device, see trailingInput().
+
+      Has no effect for non-sequential devices. Should be called before
+      open().
+
+      \param enabled Whether to use transactions of the dependent device.
+    */
+    void setTransactionalReadEnabled(bool enabled);
+    /// Returns the bytes read past the end of the compressed stream.
+    /**
+      Only set when the end of the compressed stream is reached while
+      transactional read is disabled for a sequential dependent device.
+      \sa setTransactionalReadEnabled()
+    */
+    QByteArray trailingInput() const;
+
+    /// Write buffer threshold in bytes.
+    /// Default is 0, which means that writes are not buffered.
+    int writeBufferThreshold() const;
+    /// Set write buffer threshold.
+    /**
+      Writes smaller than \a threshold bytes are collected in an internal
+      buffer, which is compressed as a whole as soon as it reaches
+      \a threshold bytes. Larger writes are compressed directly, after
+      the buffered data. This reduces the per-call overhead of zlib
+      when a lot of small chunks are written.
+
+      The buffered data is compressed when the device is closed, and also
+      before changing the compression level or strategy.
+
+      \param threshold The number of bytes to collect before compressing.
+    */
+    void setWriteBufferThreshold(int threshold);
+    /// Writes several data fragments at once.
+    /**
+      Equivalent to writing each fragment in order, but without the per-call
+      overhead of QIODevice::write().
+
+      \param fragments The data to write.
+      \return The total number of bytes written, or -1 on error.
+    */
+    qint64 writeFragments(const QByteArrayList &fragments);
+
+    /// Writes all the data compressed so far to the dependent device.
+    /**
+      Without flushing, zlib keeps the compressed data until it has enough
+      input, and the device keeps it until its internal buffer is full,
+      so a slow stream may not reach the dependent device until close().
+
+      \param mode How to flush; NoFlush only writes the compressed data
+      already available.
+      \return false on error or if the device is not open for writing.
+    */
+    bool flush(FlushMode mode = SyncFlush);
+    /// Flush mode used by the automatic flush policy.
+    /// Default is NoFlush, which disables automatic flushing.
+    FlushMode autoFlushMode() const;
+    /// Sets automatic flush policy.
+    /**
+      When \a mode is not NoFlush, the device flushes itself with \a mode
+      as soon as \a bytes bytes of input were written since the last flush,
+      or \a msecs milliseconds after the first write not yet flushed,
+      whichever comes first. The timer requires a running event loop in
+      the thread of this device.
+
+      This bounds the latency of a compressed stream while keeping the
+      compression ratio during bursts.
+
+      \param mode The flush mode.
+      \param msecs Flush interval, 0 to disable the timer.
+      \param bytes Flush threshold, 0 to disable it.
+    */
+    void setAutoFlush(FlushMode mode, int msecs, qint64 bytes = 0);
+    /// Automatic flush interval in milliseconds.
+    int autoFlushInterval() const;
+    /// Automatic flush threshold in bytes.
+    qint64 autoFlushBytes() const;
+
+    /// Enables adaptive compression level.
+    /**
+      Every \a msecs milliseconds of writing the device compares the time
+      spent in zlib with the time passed, and the size of the data not yet
+      written by the dependent device with backpressureLimit(). Then it
+      moves compressionLevel() one step:
+      - down, if compression took more than \a maxLoad of the time,
+        so that the device keeps up with the producer;
+      - up, if the dependent device is behind, so that less data is sent;
+      - up, if compression took less than a half of \a maxLoad,
+        so that spare time improves the compression ratio.
+
+      The level stays between \a minLevel and \a maxLevel. The sample
+      is taken while writing, no event loop is required.
+
+      \param minLevel The lowest compression level, from 0 to 9.
+      \param maxLevel The highest compression level, from 0 to 9.
+      \param msecs The sample interval.
+      \param maxLoad The part of time allowed to spend compressing.
+      \sa compressionLevelAdapted(), adaptiveCompressionStats()
+    */
+    void setAdaptiveCompression(int minLevel, int maxLevel,
+        int msecs = ADAPTIVE_INTERVAL, qreal maxLoad = 0.5);
+    /// Disables adaptive compression level, keeping the current level.
+    void disableAdaptiveCompression();
+    /// Returns true if adaptive compression level is enabled.
+    bool isAdaptiveCompression() const;
+    /// The lowest adaptive compression level.
+    int adaptiveMinLevel() const;
+    /// The highest adaptive compression level.
+    int adaptiveMaxLevel() const;
+    /// The sample interval of adaptive compression in milliseconds.
+    int adaptiveInterval() const;
+    /// The part of time allowed to spend compressing.
+    qreal adaptiveMaxLoad() const;
+    /// Size of unwritten data of the dependent device that means
+    /// backpressure. Default is ADAPTIVE_BACKPRESSURE_LIMIT.
+    qint64 backpressureLimit() const;
+    /// Sets size of unwritten data of the dependent device that means
+    /// backpressure.
+    /**
+      \param bytes The limit compared with QIODevice::bytesToWrite()
+      of the dependent device, 0 to ignore backpressure.
+    */
+    void setBackpressureLimit(qint64 bytes);
+    /// Returns measurements and decisions of adaptive compression.
+    AdaptiveCompressionStats adaptiveCompressionStats() const;
+
+    /// Preset dictionary. Empty by default.
+    QByteArray dictionary() const;
+    /// Sets preset dictionary.
+    /**
+      In write mode, the dictionary is given to zlib before compression.
+      The compressed stream stores the dictionary id, and cannot be
+      decompressed without the same dictionary. Not supported by gzip
+      format.
+
+      In read mode, the dictionary is used when the stream requires one
+      and the dictionary resolver is not set or returns empty bytes.
+
+      Should be called before open().
+
+      \param dictionary Dictionary bytes, see QuaZDictionary::train().
+    */
+    void setDictionary(const QByteArray &dictionary);
+    /// Sets the function to look up the dictionary required to decompress.
+    /**
+      Called with the dictionary id stored in the compressed stream.
+      Allows to choose one of several dictionaries while reading.
+
+      \param resolver The function, or nullptr to remove it.
+    */
+    void setDictionaryResolver(const DictionaryResolver &resolver);
+
+    /// Allocator for zlib state. Default is nullptr.
+    QuaZAllocator *allocator() const;
+    /// Sets allocator for zlib state
+    /**
+      Should be called before open().
+
+      \param allocator The allocator, or nullptr to use
+      QuaZAllocator::globalAllocator().
+    */
+    void setAllocator(QuaZAllocator *allocator);
+
+signals:
+    /// Emitted when adaptive compression changes the compression level.
+    /**
+      \param level The new compression level.
+      \param decision The reason of the change.
+    */
+    void compressionLevelAdapted(int level, AdaptiveDecision decision);
+
 protected:
     /// protected constructor for descendants
     QuaZIODevice(QuaZIODevicePrivate *p, QObject *parent);
@@ -117,6 +430,8 @@ protected:
     virtual qint64 readData(char *data, qint64 maxSize) override;
     /// Implementation of QIODevice::writeData().
     virtual qint64 writeData(const char *data, qint64 maxSize) override;
+    /// Implementation of QObject::timerEvent().
+    virtual void timerEvent(QTimerEvent *event) override;
 
 private:
     void dependedDeviceWillClose();
@@ -22,11 +22,20 @@ Original ZIP package is copyrighted by Gilles Vollant, see
 quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
+#include <QAtomicInt>
 #include <QFile>
 #include <QFlags>
 #include <QHash>
+#include <QScopedPointer>
+
+#include <limits>
 
 #include "quazip.h"
+#include "private/quazallocatorprivate.h"
+#include "private/quazipdirindex.h"
+#include "private/quazipentrytableprivate.h"
+#include "quazipentryview.h"
+#include "private/quazipnamematcher.h"
 
 /// All the internal stuff for the QuaZip class.
 /**
@@ -70,6 +79,16 @@ class QuaZipPrivate {
     bool zip64;
     /// The auto-close flag.
     bool autoClose;
+    /// The allocator for the archive structures.
+    QuaZAllocator *allocator;
+    /// Changes on each open(), 0 if not open.
+    int openId;
+    /// Changes each time the directory map is cleared.
+    int directoryGeneration;
+    /// Assigns a new \ref openId.
+    void setOpened(QuaZip::Mode mode, QIODevice *ioDevice);
+    /// Fills the default IO functions with \ref allocator.
+    void fillIoApi(zlib_filefunc64_32_def *ioApi64) const;
     inline QTextCodec *getDefaultFileNameCodec()
     {
         if (defaultFileNameCodec == NULL) {
@@ -89,7 +108,10 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      allocator(NULL),
+      openId(0),
+      directoryGeneration(0)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -108,7 +130,10 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      allocator(NULL),
+      openId(0),
+      directoryGeneration(0)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -126,7 +151,10 @@ class QuaZipPrivate {
       zipError(UNZ_OK),
       dataDescriptorWritingEnabled(true),
       zip64(false),
-      autoClose(true)
+      autoClose(true),
+      allocator(NULL),
+      openId(0),
+      directoryGeneration(0)
     {
         unzFile_f = NULL;
         zipFile_f = NULL;
@@ -144,6 +172,8 @@ class QuaZipPrivate {
       QHash<QString, unz64_file_pos> directoryCaseSensitive;
       QHash<QString, unz64_file_pos> directoryCaseInsensitive;
       unz64_file_pos lastMappedDirectoryEntry;
+      /// The directory tree for QuaZipDir, built on demand.
+      QScopedPointer<QuaZipDirIndex> dirIndex;
       static QTextCodec *defaultFileNameCodec;
 };
 
@@ -153,6 +183,8 @@ void QuaZipPrivate::clearDirectoryMap()
 {
     directoryCaseInsensitive.clear();
     directoryCaseSensitive.clear();
+    dirIndex.reset();
+    ++directoryGeneration;
     lastMappedDirectoryEntry.num_of_file = 0;
     lastMappedDirectoryEntry.pos_in_zip_directory = 0;
 }
@@ -241,7 +273,9 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
       if (ioApi == NULL) {
           if (p->autoClose)
               flags |= UNZ_AUTO_CLOSE;
-          p->unzFile_f=unzOpenInternal(ioDevice, NULL, 1, flags);
+          zlib_filefunc64_32_def ioApi64;
+          p->fillIoApi(&ioApi64);
+          p->unzFile_f=unzOpenInternal(ioDevice, &ioApi64, 1, flags);
       } else {
           // QuaZIP pre-zip64 compatibility mode
           p->unzFile_f=unzOpen2(ioDevice, ioApi);
@@ -263,8 +297,7 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
                      "sequential devices");
             return false;
         }
-        p->mode=mode;
-        p->ioDevice = ioDevice;
+        p->setOpened(mode, ioDevice);
         return true;
       } else {
         p->zipError=UNZ_OPENERROR;
@@ -280,11 +313,13 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
               flags |= ZIP_AUTO_CLOSE;
           if (p->dataDescriptorWritingEnabled)
               flags |= ZIP_WRITE_DATA_DESCRIPTOR;
+          zlib_filefunc64_32_def ioApi64;
+          p->fillIoApi(&ioApi64);
           p->zipFile_f=zipOpen3(ioDevice,
               mode==mdCreate?APPEND_STATUS_CREATE:
               mode==mdAppend?APPEND_STATUS_CREATEAFTER:
               APPEND_STATUS_ADDINZIP,
-              NULL, NULL, flags);
+              NULL, &ioApi64, flags);
       } else {
           // QuaZIP pre-zip64 compatibility mode
           p->zipFile_f=zipOpen2(ioDevice,
@@ -310,8 +345,7 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
             }
             zipSetFlags(p->zipFile_f, ZIP_SEQUENTIAL);
         }
-        p->mode=mode;
-        p->ioDevice = ioDevice;
+        p->setOpened(mode, ioDevice);
         return true;
       } else {
         p->zipError=UNZ_OPENERROR;
@@ -355,10 +389,21 @@ void QuaZip::close()
       p->ioDevice = NULL;
   }
   p->clearDirectoryMap();
+  p->openId=0;
   if(p->zipError==UNZ_OK)
     p->mode=mdNotOpen;
 }
 
+int QuaZip::getOpenId() const
+{
+  return p->openId;
+}
+
+int QuaZip::getDirectoryGeneration() const
+{
+  return p->directoryGeneration;
+}
+
 void QuaZip::setZipName(const QString& zipName)
 {
   if(isOpen()) {
@@ -496,6 +541,31 @@ bool QuaZip::goToNextFile()
   return p->hasCurrentFile_f;
 }
 
+bool QuaZip::getCurrentFilePos(unz64_file_pos *pos)const
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::getCurrentFilePos(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  if(pos==NULL||!p->hasCurrentFile_f) return false;
+  p->zipError=unzGetFilePos64(p->unzFile_f, pos);
+  return p->zipError==UNZ_OK;
+}
+
+bool QuaZip::goToFilePos(const unz64_file_pos &pos)
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::goToFilePos(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  unz64_file_pos filePos=pos;
+  p->zipError=unzGoToFilePos64(p->unzFile_f, &filePos);
+  p->hasCurrentFile_f=p->zipError==UNZ_OK;
+  return p->hasCurrentFile_f;
+}
+
 bool QuaZip::getCurrentFileInfo(QuaZipFileInfo *info)const
 {
     QuaZipFileInfo64 info64;
@@ -576,14 +646,40 @@ QString QuaZip::getCurrentFileName()const
   return result;
 }
 
+QByteArray QuaZip::readCurrentFile(const char *password)
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::readCurrentFile(): ZIP is not open in mdUnzip mode");
+    return QByteArray();
+  }
+  if(!isOpen()||!hasCurrentFile()) return QByteArray();
+  unz_file_info64 info_z;
+  if((p->zipError=unzGetCurrentFileInfo64(p->unzFile_f, &info_z, NULL, 0,
+      NULL, 0, NULL, 0))!=UNZ_OK)
+    return QByteArray();
+  if(info_z.uncompressed_size>quint64(std::numeric_limits<int>::max())) {
+    qWarning("QuaZip::readCurrentFile(): file is too large for QByteArray");
+    p->zipError=UNZ_PARAMERROR;
+    return QByteArray();
+  }
+  QByteArray data(int(info_z.uncompressed_size), Qt::Uninitialized);
+  if((p->zipError=unzReadCurrentFileAtOnce(p->unzFile_f, data.data(),
+      info_z.uncompressed_size, password))!=UNZ_OK)
+    return QByteArray();
+  return data;
+}
+
 void QuaZip::setFileNameCodec(QTextCodec *fileNameCodec)
 {
   p->fileNameCodec=fileNameCodec;
+  p->clearDirectoryMap();
 }
 
 void QuaZip::setFileNameCodec(const char *fileNameCodecName)
 {
   p->fileNameCodec=QTextCodec::codecForName(fileNameCodecName);
+  p->clearDirectoryMap();
 }
 
 QTextCodec *QuaZip::getFileNameCodec()const
@@ -591,6 +687,34 @@ QTextCodec *QuaZip::getFileNameCodec()const
   return p->fileNameCodec;
 }
 
+const QuaZipDirIndex *QuaZip::getDirIndex()const
+{
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::getDirIndex(): ZIP is not open in mdUnzip mode");
+    return NULL;
+  }
+  if(!p->dirIndex.isNull())
+    return p->dirIndex.data();
+  QuaZip *fakeThis=const_cast<QuaZip*>(this); // non-const
+  bool hadCurrentFile=p->hasCurrentFile_f;
+  unz64_file_pos current;
+  if(hadCurrentFile)
+    unzGetFilePos64(p->unzFile_f, &current);
+  QScopedPointer<QuaZipDirIndex> index(new QuaZipDirIndex);
+  bool ok=index->build(fakeThis);
+  int error=p->zipError;
+  if(hadCurrentFile) {
+    p->hasCurrentFile_f=unzGoToFilePos64(p->unzFile_f, &current)==UNZ_OK;
+  } else {
+    p->hasCurrentFile_f=false;
+  }
+  p->zipError=error;
+  if(!ok)
+    return NULL;
+  p->dirIndex.swap(index);
+  return p->dirIndex.data();
+}
+
 void QuaZip::setCommentCodec(QTextCodec *commentCodec)
 {
   p->commentCodec=commentCodec;
@@ -700,10 +824,10 @@ bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
             "ZIP is not open in mdUnzip mode");
     return false;
   }
-  QString currentFile;
-  if (q->hasCurrentFile()) {
-      currentFile = q->getCurrentFileName();
-  }
+  bool hadCurrentFile = hasCurrentFile_f;
+  unz64_file_pos currentFile;
+  if (hadCurrentFile)
+      unzGetFilePos64(unzFile_f, &currentFile);
   if (q->goToFirstFile()) {
       do {
           bool ok;
@@ -714,14 +838,12 @@ bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
   }
   if (zipError != UNZ_OK)
       return false;
-  if (currentFile.isEmpty()) {
-      if (!q->goToFirstFile())
-          return false;
-  } else {
-      if (!q->setCurrentFile(currentFile))
-          return false;
-  }
-  return true;
+  if (!hadCurrentFile)
+      return q->goToFirstFile();
+  // restore by position, no need to look the name up again
+  fakeThis->zipError = unzGoToFilePos64(unzFile_f, &currentFile);
+  fakeThis->hasCurrentFile_f = zipError == UNZ_OK;
+  return hasCurrentFile_f;
 }
 
 QStringList QuaZip::getFileNameList() const
@@ -751,6 +873,108 @@ QList<QuaZipFileInfo64> QuaZip::getFileInfoList64() const
         return QList<QuaZipFileInfo64>();
 }
 
+QuaZipEntryTable QuaZip::getEntryTable() const
+{
+  QuaZipEntryTable table;
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::getEntryTable(): ZIP is not open in mdUnzip mode");
+    return table;
+  }
+  QuaZipEntryTablePrivate *d=table.d.data();
+  d->openId=p->openId;
+  d->fileNameCodec=p->fileNameCodec;
+  d->commentCodec=p->commentCodec;
+  bool hadCurrentFile=p->hasCurrentFile_f;
+  unz64_file_pos current;
+  if(hadCurrentFile)
+    unzGetFilePos64(p->unzFile_f, &current);
+  unz_global_info64 globalInfo;
+  if((p->zipError=unzGetGlobalInfo64(p->unzFile_f, &globalInfo))!=UNZ_OK)
+    return QuaZipEntryTable();
+  if(globalInfo.number_entry==0)
+    return table;
+  if(globalInfo.number_entry<=quint64(std::numeric_limits<int>::max()))
+    d->reserve(int(globalInfo.number_entry));
+  // the name length is stored in 2 bytes
+  QByteArray nameBuffer(0xFFFF, Qt::Uninitialized);
+  int error=unzGoToFirstFile(p->unzFile_f);
+  while(error==UNZ_OK) {
+    error=d->append(p->unzFile_f, nameBuffer);
+    if(error==UNZ_OK)
+      error=unzGoToNextFile(p->unzFile_f);
+  }
+  if(hadCurrentFile) {
+    p->hasCurrentFile_f=unzGoToFilePos64(p->unzFile_f, &current)==UNZ_OK;
+  } else {
+    p->hasCurrentFile_f=false;
+  }
+  if(error!=UNZ_END_OF_LIST_OF_FILE) {
+    p->zipError=error;
+    return QuaZipEntryTable();
+  }
+  d->squeeze();
+  return table;
+}
+
+bool QuaZip::forEachFile(const FileVisitor &visitor) const
+{
+  return forEachFile(QuaZipNameFilter(), visitor);
+}
+
+bool QuaZip::forEachFile(const QuaZipNameFilter &filter,
+    const FileVisitor &visitor) const
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::forEachFile(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  unz_global_info64 globalInfo;
+  if((p->zipError=unzGetGlobalInfo64(p->unzFile_f, &globalInfo))!=UNZ_OK)
+    return false;
+  if(globalInfo.number_entry==0)
+    return true;
+  bool hadCurrentFile=p->hasCurrentFile_f;
+  unz64_file_pos current;
+  if(hadCurrentFile)
+    unzGetFilePos64(p->unzFile_f, &current);
+  QuaZipNameMatcher matcher(filter, p->fileNameCodec);
+  bool matchesAll=filter.matchesAll();
+  // the name length is stored in 2 bytes
+  QByteArray nameBuffer(0xFFFF, Qt::Uninitialized);
+  unz_file_info64 info;
+  int index=0;
+  int error=unzGoToFirstFile(p->unzFile_f);
+  for(; error==UNZ_OK; ++index, error=unzGoToNextFile(p->unzFile_f)) {
+    error=unzGetCurrentFileInfo64(p->unzFile_f, &info, nameBuffer.data(),
+        uLong(nameBuffer.size()), NULL, 0, NULL, 0);
+    if(error!=UNZ_OK)
+      break;
+    int nameSize=int(info.size_filename);
+    if(!matchesAll&&!matcher.matches(nameBuffer.constData(), nameSize))
+      continue;
+    QuaZipEntryView entry(p->unzFile_f, index, info,
+        QByteArray::fromRawData(nameBuffer.constData(), nameSize),
+        p->fileNameCodec, p->commentCodec);
+    p->hasCurrentFile_f=true;
+    if(!visitor(entry)) {
+      error=UNZ_END_OF_LIST_OF_FILE;
+      break;
+    }
+  }
+  if(hadCurrentFile) {
+    p->hasCurrentFile_f=unzGoToFilePos64(p->unzFile_f, &current)==UNZ_OK;
+  } else {
+    p->hasCurrentFile_f=false;
+  }
+  if(error!=UNZ_END_OF_LIST_OF_FILE) {
+    p->zipError=error;
+    return false;
+  }
+  return true;
+}
+
 Qt::CaseSensitivity QuaZip::convertCaseSensitivity(QuaZip::CaseSensitivity cs)
 {
   if (cs == csDefault) {
@@ -784,6 +1008,40 @@ bool QuaZip::isZip64Enabled() const
     return p->zip64;
 }
 
+void QuaZipPrivate::fillIoApi(zlib_filefunc64_32_def *ioApi64) const
+{
+    fill_qiodevice64_filefunc(&ioApi64->zfile_func64);
+    ioApi64->zopen32_file = NULL;
+    ioApi64->ztell32_file = NULL;
+    ioApi64->zseek32_file = NULL;
+    QuaZAllocatorPrivate::fillAllocFunc(&ioApi64->zalloc_mem,
+        QuaZAllocatorPrivate::effective(allocator));
+}
+
+void QuaZipPrivate::setOpened(QuaZip::Mode mode, QIODevice *ioDevice)
+{
+    static QAtomicInt lastOpenId;
+    this->mode = mode;
+    this->ioDevice = ioDevice;
+    do {
+        openId = lastOpenId.fetchAndAddRelaxed(1) + 1;
+    } while (openId == 0);
+}
+
+QuaZAllocator *QuaZip::getAllocator() const
+{
+    return p->allocator;
+}
+
+void QuaZip::setAllocator(QuaZAllocator *allocator)
+{
+    if (isOpen()) {
+        qWarning("QuaZip::setAllocator(): ZIP is already open");
+        return;
+    }
+    p->allocator = allocator;
+}
+
 bool QuaZip::isAutoClose() const
 {
     return p->autoClose;
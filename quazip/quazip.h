@@ -29,6 +29,8 @@ quazip/(un)zip.h files for details, basically it's zlib license.
 #include <QStringList>
 #include <QTextCodec>
 
+#include <functional>
+
 #include "zip.h"
 #include "unzip.h"
 
@@ -41,7 +43,12 @@ quazip/(un)zip.h files for details, basically it's zlib license.
 #define UNZ_OPENERROR -1000
 #endif
 
+class QuaZAllocator;
 class QuaZipPrivate;
+class QuaZipDirIndex;
+class QuaZipEntryTable;
+class QuaZipEntryView;
+class QuaZipNameFilter;
 
 /// ZIP archive.
 /** \class QuaZip quazip.h <quazip/quazip.h>
@@ -84,6 +91,8 @@ class QuaZipPrivate;
 class QUAZIP_EXPORT QuaZip
 {
     friend class QuaZipPrivate;
+    friend class QuaZipDirPrivate;
+    friend class QuaZipEntryTablePrivate;
 
   public:
     /// Useful constants.
@@ -93,6 +102,8 @@ class QUAZIP_EXPORT QuaZip
                                  \c UNZ_MAXFILENAMEINZIP constant in
                                  unzip.c. */
     };
+    /// Called by forEachFile() for each entry, returns false to stop.
+    using FileVisitor = std::function<bool(const QuaZipEntryView &entry)>;
     /// Open mode of the ZIP file.
     enum Mode
     {
@@ -133,6 +144,23 @@ class QUAZIP_EXPORT QuaZip
 
   private:
     QuaZipPrivate *p;
+    /// Returns the directory tree, building it on the first call.
+    /**
+      Used by QuaZipDir. Only works in the mdUnzip mode, the current
+      file is kept. Returns NULL on error.
+      */
+    const QuaZipDirIndex *getDirIndex() const;
+    /// Returns an id that changes on each open(), 0 if not open.
+    /**
+      Used by QuaZipEntryTable to tell the archive it was listed from.
+      */
+    int getOpenId() const;
+    /// Returns an id that changes each time the directory tree is dropped.
+    /**
+      Used by QuaZipDir to tell a listing made with another file name
+      codec.
+      */
+    int getDirectoryGeneration() const;
     // not (and will not be) implemented
     QuaZip(const QuaZip &that);
     // not (and will not be) implemented
@@ -329,6 +357,21 @@ class QUAZIP_EXPORT QuaZip
      * \endcode
      **/
     bool goToNextFile();
+    /// Returns the position of the current file in the central directory.
+    /**
+     * The position can be passed to goToFilePos() later, which is
+     * faster than looking the file up by name.
+     *
+     * \return \c false if there is no current file or on error.
+     **/
+    bool getCurrentFilePos(unz64_file_pos *pos) const;
+    /// Sets the current file to the one at the position \a pos.
+    /**
+     * \param pos A position returned by getCurrentFilePos() or by
+     * QuaZipEntryView::filePos() for the same open archive.
+     * \return \c true on success.
+     **/
+    bool goToFilePos(const unz64_file_pos &pos);
     /// Sets current file by its name.
     /** Returns \c true if successful, \c false otherwise. Argument \a
      * cs specifies case sensitivity of the file name. Call
@@ -399,6 +442,21 @@ class QUAZIP_EXPORT QuaZip
      * Should be used only in QuaZip::mdUnzip mode.
      **/
     QString getCurrentFileName() const;
+    /// Reads the whole current file at once.
+    /** Allocates the uncompressed size from the central directory
+     * once, reads the compressed data with a single read and
+     * decompresses it with a single call, see
+     * unzReadCurrentFileAtOnce(). Much faster than QuaZipFile::readAll()
+     * for small files.
+     *
+     * The current file must not be opened by a QuaZipFile. Should be used
+     * only in QuaZip::mdUnzip mode.
+     *
+     * Returns an empty array on error, call getZipError() to tell it
+     * from an empty file. The CRC is checked, \c UNZ_CRCERROR is
+     * reported if it does not match.
+     **/
+    QByteArray readCurrentFile(const char *password = NULL);
     /// Returns \c unzFile handle.
     /** You can use this handle to directly call UNZIP part of the
      * ZIP/UNZIP package functions (see unzip.h).
@@ -488,6 +546,47 @@ class QUAZIP_EXPORT QuaZip
       \sa getFileInfoList()
       */
     QList<QuaZipFileInfo64> getFileInfoList64() const;
+    /// Returns a compact table of all files inside the archive.
+    /**
+      Reads the central directory once like getFileInfoList64(), but
+      without an object per entry, which matters for archives with
+      millions of entries. The current file is kept.
+
+      Returns an empty table on error, check getZipError() then.
+
+      \sa QuaZipEntryTable
+      */
+    QuaZipEntryTable getEntryTable() const;
+    /// Calls \a visitor for each file inside the archive, in order.
+    /**
+      Unlike getFileInfoList64(), nothing is collected: each entry is
+      read into a QuaZipEntryView that is reused for the next one, so
+      memory does not grow with the archive and the visitor gets the
+      first entry right away. The visitor returns false to stop.
+
+      The entry passed to the visitor is the current file during the
+      call, so the visitor may read it with QuaZipFile, closing it before
+      returning. It must not change the current file. After the visit,
+      the current file is restored, the archive must be open in the
+      mdUnzip mode.
+
+      \return false on error, check getZipError() then. Stopping the
+      visit is not an error.
+
+      \sa getEntryTable()
+      */
+    bool forEachFile(const FileVisitor &visitor) const;
+    /// Calls \a visitor for each file matching \a filter.
+    /**
+      \overload
+
+      The filter is checked on the raw names in the central directory,
+      so the names that do not match are skipped without being decoded.
+
+      \sa QuaZipNameFilter
+      */
+    bool forEachFile(
+        const QuaZipNameFilter &filter, const FileVisitor &visitor) const;
     /// Enables the zip64 mode.
     /**
      * @param zip64 If \c true, the zip64 mode is enabled, disabled otherwise.
@@ -537,6 +636,23 @@ class QUAZIP_EXPORT QuaZip
       @sa setIoDevice()
       */
     void setAutoClose(bool autoClose) const;
+    /// Returns the allocator for the archive structures.
+    /**
+      @sa setAllocator()
+      */
+    QuaZAllocator *getAllocator() const;
+    /// Sets the allocator for the archive structures.
+    /**
+      The allocator is used for the ZIP/UNZIP handles and buffers,
+      the central directory and comments, and the zlib state of the files
+      inside the archive opened with QuaZipFile. It must be set before
+      open() and outlive the archive.
+
+      If \a allocator is NULL, QuaZAllocator::globalAllocator() is used.
+      The archives opened with a custom \a ioApi passed to open() always
+      use the global allocator.
+      */
+    void setAllocator(QuaZAllocator *allocator);
     /// Sets the default file name codec to use.
     /**
      * The default codec is used by the constructors, so calling this function
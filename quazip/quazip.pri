@@ -1,6 +1,18 @@
 win32:INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
 unix:LIBS += -lz
 
+# Zstandard compression method (93), enable with CONFIG+=quazip_zstd
+quazip_zstd {
+    DEFINES += HAVE_ZSTD
+    LIBS += -lzstd
+}
+
+# libdeflate for whole-buffer decompression, enable with CONFIG+=quazip_libdeflate
+quazip_libdeflate {
+    DEFINES += HAVE_LIBDEFLATE
+    LIBS += -ldeflate
+}
+
 DEFINES += ZLIB_CONST
 
 DEPENDPATH += $$PWD
@@ -23,7 +35,25 @@ HEADERS += \
     $$PWD/quaziodevice_utils.h \
     $$PWD/quagzipdevice.h \
     $$PWD/private/quaziodeviceprivate.h \
-    $$PWD/quazextrafield.h
+    $$PWD/private/quazallocatorprivate.h \
+    $$PWD/private/quazipdirindex.h \
+    $$PWD/quazextrafield.h \
+    $$PWD/quazdictionary.h \
+    $$PWD/quazallocator.h \
+    $$PWD/quazcompressibility.h \
+    $$PWD/quazcompression.h \
+    $$PWD/quazipbuilder.h \
+    $$PWD/quazipentrytable.h \
+    $$PWD/quazipentryview.h \
+    $$PWD/quazipnamefilter.h \
+    $$PWD/private/quazipnamematcher.h \
+    $$PWD/private/quazipentrytableprivate.h \
+    $$PWD/private/quazippipeline.h \
+    $$PWD/private/quazipdirscanner.h \
+    $$PWD/private/quazipextractsink.h \
+    $$PWD/quazipextractor.h \
+    $$PWD/quazipcompressionpolicy.h \
+    $$PWD/zipcodec.h
 
 SOURCES += $$PWD/qioapi.cpp \
            $$PWD/JlCompress.cpp \
@@ -39,4 +69,18 @@ SOURCES += $$PWD/qioapi.cpp \
            $$PWD/zip.c \
     $$PWD/quagzipdevice.cpp \
     $$PWD/private/quaziodeviceprivate.cpp \
-    $$PWD/quazextrafield.cpp
+    $$PWD/private/quazipdirindex.cpp \
+    $$PWD/private/quazipdirscanner.cpp \
+    $$PWD/private/quazipextractsink.cpp \
+    $$PWD/quazextrafield.cpp \
+    $$PWD/quazdictionary.cpp \
+    $$PWD/quazallocator.cpp \
+    $$PWD/quazcompressibility.cpp \
+    $$PWD/quazcompression.cpp \
+    $$PWD/quazipbuilder.cpp \
+    $$PWD/quazipentrytable.cpp \
+    $$PWD/quazipentryview.cpp \
+    $$PWD/quazipnamefilter.cpp \
+    $$PWD/quazipextractor.cpp \
+    $$PWD/quazipcompressionpolicy.cpp \
+    $$PWD/zipcodec.c
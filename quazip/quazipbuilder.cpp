@@ -0,0 +1,297 @@
+#include "quazipbuilder.h"
+
+#include "quazcompression.h"
+
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <QVector>
+#include <QtEndian>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+const quint32 LOCAL_HEADER_SIGNATURE = 0x04034b50;
+const quint32 CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+const quint32 END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+const int LOCAL_HEADER_SIZE = 30;
+const int CENTRAL_HEADER_SIZE = 46;
+const int END_OF_CENTRAL_DIR_SIZE = 22;
+const int MAX_ENTRIES = 0xFFFF;
+const int MAX_NAME_SIZE = 0xFFFF;
+// Same as VERSIONMADEBY in zip.c
+const quint16 VERSION_MADE_BY = 0x031e;
+const quint16 VERSION_STORED = 10;
+const quint16 VERSION_DEFLATED = 20;
+const quint16 FLAG_UTF8 = 0x0800;
+const quint32 DIRECTORY_ATTRIBUTE = 0x10;
+
+struct Entry {
+    QByteArray name;
+    const QByteArray *data;
+    QByteArray compressed;
+    quint32 crc;
+    quint16 method;
+    quint16 flags;
+    bool directory;
+};
+
+quint32 dosDateTime(const QDateTime &dateTime)
+{
+    QDate date = dateTime.date();
+    QTime time = dateTime.time();
+    if (date.year() < 1980)
+        return (1 << 21) | (1 << 16); // 1980-01-01 00:00
+
+    return quint32(date.year() - 1980) << 25 | quint32(date.month()) << 21
+        | quint32(date.day()) << 16 | quint32(time.hour()) << 11
+        | quint32(time.minute()) << 5 | quint32(time.second() / 2);
+}
+
+void prepare(Entry &entry, int level)
+{
+    entry.method = 0;
+    entry.crc = 0;
+    if (entry.directory)
+        return;
+
+    const QByteArray &data = *entry.data;
+    entry.crc = quint32(crc32(crc32(0L, Z_NULL, 0),
+        reinterpret_cast<const Bytef *>(data.constData()), uInt(data.size())));
+    if (level == 0 || data.isEmpty())
+        return;
+
+    bool ok = false;
+    QByteArray compressed = QuaZCompression::compress(
+        data, QuaZCompression::Deflate, level, &ok);
+    if (ok && compressed.size() < data.size()) {
+        entry.compressed = compressed;
+        entry.method = Z_DEFLATED;
+    }
+}
+
+/// Prepares entries in turn until none is left.
+class PrepareTask : public QRunnable {
+public:
+    PrepareTask(Entry *entries, int count, QAtomicInt &next, int level,
+        QSemaphore *done)
+        : entries(entries)
+        , count(count)
+        , next(next)
+        , level(level)
+        , done(done)
+    {
+    }
+
+    virtual void run() override
+    {
+        forever {
+            int index = next.fetchAndAddRelaxed(1);
+            if (index >= count)
+                break;
+
+            prepare(entries[index], level);
+        }
+
+        if (done)
+            done->release();
+    }
+
+private:
+    Entry *entries;
+    int count;
+    QAtomicInt &next;
+    int level;
+    QSemaphore *done;
+};
+
+int storedSize(const Entry &entry)
+{
+    if (entry.directory)
+        return 0;
+
+    return entry.method == 0 ? entry.data->size() : entry.compressed.size();
+}
+
+char *put16(char *out, quint16 value)
+{
+    qToLittleEndian(value, out);
+    return out + 2;
+}
+
+char *put32(char *out, quint32 value)
+{
+    qToLittleEndian(value, out);
+    return out + 4;
+}
+
+char *putBytes(char *out, const char *data, int size)
+{
+    memcpy(out, data, size_t(size));
+    return out + size;
+}
+
+/// Writes the fields shared by the local and the central headers.
+char *putCommonFields(char *out, const Entry &entry, quint32 dosTime)
+{
+    out = put16(out, entry.method == 0 ? VERSION_STORED : VERSION_DEFLATED);
+    out = put16(out, entry.flags);
+    out = put16(out, entry.method);
+    out = put32(out, dosTime);
+    out = put32(out, entry.crc);
+    out = put32(out, quint32(storedSize(entry)));
+    out = put32(out,
+        quint32(entry.directory ? 0 : entry.data->size()));
+    out = put16(out, quint16(entry.name.size()));
+    return put16(out, 0); // extra field length
+}
+} // namespace
+
+QuaZipBuilder::QuaZipBuilder()
+    : level(Z_DEFAULT_COMPRESSION)
+    , pool(QThreadPool::globalInstance())
+{
+}
+
+int QuaZipBuilder::compressionLevel() const
+{
+    return level;
+}
+
+void QuaZipBuilder::setCompressionLevel(int level)
+{
+    this->level = level;
+}
+
+QDateTime QuaZipBuilder::dateTime() const
+{
+    return time;
+}
+
+void QuaZipBuilder::setDateTime(const QDateTime &dateTime)
+{
+    time = dateTime;
+}
+
+QThreadPool *QuaZipBuilder::threadPool() const
+{
+    return pool;
+}
+
+void QuaZipBuilder::setThreadPool(QThreadPool *pool)
+{
+    this->pool = pool;
+}
+
+QByteArray QuaZipBuilder::build(
+    const QMap<QString, QByteArray> &entries, bool *ok) const
+{
+    if (ok)
+        *ok = false;
+
+    if (entries.size() > MAX_ENTRIES) {
+        qWarning("QuaZipBuilder::build(): too many entries");
+        return QByteArray();
+    }
+
+    QVector<Entry> prepared;
+    prepared.reserve(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        Entry entry;
+        entry.name = it.key().toUtf8();
+        // the headers store the name length in 2 bytes
+        if (entry.name.size() > MAX_NAME_SIZE) {
+            qWarning("QuaZipBuilder::build(): entry name is too long");
+            return QByteArray();
+        }
+        entry.data = &it.value();
+        entry.directory = it.key().endsWith('/');
+        entry.flags = 0;
+        for (char c : entry.name) {
+            if (quint8(c) >= 0x80) {
+                entry.flags = FLAG_UTF8;
+                break;
+            }
+        }
+        prepared.append(entry);
+    }
+
+    // the calling thread works too, idle threads of the pool help it
+    QAtomicInt next(0);
+    QSemaphore done;
+    int helpers = 0;
+    if (pool) {
+        int wanted = qMin(pool->maxThreadCount(), prepared.size()) - 1;
+        for (; helpers < wanted; ++helpers) {
+            auto task = new PrepareTask(
+                prepared.data(), prepared.size(), next, level, &done);
+            if (!pool->tryStart(task)) {
+                delete task;
+                break;
+            }
+        }
+    }
+    PrepareTask(prepared.data(), prepared.size(), next, level, nullptr).run();
+    done.acquire(helpers);
+
+    qint64 centralSize = 0;
+    qint64 totalSize = END_OF_CENTRAL_DIR_SIZE;
+    for (const auto &entry : prepared) {
+        centralSize += CENTRAL_HEADER_SIZE + entry.name.size();
+        totalSize += LOCAL_HEADER_SIZE + entry.name.size() + storedSize(entry);
+    }
+    totalSize += centralSize;
+    if (totalSize > std::numeric_limits<int>::max()) {
+        qWarning("QuaZipBuilder::build(): the archive is too big");
+        return QByteArray();
+    }
+
+    quint32 dosTime = dosDateTime(
+        time.isNull() ? QDateTime::currentDateTime() : time);
+    QByteArray result(int(totalSize), Qt::Uninitialized);
+    char *out = result.data();
+    QVector<quint32> offsets;
+    offsets.reserve(prepared.size());
+    for (const auto &entry : prepared) {
+        offsets.append(quint32(out - result.constData()));
+        out = put32(out, LOCAL_HEADER_SIGNATURE);
+        out = putCommonFields(out, entry, dosTime);
+        out = putBytes(out, entry.name.constData(), entry.name.size());
+        if (entry.directory)
+            continue;
+
+        const QByteArray &data =
+            entry.method == 0 ? *entry.data : entry.compressed;
+        out = putBytes(out, data.constData(), data.size());
+    }
+
+    quint32 centralOffset = quint32(out - result.constData());
+    for (int i = 0; i < prepared.size(); ++i) {
+        const Entry &entry = prepared.at(i);
+        out = put32(out, CENTRAL_HEADER_SIGNATURE);
+        out = put16(out, VERSION_MADE_BY);
+        out = putCommonFields(out, entry, dosTime);
+        out = put16(out, 0); // comment length
+        out = put16(out, 0); // disk number
+        out = put16(out, 0); // internal attributes
+        out = put32(out, entry.directory ? DIRECTORY_ATTRIBUTE : 0);
+        out = put32(out, offsets.at(i));
+        out = putBytes(out, entry.name.constData(), entry.name.size());
+    }
+
+    out = put32(out, END_OF_CENTRAL_DIR_SIGNATURE);
+    out = put16(out, 0); // this disk
+    out = put16(out, 0); // disk with the central directory
+    out = put16(out, quint16(prepared.size()));
+    out = put16(out, quint16(prepared.size()));
+    out = put32(out, quint32(centralSize));
+    out = put32(out, centralOffset);
+    out = put16(out, 0); // comment length
+    Q_ASSERT(out == result.constData() + result.size());
+
+    if (ok)
+        *ok = true;
+    return result;
+}
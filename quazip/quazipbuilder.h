@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QMap>
+#include <QString>
+
+#include <zlib.h>
+
+#include "quazip_global.h"
+
+class QThreadPool;
+
+/// Builds a whole ZIP archive in memory from a map of names to data
+/**
+  The entries are deflated in parallel, then the size of the archive is
+  computed from the results and the headers and data are written into a
+  buffer allocated once. The entries are written in the order of the map
+  keys, so the same map and date give the same bytes.
+
+  Entries that do not get smaller are stored. Names ending with '/' are
+  written as directories, their data is ignored. Names are encoded in
+  UTF-8, with the language encoding flag set for non-ASCII names.
+
+  Example:
+  \code
+  QMap<QString, QByteArray> reports;
+  reports.insert("summary.csv", summary);
+  reports.insert("details/day1.csv", day1);
+  QByteArray zip = QuaZipBuilder().build(reports);
+  \endcode
+
+  The archive is limited to 65535 entries, names of 65535 bytes in UTF-8
+  and the size of a QByteArray, so it never needs the Zip64 extensions.
+
+  \sa QuaZCompression, JlCompress
+*/
+class QUAZIP_EXPORT QuaZipBuilder {
+public:
+    /// Constructs a builder with the default level and the global thread pool.
+    QuaZipBuilder();
+
+    /// Compression level, Z_DEFAULT_COMPRESSION by default.
+    int compressionLevel() const;
+    /// Sets the compression level, 0 to store all entries.
+    void setCompressionLevel(int level);
+
+    /// Modification time written for all entries.
+    /**
+      Null by default, which means the time when build() is called.
+      Set it to get the same archive from the same data.
+    */
+    QDateTime dateTime() const;
+    /// Sets the modification time written for all entries.
+    void setDateTime(const QDateTime &dateTime);
+
+    /// Thread pool used to compress the entries.
+    /**
+      QThreadPool::globalInstance() by default. The calling thread
+      compresses entries as well, and only idle threads of the pool
+      join it, so build() does not wait for unrelated jobs.
+    */
+    QThreadPool *threadPool() const;
+    /// Sets the thread pool, nullptr to compress in the calling thread only.
+    void setThreadPool(QThreadPool *pool);
+
+    /// Builds the archive.
+    /**
+      \param entries Data of the entries by name inside the archive.
+      \param ok Set to whether the archive was built, if not nullptr.
+      It fails if there are too many entries, a name is too long or the
+      archive is too big.
+      \return The archive, or an empty array on failure.
+    */
+    QByteArray build(
+        const QMap<QString, QByteArray> &entries, bool *ok = nullptr) const;
+
+private:
+    int level;
+    QDateTime time;
+    QThreadPool *pool;
+};
@@ -0,0 +1,226 @@
+#include "quazipcompressionpolicy.h"
+
+#include <QMimeDatabase>
+
+namespace {
+QRegExp compileGlob(const QString &glob)
+{
+    return QRegExp(glob, Qt::CaseInsensitive, QRegExp::Wildcard);
+}
+
+/// The file the rules are checked against.
+/**
+  The size and the MIME type are only found when a rule needs them, and
+  only once.
+*/
+class Subject {
+public:
+    /// A file on disk, examined if needed.
+    Subject(const QFileInfo &file, const QString &fileDest)
+        : fileName(file.fileName())
+        , fileDest(fileDest)
+        , file(&file)
+        , size(-1)
+        , detected(false)
+    {
+    }
+
+    /// A file examined and read before.
+    Subject(const QString &fileName, const QString &fileDest, qint64 size,
+        const QByteArray &head)
+        : fileName(QFileInfo(fileName).fileName())
+        , fileDest(fileDest)
+        , file(nullptr)
+        , size(size)
+        , head(head)
+        , detected(false)
+    {
+    }
+
+    qint64 fileSize()
+    {
+        if (size < 0)
+            size = file ? file->size() : 0;
+        return size;
+    }
+
+    const QMimeType &mimeType()
+    {
+        if (!detected) {
+            // the database is thread-safe and shared by all its instances
+            static const QMimeDatabase database;
+            type = file ? database.mimeTypeForFile(*file)
+                        : database.mimeTypeForFileNameAndData(fileName, head);
+            detected = true;
+        }
+        return type;
+    }
+
+    const QString fileName;
+    const QString fileDest;
+
+private:
+    const QFileInfo *file;
+    qint64 size;
+    QByteArray head;
+    QMimeType type;
+    bool detected;
+};
+
+/// Matches \a rule with its compiled \a pattern.
+bool matchesRule(const QuaZipCompressionPolicy::Rule &rule,
+    const QRegExp &pattern, Subject &subject)
+{
+    if (!rule.glob.isEmpty()) {
+        bool matchPath = rule.glob.contains('/');
+        if (!pattern.exactMatch(
+                matchPath ? subject.fileDest : subject.fileName)) {
+            return false;
+        }
+    }
+
+    if (rule.minSize > 0 || rule.maxSize >= 0) {
+        qint64 size = subject.fileSize();
+        if (size < rule.minSize || (rule.maxSize >= 0 && size > rule.maxSize))
+            return false;
+    }
+
+    if (!rule.mimeType.isEmpty()) {
+        const QMimeType &type = subject.mimeType();
+        if (rule.mimeType.endsWith("/*")) {
+            auto prefix = rule.mimeType.left(rule.mimeType.size() - 1);
+            if (!type.name().startsWith(prefix, Qt::CaseInsensitive))
+                return false;
+        } else if (!type.inherits(rule.mimeType)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QuaZipCompressionPolicy::Settings settingsForSubject(
+    const QList<QuaZipCompressionPolicy::Rule> &rules,
+    const QList<QRegExp> &patterns,
+    const QuaZipCompressionPolicy::Settings &defaults, Subject &subject)
+{
+    for (int i = 0; i < rules.size(); ++i) {
+        if (matchesRule(rules.at(i), patterns.at(i), subject))
+            return rules.at(i).settings;
+    }
+
+    return defaults;
+}
+} // namespace
+
+QuaZipCompressionPolicy::Settings::Settings(int method, int level, int strategy)
+    : method(method)
+    , level(level)
+    , strategy(strategy)
+{
+}
+
+QuaZipCompressionPolicy::Rule::Rule()
+    : minSize(0)
+    , maxSize(-1)
+{
+}
+
+QuaZipCompressionPolicy::QuaZipCompressionPolicy()
+    : autoStore(true)
+{
+}
+
+QuaZipCompressionPolicy::QuaZipCompressionPolicy(const Settings &defaults)
+    : defaults(defaults)
+    , autoStore(true)
+{
+}
+
+QuaZipCompressionPolicy::Settings
+QuaZipCompressionPolicy::defaultSettings() const
+{
+    return defaults;
+}
+
+void QuaZipCompressionPolicy::setDefaultSettings(const Settings &settings)
+{
+    defaults = settings;
+}
+
+bool QuaZipCompressionPolicy::isAutoStoreEnabled() const
+{
+    return autoStore;
+}
+
+void QuaZipCompressionPolicy::setAutoStoreEnabled(bool enabled)
+{
+    autoStore = enabled;
+}
+
+QList<QuaZipCompressionPolicy::Rule> QuaZipCompressionPolicy::rules() const
+{
+    return ruleList;
+}
+
+void QuaZipCompressionPolicy::addRule(const Rule &rule)
+{
+    ruleList.append(rule);
+    patterns.append(compileGlob(rule.glob));
+}
+
+void QuaZipCompressionPolicy::addRule(
+    const QString &glob, const Settings &settings)
+{
+    Rule rule;
+    rule.glob = glob;
+    rule.settings = settings;
+    addRule(rule);
+}
+
+void QuaZipCompressionPolicy::addSizeRule(
+    qint64 minSize, qint64 maxSize, const Settings &settings)
+{
+    Rule rule;
+    rule.minSize = minSize;
+    rule.maxSize = maxSize;
+    rule.settings = settings;
+    addRule(rule);
+}
+
+void QuaZipCompressionPolicy::addMimeRule(
+    const QString &mimeType, const Settings &settings)
+{
+    Rule rule;
+    rule.mimeType = mimeType;
+    rule.settings = settings;
+    addRule(rule);
+}
+
+void QuaZipCompressionPolicy::clearRules()
+{
+    ruleList.clear();
+    patterns.clear();
+}
+
+QuaZipCompressionPolicy::Settings QuaZipCompressionPolicy::settingsFor(
+    const QFileInfo &file, const QString &fileDest) const
+{
+    Subject subject(file, fileDest);
+    return settingsForSubject(ruleList, patterns, defaults, subject);
+}
+
+QuaZipCompressionPolicy::Settings QuaZipCompressionPolicy::settingsFor(
+    const QString &fileName, const QString &fileDest, qint64 size,
+    const QByteArray &head) const
+{
+    Subject subject(fileName, fileDest, size, head);
+    return settingsForSubject(ruleList, patterns, defaults, subject);
+}
+
+bool QuaZipCompressionPolicy::matches(
+    const Rule &rule, const QFileInfo &file, const QString &fileDest)
+{
+    Subject subject(file, fileDest);
+    return matchesRule(rule, compileGlob(rule.glob), subject);
+}
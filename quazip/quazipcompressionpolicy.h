@@ -0,0 +1,141 @@
+#pragma once
+
+#include <QFileInfo>
+#include <QList>
+#include <QRegExp>
+#include <QString>
+
+#include <zlib.h>
+
+#include "quazip_global.h"
+
+/// Chooses compression settings for each file added to an archive.
+/**
+  The policy holds a list of rules. Each rule matches files by a glob
+  pattern, a size range and a MIME type, all optional. The settings of the
+  first matching rule are used, or the default settings if no rule matches.
+
+  Example:
+  \code
+  QuaZipCompressionPolicy policy;
+  policy.addRule("*.log", {Z_DEFLATED, Z_BEST_COMPRESSION});
+  policy.addMimeRule("video/*", {0});
+  policy.addSizeRule(100 * 1024 * 1024, -1, {Z_DEFLATED, Z_BEST_SPEED});
+  JlCompress::compressDir("out.zip", "dir", true, QDir::Filters(), policy);
+  \endcode
+
+  \sa JlCompress
+*/
+class QUAZIP_EXPORT QuaZipCompressionPolicy {
+public:
+    /// Compression settings of a file.
+    struct Settings {
+        /// Compression method, Z_DEFLATED, 0 to store, or a method
+        /// with a codec, such as Z_ZSTD, see zipFindCodec().
+        int method;
+        /// Compression level.
+        int level;
+        /// Compression strategy, see deflateInit2() in zlib.
+        int strategy;
+
+        Settings(int method = Z_DEFLATED, int level = Z_DEFAULT_COMPRESSION,
+            int strategy = Z_DEFAULT_STRATEGY);
+    };
+
+    /// A rule to match files.
+    struct Rule {
+        /// Wildcard pattern, case insensitive. Matched against the path
+        /// inside the archive if it contains '/', against the file name
+        /// otherwise. Empty pattern matches any file.
+        QString glob;
+        /// Minimum file size in bytes.
+        qint64 minSize;
+        /// Maximum file size in bytes, -1 for no limit.
+        qint64 maxSize;
+        /// MIME type, such as "text/plain" or "image/*". The file matches
+        /// also if its type inherits this one. Empty matches any file.
+        QString mimeType;
+        /// Settings for matched files.
+        Settings settings;
+
+        Rule();
+    };
+
+    /// Constructs a policy without rules and with default settings.
+    QuaZipCompressionPolicy();
+    /// Constructs a policy without rules.
+    /**
+      \param defaults The settings for files not matched by any rule.
+    */
+    explicit QuaZipCompressionPolicy(const Settings &defaults);
+
+    /// The settings for files not matched by any rule.
+    Settings defaultSettings() const;
+    /// Sets the settings for files not matched by any rule.
+    void setDefaultSettings(const Settings &settings);
+
+    /// Returns whether incompressible files are stored.
+    /**
+      The default is \c true. Applies only to files deflated by the policy.
+      The entries of these files are only opened in the archive once a
+      sample of their data is written, so the errors of opening them are
+      reported by the writes.
+
+      \sa QuaZipFile::setAutoStoreEnabled()
+    */
+    bool isAutoStoreEnabled() const;
+    /// Sets whether incompressible files are stored.
+    void setAutoStoreEnabled(bool enabled);
+
+    /// The rules in the order they are checked.
+    QList<Rule> rules() const;
+    /// Adds a rule checked after the ones already added.
+    void addRule(const Rule &rule);
+    /// Adds a rule matching files by a wildcard pattern.
+    void addRule(const QString &glob, const Settings &settings);
+    /// Adds a rule matching files by size.
+    /**
+      \param minSize Minimum file size in bytes.
+      \param maxSize Maximum file size in bytes, -1 for no limit.
+      \param settings Settings for matched files.
+    */
+    void addSizeRule(qint64 minSize, qint64 maxSize, const Settings &settings);
+    /// Adds a rule matching files by MIME type.
+    void addMimeRule(const QString &mimeType, const Settings &settings);
+    /// Removes all the rules.
+    void clearRules();
+
+    /// Returns the settings for a file.
+    /**
+      The size and the MIME type are only read if a rule needs them, and
+      only once.
+
+      \param file The file to compress.
+      \param fileDest The path of the file inside the archive.
+    */
+    Settings settingsFor(const QFileInfo &file, const QString &fileDest) const;
+    /// Returns the settings for a file examined and read before.
+    /**
+      Nothing is read from the file system, which suits files that are
+      read anyway to be compressed.
+
+      \param fileName The path or the name of the file.
+      \param fileDest The path of the file inside the archive.
+      \param size The size of the file.
+      \param head The start of the file, used with the name to detect the
+      MIME type if a rule needs it.
+    */
+    Settings settingsFor(const QString &fileName, const QString &fileDest,
+        qint64 size, const QByteArray &head) const;
+
+    /// Returns true if the rule matches the file.
+    static bool matches(
+        const Rule &rule, const QFileInfo &file, const QString &fileDest);
+
+private:
+    QList<Rule> ruleList;
+    /// The glob patterns of the rules, compiled when they are added.
+    QList<QRegExp> patterns;
+    Settings defaults;
+    bool autoStore;
+};
@@ -23,8 +23,9 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "quazipdir.h"
+#include "private/quazipdirindex.h"
 
-#include <QSet>
+#include <QScopedPointer>
 #include <QSharedData>
 
 /// \cond internal
@@ -33,7 +34,8 @@ class QuaZipDirPrivate: public QSharedData {
 private:
     QuaZipDirPrivate(QuaZip *zip, const QString &dir = QString()):
         zip(zip), dir(dir), caseSensitivity(QuaZip::csDefault),
-        filter(QDir::NoFilter), sorting(QDir::NoSort) {}
+        filter(QDir::NoFilter), sorting(QDir::NoSort), listingOpenId(0),
+        listingGeneration(0) {}
     QuaZip *zip;
     QString dir;
     QuaZip::CaseSensitivity caseSensitivity;
@@ -44,6 +46,21 @@ private:
     bool entryInfoList(QStringList nameFilters, QDir::Filters filter,
         QDir::SortFlags sort, TFileInfoList &result) const;
     inline QString simplePath() const {return QDir::cleanPath(dir);}
+    /// Node of this directory in the index of the archive, or -1.
+    int findNode(const QuaZipDirIndex *index) const;
+    /// The entry list with the default arguments, listed once.
+    /**
+      Kept until the directory, the filters, the sorting or the archive
+      change, so that count() and operator[]() do not list it again.
+      */
+    const QStringList &defaultList() const;
+    inline void resetListing() {listingOpenId = 0;}
+    mutable QStringList listing;
+    /// QuaZip::getOpenId() of the archive listed, 0 if not listed.
+    mutable int listingOpenId;
+    /// QuaZip::getDirectoryGeneration() of the archive listed.
+    mutable int listingGeneration;
+    mutable QString listingDir;
 };
 /// \endcond
 
@@ -76,7 +93,7 @@ QuaZipDir& QuaZipDir::operator=(const QuaZipDir &that)
 
 QString QuaZipDir::operator[](int pos) const
 {
-    return entryList().at(pos);
+    return d->defaultList().at(pos);
 }
 
 QuaZip::CaseSensitivity QuaZipDir::caseSensitivity() const
@@ -154,7 +171,7 @@ bool QuaZipDir::cdUp()
 
 uint QuaZipDir::count() const
 {
-    return entryList().count();
+    return d->defaultList().count();
 }
 
 QString QuaZipDir::dirName() const
@@ -185,6 +202,15 @@ QuaZipFileInfo64 QuaZipDir_getFileInfo(QuaZip *zip, bool *ok,
     return info;
 }
 
+int QuaZipDirPrivate::findNode(const QuaZipDirIndex *index) const
+{
+    // the names are compared as is, like the prefix of the entry names
+    QString path = simplePath();
+    if (path == ".")
+        path.clear();
+    return index->findDir(path, Qt::CaseSensitive);
+}
+
 static void QuaZipDir_convertInfoList(const QList<QuaZipFileInfo64> &from,
                                       QList<QuaZipFileInfo64> &to)
 {
@@ -215,6 +241,17 @@ static void QuaZipDir_convertInfoList(const QList<QuaZipFileInfo64> &from,
     }
 }
 
+static inline bool QuaZipDir_isNameList(const QStringList &)
+{
+    return true;
+}
+
+template<typename TFileInfoList>
+static inline bool QuaZipDir_isNameList(const TFileInfoList &)
+{
+    return false;
+}
+
 /// \cond internal
 /**
   An utility class to restore the current file.
@@ -323,15 +360,13 @@ template<typename TFileInfoList>
 bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters, 
     QDir::Filters filter, QDir::SortFlags sort, TFileInfoList &result) const
 {
-    QString basePath = simplePath();
-    if (!basePath.isEmpty())
-        basePath += "/";
-    int baseLength = basePath.length();
     result.clear();
-    QuaZipDirRestoreCurrent saveCurrent(zip);
-    if (!zip->goToFirstFile()) {
+    const QuaZipDirIndex *index = zip->getDirIndex();
+    if (index == NULL)
         return zip->getZipError() == UNZ_OK;
-    }
+    int node = findNode(index);
+    if (node < 0)
+        return true;
     QDir::Filters fltr = filter;
     if (fltr == QDir::NoFilter)
         fltr = this->filter;
@@ -340,33 +375,43 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
     QStringList nmfltr = nameFilters;
     if (nmfltr.isEmpty())
         nmfltr = this->nameFilters;
-    QSet<QString> dirsFound;
+    QDir::SortFlags srt = sort;
+    if (srt == QDir::NoSort)
+        srt = sorting;
+    // the names are enough unless the entries are sorted by their info
+    QDir::SortFlags order = srt
+        & (QDir::Name | QDir::Time | QDir::Size | QDir::Type);
+    bool needInfo = !QuaZipDir_isNameList(result)
+        || (srt != QDir::NoSort && (srt & QDir::Unsorted) != QDir::Unsorted
+            && (order == QDir::Time || order == QDir::Size));
+    QScopedPointer<QuaZipDirRestoreCurrent> saveCurrent;
+    if (needInfo)
+        saveCurrent.reset(new QuaZipDirRestoreCurrent(zip));
     QList<QuaZipFileInfo64> list;
-    do {
-        QString name = zip->getCurrentFileName();
-        if (!name.startsWith(basePath))
-            continue;
-        QString relativeName = name.mid(baseLength);
-        if (relativeName.isEmpty())
-            continue;
-        bool isDir = false;
-        bool isReal = true;
-        if (relativeName.contains('/')) {
-            int indexOfSlash = relativeName.indexOf('/');
-            // something like "subdir/"
-            isReal = indexOfSlash == relativeName.length() - 1;
-            relativeName = relativeName.left(indexOfSlash + 1);
-            if (dirsFound.contains(relativeName))
-                continue;
-            isDir = true;
-        }
-        dirsFound.insert(relativeName);
+    const QVector<int> &children = index->node(node).children;
+    for (QVector<int>::const_iterator i = children.constBegin();
+            i != children.constEnd();
+            ++i) {
+        const QuaZipDirIndex::Node &child = index->node(*i);
+        const QString &relativeName = child.name;
+        bool isDir = index->isDir(*i);
         if ((fltr & QDir::Dirs) == 0 && isDir)
             continue;
         if ((fltr & QDir::Files) == 0 && !isDir)
             continue;
         if (!nmfltr.isEmpty() && !QDir::match(nmfltr, relativeName))
             continue;
+        if (!needInfo) {
+            QuaZipFileInfo64 info;
+            info.name = relativeName;
+            list.append(info);
+            continue;
+        }
+        bool isReal = child.isReal;
+        // by position, a name could be found at another entry
+        if (isReal && !zip->goToFilePos(child.pos)) {
+            return false;
+        }
         bool ok;
         QuaZipFileInfo64 info = QuaZipDir_getFileInfo(zip, &ok, relativeName,
             isReal);
@@ -374,10 +419,7 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
             return false;
         }
         list.append(info);
-    } while (zip->goToNextFile());
-    QDir::SortFlags srt = sort;
-    if (srt == QDir::NoSort)
-        srt = sorting;
+    }
 #ifdef QUAZIP_QUAZIPDIR_DEBUG
     qDebug("QuaZipDirPrivate::entryInfoList(): before sort:");
     foreach (QuaZipFileInfo64 info, list) {
@@ -396,6 +438,25 @@ bool QuaZipDirPrivate::entryInfoList(QStringList nameFilters,
     return true;
 }
 
+const QStringList &QuaZipDirPrivate::defaultList() const
+{
+    int openId = zip->getOpenId();
+    int generation = zip->getDirectoryGeneration();
+    if (openId != 0 && openId == listingOpenId
+            && generation == listingGeneration && listingDir == dir)
+        return listing;
+    listingOpenId = 0;
+    if (!entryInfoList(QStringList(), QDir::NoFilter, QDir::NoSort,
+            listing)) {
+        listing.clear();
+        return listing;
+    }
+    listingOpenId = openId;
+    listingGeneration = generation;
+    listingDir = dir;
+    return listing;
+}
+
 /// \endcond
 
 QList<QuaZipFileInfo> QuaZipDir::entryInfoList(const QStringList &nameFilters,
@@ -433,6 +494,9 @@ QList<QuaZipFileInfo64> QuaZipDir::entryInfoList64(QDir::Filters filters,
 QStringList QuaZipDir::entryList(const QStringList &nameFilters,
     QDir::Filters filters, QDir::SortFlags sort) const
 {
+    if (nameFilters.isEmpty() && filters == QDir::NoFilter
+            && sort == QDir::NoSort)
+        return d->defaultList();
     QStringList result;
     if (d->entryInfoList(nameFilters, filters, sort, result))
         return result;
@@ -469,25 +533,27 @@ bool QuaZipDir::exists(const QString &filePath) const
         } else if (fileName == ".") {
             return true;
         } else {
-            QStringList entries = entryList(QDir::AllEntries, QDir::NoSort);
 #ifdef QUAZIP_QUAZIPDIR_DEBUG
             qDebug("QuaZipDir::exists(): looking for %s",
                     fileName.toUtf8().constData());
-            for (QStringList::const_iterator i = entries.constBegin();
-                    i != entries.constEnd();
-                    ++i) {
-                qDebug("QuaZipDir::exists(): entry: %s",
-                        i->toUtf8().constData());
-            }
 #endif
+            const QuaZipDirIndex *index = d->zip->getDirIndex();
+            if (index == NULL)
+                return false;
+            int node = d->findNode(index);
+            if (node < 0)
+                return false;
             Qt::CaseSensitivity cs = QuaZip::convertCaseSensitivity(
                     d->caseSensitivity);
-            if (filePath.endsWith('/')) {
-                return entries.contains(filePath, cs);
-            } else {
-                return entries.contains(fileName, cs)
-                    || entries.contains(fileName + "/", cs);
-            }
+            int child = -1;
+            if (!filePath.endsWith('/'))
+                child = index->findChild(node, fileName, cs);
+            if (child < 0)
+                child = index->findChild(node, fileName + "/", cs);
+            if (child < 0)
+                return false;
+            return d->nameFilters.isEmpty()
+                || QDir::match(d->nameFilters, index->node(child).name);
         }
     }
 }
@@ -530,16 +596,19 @@ QString QuaZipDir::relativeFilePath(const QString &fileName) const
 void QuaZipDir::setCaseSensitivity(QuaZip::CaseSensitivity caseSensitivity)
 {
     d->caseSensitivity = caseSensitivity;
+    d->resetListing();
 }
 
 void QuaZipDir::setFilter(QDir::Filters filters)
 {
     d->filter = filters;
+    d->resetListing();
 }
 
 void QuaZipDir::setNameFilters(const QStringList &nameFilters)
 {
     d->nameFilters = nameFilters;
+    d->resetListing();
 }
 
 void QuaZipDir::setPath(const QString &path)
@@ -559,6 +628,7 @@ void QuaZipDir::setPath(const QString &path)
 void QuaZipDir::setSorting(QDir::SortFlags sort)
 {
     d->sorting = sort;
+    d->resetListing();
 }
 
 QDir::SortFlags QuaZipDir::sorting() const
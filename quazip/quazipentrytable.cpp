@@ -0,0 +1,264 @@
+#include "quazipentrytable.h"
+
+#include "quazip.h"
+#include "quazipentryview.h"
+#include "private/quazipentrytableprivate.h"
+#include "private/quazipnamematcher.h"
+
+#include <QTextCodec>
+
+#include <limits>
+
+int QuaZipEntryTablePrivate::append(unzFile file, QByteArray &nameBuffer)
+{
+    unz_file_info64 info;
+    int error = unzGetCurrentFileInfo64(file, &info, nameBuffer.data(),
+        uLong(nameBuffer.size()), nullptr, 0, nullptr, 0);
+    if (error != UNZ_OK)
+        return error;
+
+    int nameSize = int(info.size_filename);
+    if (nameSize > std::numeric_limits<int>::max() - names.size())
+        return UNZ_INTERNALERROR;
+
+    unz64_file_pos position;
+    error = unzGetFilePos64(file, &position);
+    if (error != UNZ_OK)
+        return error;
+
+    names.append(nameBuffer.constData(), nameSize);
+    nameOffsets.append(names.size());
+    compressedSizes.append(info.compressed_size);
+    uncompressedSizes.append(info.uncompressed_size);
+    crcs.append(quint32(info.crc));
+    dosDates.append(quint32(info.dosDate));
+    externalAttrs.append(quint32(info.external_fa));
+    versionsCreated.append(quint16(info.version));
+    versionsNeeded.append(quint16(info.version_needed));
+    flags.append(quint16(info.flag));
+    methods.append(quint16(info.compression_method));
+    internalAttrs.append(quint16(info.internal_fa));
+    extraSizes.append(quint16(info.size_file_extra));
+    commentSizes.append(quint16(info.size_file_comment));
+    positions.append(position);
+    return UNZ_OK;
+}
+
+void QuaZipEntryTablePrivate::reserve(int count)
+{
+    nameOffsets.reserve(count + 1);
+    compressedSizes.reserve(count);
+    uncompressedSizes.reserve(count);
+    crcs.reserve(count);
+    dosDates.reserve(count);
+    externalAttrs.reserve(count);
+    versionsCreated.reserve(count);
+    versionsNeeded.reserve(count);
+    flags.reserve(count);
+    methods.reserve(count);
+    internalAttrs.reserve(count);
+    extraSizes.reserve(count);
+    commentSizes.reserve(count);
+    positions.reserve(count);
+}
+
+void QuaZipEntryTablePrivate::squeeze()
+{
+    names.squeeze();
+    nameOffsets.squeeze();
+    compressedSizes.squeeze();
+    uncompressedSizes.squeeze();
+    crcs.squeeze();
+    dosDates.squeeze();
+    externalAttrs.squeeze();
+    versionsCreated.squeeze();
+    versionsNeeded.squeeze();
+    flags.squeeze();
+    methods.squeeze();
+    internalAttrs.squeeze();
+    extraSizes.squeeze();
+    commentSizes.squeeze();
+    positions.squeeze();
+}
+
+bool QuaZipEntryTablePrivate::readVariable(
+    QuaZip *zip, int index, QByteArray *extra, QByteArray *comment) const
+{
+    // the positions are only valid in the central directory listed
+    if (!zip || openId == 0 || zip->getOpenId() != openId
+        || zip->getMode() != QuaZip::mdUnzip) {
+        return false;
+    }
+
+    unzFile file = zip->getUnzFile();
+    unz64_file_pos current;
+    bool hasCurrent = zip->hasCurrentFile();
+    if (hasCurrent && unzGetFilePos64(file, &current) != UNZ_OK)
+        return false;
+
+    unz64_file_pos position = positions.at(index);
+    bool ok = unzGoToFilePos64(file, &position) == UNZ_OK;
+    if (ok) {
+        if (extra)
+            extra->resize(extraSizes.at(index));
+        if (comment)
+            comment->resize(commentSizes.at(index));
+        ok = unzGetCurrentFileInfo64(file, nullptr, nullptr, 0,
+                 extra ? extra->data() : nullptr,
+                 extra ? uLong(extra->size()) : 0,
+                 comment ? comment->data() : nullptr,
+                 comment ? uLong(comment->size()) : 0)
+            == UNZ_OK;
+    }
+
+    if (hasCurrent)
+        unzGoToFilePos64(file, &current);
+
+    return ok;
+}
+
+QuaZipEntryTable::QuaZipEntryTable()
+    : d(new QuaZipEntryTablePrivate)
+{
+}
+
+QuaZipEntryTable::QuaZipEntryTable(const QuaZipEntryTable &other)
+    : d(other.d)
+{
+}
+
+QuaZipEntryTable::~QuaZipEntryTable()
+{
+}
+
+QuaZipEntryTable &QuaZipEntryTable::operator=(const QuaZipEntryTable &other)
+{
+    d = other.d;
+    return *this;
+}
+
+int QuaZipEntryTable::count() const
+{
+    return d->positions.size();
+}
+
+bool QuaZipEntryTable::isEmpty() const
+{
+    return d->positions.isEmpty();
+}
+
+QString QuaZipEntryTable::name(int index) const
+{
+    int start = d->nameOffsets.at(index);
+    int size = d->nameOffsets.at(index + 1) - start;
+    if (!d->fileNameCodec)
+        return QString::fromLocal8Bit(d->names.constData() + start, size);
+
+    return d->fileNameCodec->toUnicode(d->names.constData() + start, size);
+}
+
+QByteArray QuaZipEntryTable::rawName(int index) const
+{
+    int start = d->nameOffsets.at(index);
+    return QByteArray::fromRawData(d->names.constData() + start,
+        d->nameOffsets.at(index + 1) - start);
+}
+
+quint16 QuaZipEntryTable::versionCreated(int index) const
+{
+    return d->versionsCreated.at(index);
+}
+
+quint16 QuaZipEntryTable::versionNeeded(int index) const
+{
+    return d->versionsNeeded.at(index);
+}
+
+quint16 QuaZipEntryTable::flags(int index) const
+{
+    return d->flags.at(index);
+}
+
+quint16 QuaZipEntryTable::method(int index) const
+{
+    return d->methods.at(index);
+}
+
+quint32 QuaZipEntryTable::dosDateTime(int index) const
+{
+    return d->dosDates.at(index);
+}
+
+QDateTime QuaZipEntryTable::dateTime(int index) const
+{
+    return QuaZipEntryView::fromDosDateTime(d->dosDates.at(index));
+}
+
+quint32 QuaZipEntryTable::crc(int index) const
+{
+    return d->crcs.at(index);
+}
+
+quint64 QuaZipEntryTable::compressedSize(int index) const
+{
+    return d->compressedSizes.at(index);
+}
+
+quint64 QuaZipEntryTable::uncompressedSize(int index) const
+{
+    return d->uncompressedSizes.at(index);
+}
+
+quint16 QuaZipEntryTable::internalAttr(int index) const
+{
+    return d->internalAttrs.at(index);
+}
+
+quint32 QuaZipEntryTable::externalAttr(int index) const
+{
+    return d->externalAttrs.at(index);
+}
+
+bool QuaZipEntryTable::isDir(int index) const
+{
+    int end = d->nameOffsets.at(index + 1);
+    return end > d->nameOffsets.at(index) && d->names.at(end - 1) == '/';
+}
+
+QVector<int> QuaZipEntryTable::matching(const QuaZipNameFilter &filter) const
+{
+    QVector<int> result;
+    QuaZipNameMatcher matcher(filter,
+        d->fileNameCodec ? d->fileNameCodec : QTextCodec::codecForLocale());
+    for (int i = 0; i < count(); ++i) {
+        int start = d->nameOffsets.at(i);
+        if (matcher.matches(d->names.constData() + start,
+                d->nameOffsets.at(i + 1) - start)) {
+            result.append(i);
+        }
+    }
+    return result;
+}
+
+QByteArray QuaZipEntryTable::extra(QuaZip *zip, int index) const
+{
+    Q_ASSERT(index >= 0 && index < count());
+    QByteArray result;
+    if (!d->readVariable(zip, index, &result, nullptr))
+        return QByteArray();
+
+    return result;
+}
+
+QString QuaZipEntryTable::comment(QuaZip *zip, int index) const
+{
+    Q_ASSERT(index >= 0 && index < count());
+    QByteArray result;
+    if (!d->readVariable(zip, index, nullptr, &result))
+        return QString();
+
+    if (!d->commentCodec)
+        return QString::fromLocal8Bit(result);
+
+    return d->commentCodec->toUnicode(result);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QSharedDataPointer>
+#include <QString>
+#include <QVector>
+
+#include "quazip_global.h"
+
+class QuaZip;
+class QuaZipNameFilter;
+class QuaZipEntryTablePrivate;
+
+/// Compact read-only table of the entries of an archive
+/**
+  Returned by QuaZip::getEntryTable(). Unlike QuaZip::getFileInfoList64(),
+  it does not create an object per entry: the numeric fields are kept in
+  one array per field, the raw names are kept in one shared buffer, and
+  the rest is only decoded or read when asked for.
+
+  Entries are addressed by their index in the central directory, so
+  listings can be sorted by sorting the indexes:
+  \code
+  QuaZipEntryTable table = zip.getEntryTable();
+  QVector<int> bySize(table.count());
+  std::iota(bySize.begin(), bySize.end(), 0);
+  std::sort(bySize.begin(), bySize.end(), [&table](int a, int b) {
+      return table.uncompressedSize(a) < table.uncompressedSize(b);
+  });
+  \endcode
+
+  The table is implicitly shared and does not refer to the QuaZip instance
+  that returned it. comment() and extra() read the central directory of
+  the archive, so they take that instance, which must not have been closed
+  since. Everything else is kept in the table itself.
+
+  \sa QuaZipFileInfo64
+*/
+class QUAZIP_EXPORT QuaZipEntryTable {
+    friend class QuaZip;
+
+public:
+    /// Constructs an empty table.
+    QuaZipEntryTable();
+    QuaZipEntryTable(const QuaZipEntryTable &other);
+    ~QuaZipEntryTable();
+    QuaZipEntryTable &operator=(const QuaZipEntryTable &other);
+
+    /// Number of the entries.
+    int count() const;
+    bool isEmpty() const;
+
+    /// File name decoded with the file name codec of the archive.
+    QString name(int index) const;
+    /// File name as stored in the archive.
+    /**
+      The array refers to the buffer of the table, so it must not outlive
+      the table.
+    */
+    QByteArray rawName(int index) const;
+    quint16 versionCreated(int index) const;
+    quint16 versionNeeded(int index) const;
+    quint16 flags(int index) const;
+    quint16 method(int index) const;
+    /// Modification time in the MS-DOS format.
+    quint32 dosDateTime(int index) const;
+    /// Modification time, decoded from dosDateTime().
+    QDateTime dateTime(int index) const;
+    quint32 crc(int index) const;
+    quint64 compressedSize(int index) const;
+    quint64 uncompressedSize(int index) const;
+    quint16 internalAttr(int index) const;
+    quint32 externalAttr(int index) const;
+    /// Whether the name ends with '/'.
+    bool isDir(int index) const;
+    /// Indexes of the entries whose names match \a filter, in order.
+    /**
+      The filter is checked on the raw names, so the names that do not
+      match are not decoded.
+    */
+    QVector<int> matching(const QuaZipNameFilter &filter) const;
+
+    /// Extra field of the central header, read from \a zip.
+    /**
+      \a zip must be the instance that returned the table. Returns an
+      empty array if it was closed or reopened since, or if the archive
+      can not be read. The current file of the archive is kept.
+    */
+    QByteArray extra(QuaZip *zip, int index) const;
+    /// File comment decoded with the comment codec, read from \a zip.
+    /**
+      \sa extra()
+    */
+    QString comment(QuaZip *zip, int index) const;
+
+private:
+    QSharedDataPointer<QuaZipEntryTablePrivate> d;
+};
@@ -0,0 +1,69 @@
+#include "quazipentryview.h"
+
+#include <QTextCodec>
+
+QuaZipEntryView::QuaZipEntryView(unzFile file, int index,
+    const unz_file_info64 &info, const QByteArray &name,
+    QTextCodec *fileNameCodec, QTextCodec *commentCodec)
+    : file(file)
+    , entryIndex(index)
+    , info(info)
+    , nameBytes(name)
+    , fileNameCodec(fileNameCodec)
+    , commentCodec(commentCodec)
+{
+}
+
+QString QuaZipEntryView::name() const
+{
+    return fileNameCodec->toUnicode(nameBytes);
+}
+
+unz64_file_pos QuaZipEntryView::filePos() const
+{
+    unz64_file_pos result;
+    if (unzGetFilePos64(file, &result) != UNZ_OK) {
+        result.pos_in_zip_directory = 0;
+        result.num_of_file = 0;
+    }
+    return result;
+}
+
+quint64 QuaZipEntryView::headerPos() const
+{
+    return unzGetCurrentFileHeaderPos64(file);
+}
+
+QByteArray QuaZipEntryView::extra() const
+{
+    QByteArray result(int(info.size_file_extra), Qt::Uninitialized);
+    if (unzGetCurrentFileInfo64(file, nullptr, nullptr, 0, result.data(),
+            uLong(result.size()), nullptr, 0)
+        != UNZ_OK) {
+        return QByteArray();
+    }
+
+    return result;
+}
+
+QString QuaZipEntryView::comment() const
+{
+    QByteArray result(int(info.size_file_comment), Qt::Uninitialized);
+    if (unzGetCurrentFileInfo64(file, nullptr, nullptr, 0, nullptr, 0,
+            result.data(), uLong(result.size()))
+        != UNZ_OK) {
+        return QString();
+    }
+
+    return commentCodec->toUnicode(result);
+}
+
+QDateTime QuaZipEntryView::fromDosDateTime(quint32 dosDateTime)
+{
+    quint32 date = dosDateTime >> 16;
+    return QDateTime(
+        QDate(int(((date & 0xFE00) >> 9) + 1980), int((date & 0x1E0) >> 5),
+            int(date & 0x1F)),
+        QTime(int((dosDateTime & 0xF800) >> 11),
+            int((dosDateTime & 0x7E0) >> 5), int(2 * (dosDateTime & 0x1F))));
+}
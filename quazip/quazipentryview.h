@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+
+#include "quazip_global.h"
+#include "unzip.h"
+
+class QTextCodec;
+
+/// Entry of an archive passed to the visitor of QuaZip::forEachFile()
+/**
+  A view only refers to the data that QuaZip has already read for the
+  entry, and decodes the name and the date when asked for. It is only
+  valid inside the visitor call, copy the values that are needed later.
+
+  \sa QuaZipFileInfo64, QuaZipEntryTable
+*/
+class QUAZIP_EXPORT QuaZipEntryView {
+    friend class QuaZip;
+
+public:
+    /// Index of the entry in the central directory.
+    int index() const { return entryIndex; }
+    /// File name decoded with the file name codec of the archive.
+    QString name() const;
+    /// File name as stored in the archive.
+    /**
+      The array refers to a buffer reused for the next entry.
+    */
+    QByteArray rawName() const { return nameBytes; }
+    quint16 versionCreated() const { return quint16(info.version); }
+    quint16 versionNeeded() const { return quint16(info.version_needed); }
+    quint16 flags() const { return quint16(info.flag); }
+    quint16 method() const { return quint16(info.compression_method); }
+    /// Modification time in the MS-DOS format.
+    quint32 dosDateTime() const { return quint32(info.dosDate); }
+    /// Modification time, decoded from dosDateTime().
+    QDateTime dateTime() const { return fromDosDateTime(dosDateTime()); }
+    quint32 crc() const { return quint32(info.crc); }
+    quint64 compressedSize() const { return info.compressed_size; }
+    quint64 uncompressedSize() const { return info.uncompressed_size; }
+    quint16 internalAttr() const { return quint16(info.internal_fa); }
+    quint32 externalAttr() const { return quint32(info.external_fa); }
+    /// Whether the name ends with '/'.
+    bool isDir() const { return nameBytes.endsWith('/'); }
+    /// Position in the central directory, for QuaZip::goToFilePos().
+    unz64_file_pos filePos() const;
+    /// Position of the local header in the archive file.
+    quint64 headerPos() const;
+
+    /// Extra field of the central header, read from the archive.
+    QByteArray extra() const;
+    /// File comment decoded with the comment codec, read from the archive.
+    QString comment() const;
+
+    /// Converts a date and time in the MS-DOS format used by ZIP headers.
+    static QDateTime fromDosDateTime(quint32 dosDateTime);
+
+private:
+    QuaZipEntryView(unzFile file, int index, const unz_file_info64 &info,
+        const QByteArray &name, QTextCodec *fileNameCodec,
+        QTextCodec *commentCodec);
+    Q_DISABLE_COPY(QuaZipEntryView)
+
+    unzFile file;
+    int entryIndex;
+    const unz_file_info64 &info;
+    QByteArray nameBytes;
+    QTextCodec *fileNameCodec;
+    QTextCodec *commentCodec;
+};
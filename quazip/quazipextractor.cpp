@@ -0,0 +1,344 @@
+#include "quazipextractor.h"
+
+#include "private/quazipextractsink.h"
+#include "private/quazippipeline.h"
+#include "quazip.h"
+#include "quazipfile.h"
+
+#include <QAtomicInt>
+#include <QFile>
+
+#include <cstring>
+
+#include <zlib.h>
+
+namespace {
+const qint64 DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+const int CHUNK_SIZE = 256 * 1024;
+/// Method of the entries decoded by the reader.
+const int METHOD_DECODED = -1;
+
+/// An entry on its way through the pipeline.
+struct Entry {
+    unz64_file_pos pos;
+    QString fileDest;
+    // set by the reader before the first chunk of the entry is queued
+    int method;
+    quint32 crc;
+    quint64 size;
+    QFile::Permissions permissions;
+    QDateTime modified;
+};
+
+/// A piece of the data of an entry.
+struct Chunk {
+    int entry;
+    QByteArray data;
+    /// The data ends the entry, it may be empty.
+    bool last;
+};
+
+using ChunkQueue = QuaZipBoundedQueue<Chunk>;
+
+bool pushChunk(ChunkQueue &queue, int entry, const QByteArray &data, bool last)
+{
+    Chunk chunk;
+    chunk.entry = entry;
+    chunk.data = data;
+    chunk.last = last;
+    return queue.push(chunk, data.size());
+}
+
+/// Opens the entries in turn and queues their data.
+bool readEntries(QuaZip *zip, QVector<Entry> &entries, ChunkQueue &out)
+{
+    for (int i = 0; i < entries.size(); ++i) {
+        Entry &entry = entries[i];
+        QuaZipFileInfo64 info;
+        if (!zip->goToFilePos(entry.pos) || !zip->getCurrentFileInfo(&info))
+            return false;
+
+        entry.crc = info.crc;
+        entry.size = info.uncompressedSize;
+        entry.permissions = info.getPermissions();
+        entry.modified = info.dateTime;
+        bool raw = (info.flags & 1) == 0
+            && (info.method == 0 || info.method == Z_DEFLATED);
+        bool isDir = entry.fileDest.endsWith('/');
+        entry.method = raw && !isDir ? int(info.method) : METHOD_DECODED;
+
+        // opening checks the local header, even for directories
+        QuaZipFile file(zip);
+        int method = 0;
+        bool opened = raw
+            ? file.open(QIODevice::ReadOnly | QIODevice::Unbuffered, &method,
+                  nullptr, true)
+            : file.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+        if (!opened || file.getZipError() != UNZ_OK)
+            return false;
+
+        if (!isDir) {
+            forever {
+                QByteArray data(CHUNK_SIZE, Qt::Uninitialized);
+                qint64 size = file.read(data.data(), CHUNK_SIZE);
+                if (size < 0)
+                    return false;
+                if (size == 0)
+                    break;
+
+                data.resize(int(size));
+                if (!pushChunk(out, i, data, false))
+                    return false;
+            }
+        }
+
+        // decoded entries get their CRC checked here
+        file.close();
+        if (file.getZipError() != UNZ_OK)
+            return false;
+        if (!pushChunk(out, i, QByteArray(), true))
+            return false;
+    }
+    return true;
+}
+
+/// Inflates the data of the entries and checks their CRC and size.
+class Inflater {
+public:
+    Inflater()
+        : started(false)
+    {
+        memset(&stream, 0, sizeof(stream));
+    }
+
+    ~Inflater()
+    {
+        if (started)
+            inflateEnd(&stream);
+    }
+
+    bool run(const QVector<Entry> &entries, ChunkQueue &in, ChunkQueue &out)
+    {
+        int current = -1;
+        Chunk chunk;
+        while (in.pop(&chunk)) {
+            const Entry &entry = entries.at(chunk.entry);
+            if (chunk.entry != current) {
+                current = chunk.entry;
+                if (!begin(entry))
+                    return false;
+            }
+
+            bool ok = entry.method == Z_DEFLATED
+                ? inflateChunk(chunk, out)
+                : passChunk(chunk, out);
+            if (!ok)
+                return false;
+
+            if (chunk.last) {
+                if (entry.method == Z_DEFLATED && !ended)
+                    return false;
+                if (entry.method != METHOD_DECODED
+                    && (crc != entry.crc || total != entry.size)) {
+                    return false;
+                }
+                if (!pushChunk(out, chunk.entry, QByteArray(), true))
+                    return false;
+            }
+        }
+        return !in.isAborted();
+    }
+
+private:
+    bool begin(const Entry &entry)
+    {
+        crc = crc32(0L, Z_NULL, 0);
+        total = 0;
+        ended = false;
+        if (entry.method != Z_DEFLATED)
+            return true;
+
+        if (started)
+            return inflateReset(&stream) == Z_OK;
+
+        started = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+        return started;
+    }
+
+    bool output(int entry, const QByteArray &data, ChunkQueue &out)
+    {
+        crc = crc32(crc, reinterpret_cast<const Bytef *>(data.constData()),
+            uInt(data.size()));
+        total += quint64(data.size());
+        return pushChunk(out, entry, data, false);
+    }
+
+    bool passChunk(const Chunk &chunk, ChunkQueue &out)
+    {
+        return chunk.data.isEmpty() || output(chunk.entry, chunk.data, out);
+    }
+
+    bool inflateChunk(const Chunk &chunk, ChunkQueue &out)
+    {
+        if (chunk.data.isEmpty())
+            return true;
+        if (ended)
+            return false; // data after the end of the stream
+
+        stream.next_in = reinterpret_cast<z_const Bytef *>(
+            const_cast<char *>(chunk.data.constData()));
+        stream.avail_in = uInt(chunk.data.size());
+        do {
+            QByteArray data(CHUNK_SIZE, Qt::Uninitialized);
+            stream.next_out = reinterpret_cast<Bytef *>(data.data());
+            stream.avail_out = uInt(CHUNK_SIZE);
+            int err = inflate(&stream, Z_NO_FLUSH);
+            if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR)
+                return false;
+
+            int produced = CHUNK_SIZE - int(stream.avail_out);
+            if (produced > 0) {
+                data.resize(produced);
+                if (!output(chunk.entry, data, out))
+                    return false;
+            }
+            if (err == Z_STREAM_END) {
+                ended = true;
+                return stream.avail_in == 0;
+            }
+        } while (stream.avail_in > 0 || stream.avail_out == 0);
+        return true;
+    }
+
+    z_stream stream;
+    bool started;
+    bool ended;
+    quint32 crc;
+    quint64 total;
+};
+
+/// Writes the files, appending their paths to \a written when created.
+bool writeEntries(
+    const QVector<Entry> &entries, ChunkQueue &in, QStringList *written)
+{
+    QuaZipExtractSink sink;
+    int current = -1;
+    Chunk chunk;
+    while (in.pop(&chunk)) {
+        const Entry &entry = entries.at(chunk.entry);
+        if (entry.fileDest.endsWith('/')) {
+            if (!sink.makeDir(entry.fileDest, entry.permissions))
+                return false;
+            continue;
+        }
+
+        if (chunk.entry != current) {
+            current = chunk.entry;
+            if (!sink.open(entry.fileDest, entry.size))
+                return false;
+
+            written->append(entry.fileDest);
+        }
+
+        if (!sink.write(chunk.data))
+            return false;
+
+        if (chunk.last && !sink.close(entry.permissions, entry.modified))
+            return false;
+    }
+    return !in.isAborted();
+}
+} // namespace
+
+QuaZipExtractor::QuaZipExtractor(QuaZip *zip)
+    : zip(zip)
+    , buffer(DEFAULT_BUFFER_SIZE)
+{
+}
+
+qint64 QuaZipExtractor::bufferSize() const
+{
+    return buffer;
+}
+
+void QuaZipExtractor::setBufferSize(qint64 size)
+{
+    buffer = size;
+}
+
+void QuaZipExtractor::addFile(
+    const unz64_file_pos &pos, const QString &fileDest)
+{
+    Target target;
+    target.pos = pos;
+    target.fileDest = fileDest;
+    targets.append(target);
+}
+
+int QuaZipExtractor::count() const
+{
+    return targets.size();
+}
+
+void QuaZipExtractor::clear()
+{
+    targets.clear();
+}
+
+bool QuaZipExtractor::extract()
+{
+    if (zip->getMode() != QuaZip::mdUnzip) {
+        qWarning("QuaZipExtractor::extract(): ZIP is not open in mdUnzip mode");
+        return false;
+    }
+
+    QVector<Entry> entries;
+    entries.reserve(targets.size());
+    for (const auto &target : targets) {
+        Entry entry;
+        entry.pos = target.pos;
+        entry.fileDest = target.fileDest;
+        entry.method = 0;
+        entry.crc = 0;
+        entry.size = 0;
+        entries.append(entry);
+    }
+
+    ChunkQueue compressed(buffer);
+    ChunkQueue decompressed(buffer);
+    QAtomicInt failed(0);
+    auto fail = [&]() {
+        failed.storeRelease(1);
+        compressed.abort();
+        decompressed.abort();
+    };
+
+    QStringList written;
+    QuaZipPipelineStage inflater([&]() {
+        if (Inflater().run(entries, compressed, decompressed))
+            decompressed.close();
+        else
+            fail();
+    });
+    QuaZipPipelineStage writer([&]() {
+        if (!writeEntries(entries, decompressed, &written))
+            fail();
+    });
+    inflater.start();
+    writer.start();
+
+    if (readEntries(zip, entries, compressed))
+        compressed.close();
+    else
+        fail();
+
+    inflater.wait();
+    writer.wait();
+    if (failed.loadAcquire() == 0)
+        return true;
+
+    for (const auto &fileName : written) {
+        QFile::remove(fileName);
+    }
+    return false;
+}
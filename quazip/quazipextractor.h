@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "quazip_global.h"
+#include "unzip.h"
+
+class QuaZip;
+
+/// Extracts entries of an archive with reading, decompression and writing
+/// overlapped
+/**
+  extract() runs a pipeline of three stages connected by bounded queues:
+  the calling thread opens the entries one after another, which checks
+  their local headers, and reads their compressed data; a second thread
+  inflates the data and checks the CRC; a third one writes the files.
+  While one entry is inflated, the next ones are already read and the
+  previous ones are still written, so the disk and the CPU are busy at
+  the same time even for a single archive.
+
+  On Linux, the writer keeps the directories it creates open, creates
+  the files relative to them, preallocates them and writes them in
+  large blocks, then sets their mode and time on the open descriptor.
+
+  Stored and deflated entries are read raw and inflated by the second
+  stage. Encrypted entries and other compression methods are decoded by
+  the reader through QuaZipFile and only pass through the inflater.
+
+  Example:
+  \code
+  QuaZipExtractor extractor(&zip);
+  zip.forEachFile([&](const QuaZipEntryView &entry) {
+      extractor.addFile(entry.filePos(), dir.absoluteFilePath(entry.name()));
+      return true;
+  });
+  bool ok = extractor.extract();
+  \endcode
+
+  \sa JlCompress::extractDir()
+*/
+class QUAZIP_EXPORT QuaZipExtractor {
+public:
+    /// Constructs an extractor for \a zip, open in the mdUnzip mode.
+    explicit QuaZipExtractor(QuaZip *zip);
+
+    /// Size of the data each queue between the stages may hold.
+    /**
+      4 MB by default. It bounds the memory used by extract() and how far
+      the reader gets ahead of the writer.
+    */
+    qint64 bufferSize() const;
+    /// Sets the size of the data each queue may hold.
+    void setBufferSize(qint64 size);
+
+    /// Adds an entry to extract to \a fileDest.
+    /**
+      \param pos The entry, see QuaZip::getCurrentFilePos().
+      \param fileDest The full path of the file to write. If it ends with
+      '/', a directory is created instead.
+    */
+    void addFile(const unz64_file_pos &pos, const QString &fileDest);
+    /// Number of the entries added.
+    int count() const;
+    /// Removes the entries added.
+    void clear();
+
+    /// Extracts the entries in the order they were added.
+    /**
+      The permissions and the modification times of the entries are set
+      on the files written. On failure the files written so far are
+      removed. The current file of the archive is changed.
+      \return \c true if all the entries were extracted.
+    */
+    bool extract();
+
+private:
+    struct Target {
+        unz64_file_pos pos;
+        QString fileDest;
+    };
+
+    QuaZip *zip;
+    qint64 buffer;
+    QVector<Target> targets;
+};
@@ -23,9 +23,21 @@ quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
 #include "quazipfile.h"
+#include "quaziodevice.h"
+#include "quazcompressibility.h"
+
+#include <limits>
 
 using namespace std;
 
+/// Buffers allocated by minizip for an open file.
+/** See Z_BUFSIZE in zip.c and UNZ_BUFSIZE in unzip.c.
+ **/
+enum {
+  ZIP_BUFFER_SIZE = 64 * 1024,
+  UNZIP_BUFFER_SIZE = 16384
+};
+
 /// The implementation class for QuaZip.
 /**
 \internal
@@ -58,6 +70,41 @@ class QuaZipFilePrivate {
     quint64 uncompressedSize;
     /// CRC to write along with a raw file.
     quint32 crc;
+    /// Compression method of the file open for writing.
+    int method;
+    /// Window bits of the file open for writing.
+    int windowBits;
+    /// Memory level of the file open for writing.
+    int memLevel;
+    /// Writes smaller than this are collected in \ref writeBuffer.
+    int writeBufferThreshold;
+    /// Small writes not yet passed to zipWriteInFileInZip().
+    QByteArray writeBuffer;
+    /// Whether to store incompressible data instead of deflating it.
+    bool autoStore;
+    /// Whether the entry waits for a sample of data to choose the method.
+    /**
+      While it is true, all written data is collected in \ref writeBuffer
+      and zipOpenNewFileInZip3_64() is not called yet.
+      */
+    bool entryPending;
+    /// The last QuaZCompressibility::Decision.
+    QuaZCompressibility::Decision storeDecision;
+    /// Arguments of zipOpenNewFileInZip3_64() for the file open for writing.
+    struct Entry {
+      zip_fileinfo info;
+      QString fileName;
+      QByteArray name;
+      QByteArray extraLocal;
+      QByteArray extraGlobal;
+      QByteArray comment;
+      QByteArray password;
+      quint32 crc;
+      int level;
+      int strategy;
+      /// QuaZip::isDataDescriptorWritingEnabled() when the file was opened.
+      bool dataDescriptor;
+    } entry;
     /// Whether \ref zip points to an internal QuaZip instance.
     /**
       This is true if the archive was opened by name, rather than by
@@ -75,6 +122,18 @@ class QuaZipFilePrivate {
       anything by themselves.
       */
     void setZipError(int zipError) const;
+    /// Passes \ref writeBuffer to zipWriteInFileInZip().
+    /**
+      Returns \c false and sets \ref zipError on failure.
+      */
+    bool flushWriteBuffer();
+    /// Opens \ref entry in the ZIP with \ref method.
+    /**
+      Returns \c false and sets \ref zipError on failure.
+      */
+    bool openEntry();
+    /// Chooses the method from the data collected so far and opens the entry.
+    bool openPendingEntry();
     /// The constructor for the corresponding QuaZipFile constructor.
     inline QuaZipFilePrivate(QuaZipFile *q):
       q(q),
@@ -84,6 +143,13 @@ class QuaZipFilePrivate {
       writePos(0),
       uncompressedSize(0),
       crc(0),
+      method(Z_DEFLATED),
+      windowBits(-MAX_WBITS),
+      memLevel(DEF_MEM_LEVEL),
+      writeBufferThreshold(0),
+      autoStore(false),
+      entryPending(false),
+      storeDecision(QuaZCompressibility::Compress),
       internal(true),
       zipError(UNZ_OK) {}
     /// The constructor for the corresponding QuaZipFile constructor.
@@ -94,6 +160,13 @@ class QuaZipFilePrivate {
       writePos(0),
       uncompressedSize(0),
       crc(0),
+      method(Z_DEFLATED),
+      windowBits(-MAX_WBITS),
+      memLevel(DEF_MEM_LEVEL),
+      writeBufferThreshold(0),
+      autoStore(false),
+      entryPending(false),
+      storeDecision(QuaZCompressibility::Compress),
       internal(true),
       zipError(UNZ_OK)
       {
@@ -107,6 +180,13 @@ class QuaZipFilePrivate {
       writePos(0),
       uncompressedSize(0),
       crc(0),
+      method(Z_DEFLATED),
+      windowBits(-MAX_WBITS),
+      memLevel(DEF_MEM_LEVEL),
+      writeBufferThreshold(0),
+      autoStore(false),
+      entryPending(false),
+      storeDecision(QuaZCompressibility::Compress),
       internal(true),
       zipError(UNZ_OK)
       {
@@ -124,6 +204,13 @@ class QuaZipFilePrivate {
       writePos(0),
       uncompressedSize(0),
       crc(0),
+      method(Z_DEFLATED),
+      windowBits(-MAX_WBITS),
+      memLevel(DEF_MEM_LEVEL),
+      writeBufferThreshold(0),
+      autoStore(false),
+      entryPending(false),
+      storeDecision(QuaZCompressibility::Compress),
       internal(false),
       zipError(UNZ_OK) {}
     /// The destructor.
@@ -247,6 +334,51 @@ void QuaZipFilePrivate::setZipError(int zipError) const
     q->setErrorString(QuaZipFile::tr("ZIP/UNZIP API error %1").arg(zipError));
 }
 
+bool QuaZipFilePrivate::openEntry()
+{
+  // the entry may be opened after the first writes, so the flags are
+  // the ones of the time of open()
+  if(entry.dataDescriptor)
+    zipSetFlags(zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
+  else
+    zipClearFlags(zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
+  setZipError(zipOpenNewFileInZip3_64(zip->getZipFile(),
+        entry.name.constData(), &entry.info,
+        entry.extraLocal.constData(), entry.extraLocal.length(),
+        entry.extraGlobal.constData(), entry.extraGlobal.length(),
+        entry.comment.constData(),
+        method, entry.level, (int)raw,
+        windowBits, memLevel, entry.strategy,
+        entry.password.isNull() ? NULL : entry.password.constData(),
+        (uLong)entry.crc, zip->isZip64Enabled()));
+  return zipError==ZIP_OK;
+}
+
+bool QuaZipFilePrivate::openPendingEntry()
+{
+  entryPending=false;
+  storeDecision=QuaZCompressibility::decide(entry.fileName, writeBuffer);
+  if(storeDecision!=QuaZCompressibility::Compress)
+    method=0;
+  if(!openEntry()) {
+    writeBuffer.clear();
+    return false;
+  }
+  return flushWriteBuffer();
+}
+
+bool QuaZipFilePrivate::flushWriteBuffer()
+{
+  if (writeBuffer.isEmpty())
+    return true;
+  if (entryPending)
+    return true;
+  setZipError(zipWriteInFileInZip(zip->getZipFile(), writeBuffer.constData(),
+      (uint)writeBuffer.size()));
+  writeBuffer.clear();
+  return zipError==ZIP_OK;
+}
+
 bool QuaZipFile::open(OpenMode mode)
 {
   return open(mode, NULL);
@@ -259,10 +391,6 @@ bool QuaZipFile::open(OpenMode mode, int *method, int *level, bool raw, const ch
     qWarning("QuaZipFile::open(): already opened");
     return false;
   }
-  if(mode&Unbuffered) {
-    qWarning("QuaZipFile::open(): Unbuffered mode is not supported");
-    return false;
-  }
   if((mode&ReadOnly)&&!(mode&WriteOnly)) {
     if(p->internal) {
       if(!p->zip->open(QuaZip::mdUnzip)) {
@@ -301,6 +429,45 @@ bool QuaZipFile::open(OpenMode mode, int *method, int *level, bool raw, const ch
   return false;
 }
 
+QByteArray QuaZipFile::readAtOnce(const char *password)
+{
+  p->resetZipError();
+  if(isOpen()) {
+    qWarning("QuaZipFile::readAtOnce(): already opened");
+    return QByteArray();
+  }
+  if(p->internal) {
+    if(!p->zip->open(QuaZip::mdUnzip)) {
+      p->setZipError(p->zip->getZipError());
+      return QByteArray();
+    }
+    if(!p->zip->setCurrentFile(p->fileName, p->caseSensitivity)) {
+      p->setZipError(p->zip->getZipError());
+      p->zip->close();
+      return QByteArray();
+    }
+  } else {
+    if(p->zip==NULL) {
+      qWarning("QuaZipFile::readAtOnce(): zip is NULL");
+      return QByteArray();
+    }
+    if(p->zip->getMode()!=QuaZip::mdUnzip) {
+      qWarning("QuaZipFile::readAtOnce(): ZIP open mode %d is not mdUnzip",
+          (int)p->zip->getMode());
+      return QByteArray();
+    }
+    if(!p->zip->hasCurrentFile()) {
+      qWarning("QuaZipFile::readAtOnce(): zip does not have current file");
+      return QByteArray();
+    }
+  }
+  QByteArray data=p->zip->readCurrentFile(password);
+  p->setZipError(p->zip->getZipError());
+  if(p->internal)
+    p->zip->close();
+  return data;
+}
+
 bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
     const char *password, quint32 crc,
     int method, int level, bool raw,
@@ -335,22 +502,38 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
     info_z.dosDate = 0;
     info_z.internal_fa=(uLong)info.internalAttr;
     info_z.external_fa=(uLong)info.externalAttr;
-    if (p->zip->isDataDescriptorWritingEnabled())
-        zipSetFlags(p->zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
-    else
-        zipClearFlags(p->zip->getZipFile(), ZIP_WRITE_DATA_DESCRIPTOR);
-    p->setZipError(zipOpenNewFileInZip3_64(p->zip->getZipFile(),
-          p->zip->getFileNameCodec()->fromUnicode(info.name).constData(), &info_z,
-          info.extraLocal.constData(), info.extraLocal.length(),
-          info.extraGlobal.constData(), info.extraGlobal.length(),
-          p->zip->getCommentCodec()->fromUnicode(info.comment).constData(),
-          method, level, (int)raw,
-          windowBits, memLevel, strategy,
-          password, (uLong)crc, p->zip->isZip64Enabled()));
-    if(p->zipError==UNZ_OK) {
+    // ZIP entries are always raw deflate streams, which zlib
+    // rejects with 8 window bits
+    windowBits=-qBound(9, qAbs(windowBits), MAX_WBITS);
+    p->entry.info=info_z;
+    p->entry.fileName=info.name;
+    p->entry.name=p->zip->getFileNameCodec()->fromUnicode(info.name);
+    p->entry.extraLocal=info.extraLocal;
+    p->entry.extraGlobal=info.extraGlobal;
+    p->entry.comment=p->zip->getCommentCodec()->fromUnicode(info.comment);
+    p->entry.password=password==NULL ? QByteArray() : QByteArray(password);
+    p->entry.crc=crc;
+    p->entry.level=level;
+    p->entry.strategy=strategy;
+    p->entry.dataDescriptor=p->zip->isDataDescriptorWritingEnabled();
+    p->method=method;
+    p->windowBits=windowBits;
+    p->memLevel=memLevel;
+    p->raw=raw;
+    p->writeBuffer.clear();
+    p->storeDecision=QuaZCompressibility::Compress;
+    p->entryPending=false;
+    if(p->autoStore&&!raw&&method==Z_DEFLATED) {
+      if(QuaZCompressibility::hasStoredExtension(info.name)) {
+        p->storeDecision=QuaZCompressibility::StoreByExtension;
+        p->method=0;
+      } else {
+        p->entryPending=true;
+      }
+    }
+    if(p->entryPending||p->openEntry()) {
       p->writePos=0;
       setOpenMode(mode);
-      p->raw=raw;
       if(raw) {
         p->crc=crc;
         p->uncompressedSize=info.uncompressedSize;
@@ -368,6 +551,19 @@ bool QuaZipFile::isSequential()const
   return true;
 }
 
+qint64 QuaZipFile::bytesAvailable()const
+{
+  if(!isOpen()||!(openMode()&ReadOnly)||p->zip==NULL)
+    return QIODevice::bytesAvailable();
+  // not via size(), which would reset the error code
+  unz_file_info64 info_z;
+  if(unzGetCurrentFileInfo64(p->zip->getUnzFile(), &info_z, NULL, 0, NULL, 0, NULL, 0)!=UNZ_OK)
+    return QIODevice::bytesAvailable();
+  quint64 total=p->raw?info_z.compressed_size:info_z.uncompressed_size;
+  quint64 done=unztell64(p->zip->getUnzFile());
+  return qint64(total>done?total-done:0)+QIODevice::bytesAvailable();
+}
+
 qint64 QuaZipFile::size()const
 {
   if(!isOpen()) {
@@ -431,10 +627,12 @@ void QuaZipFile::close()
   }
   if(openMode()&ReadOnly)
     p->setZipError(unzCloseCurrentFile(p->zip->getUnzFile()));
-  else if(openMode()&WriteOnly)
+  else if(openMode()&WriteOnly) {
+    if(p->entryPending&&!p->openPendingEntry()) return;
+    if(!p->flushWriteBuffer()) return;
     if(isRaw()) p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(), p->uncompressedSize, p->crc));
     else p->setZipError(zipCloseFileInZip(p->zip->getZipFile()));
-  else {
+  } else {
     qWarning("Wrong open mode: %d", (int)openMode());
     return;
   }
@@ -449,6 +647,8 @@ void QuaZipFile::close()
 qint64 QuaZipFile::readData(char *data, qint64 maxSize)
 {
   p->setZipError(UNZ_OK);
+  // unbuffered reads may ask for more than unzReadCurrentFile() can return
+  maxSize=qMin(maxSize, qint64(std::numeric_limits<int>::max()));
   qint64 bytesRead=unzReadCurrentFile(p->zip->getUnzFile(), data, (unsigned)maxSize);
   if (bytesRead < 0) {
     p->setZipError((int) bytesRead);
@@ -460,12 +660,91 @@ qint64 QuaZipFile::readData(char *data, qint64 maxSize)
 qint64 QuaZipFile::writeData(const char* data, qint64 maxSize)
 {
   p->setZipError(ZIP_OK);
-  p->setZipError(zipWriteInFileInZip(p->zip->getZipFile(), data, (uint)maxSize));
-  if(p->zipError!=ZIP_OK) return -1;
-  else {
-    p->writePos+=maxSize;
-    return maxSize;
+  qint64 total=maxSize;
+  if(p->entryPending) {
+    // collect a sample to choose the compression method
+    qint64 sampleSize=qMin(maxSize,
+        qint64(QuaZCompressibility::SAMPLE_SIZE-p->writeBuffer.size()));
+    p->writeBuffer.append(data, (int)sampleSize);
+    data+=sampleSize;
+    maxSize-=sampleSize;
+    if(p->writeBuffer.size()>=QuaZCompressibility::SAMPLE_SIZE&&
+        !p->openPendingEntry())
+      return -1;
+  }
+  if(maxSize==0) {
+    // nothing left
+  } else if(maxSize<p->writeBufferThreshold) {
+    p->writeBuffer.append(data, (int)maxSize);
+    if(p->writeBuffer.size()>=p->writeBufferThreshold&&!p->flushWriteBuffer())
+      return -1;
+  } else {
+    if(!p->flushWriteBuffer()) return -1;
+    p->setZipError(zipWriteInFileInZip(p->zip->getZipFile(), data, (uint)maxSize));
+    if(p->zipError!=ZIP_OK) return -1;
+  }
+  p->writePos+=total;
+  return total;
+}
+
+qint64 QuaZipFile::writeFragments(const QByteArrayList &fragments)
+{
+  if(!(openMode()&WriteOnly)) {
+    qWarning("QuaZipFile::writeFragments(): file is not open for writing");
+    return -1;
+  }
+  qint64 total=0;
+  for(QByteArrayList::const_iterator it=fragments.constBegin();
+      it!=fragments.constEnd(); ++it) {
+    qint64 written=writeData(it->constData(), it->size());
+    if(written<0) return -1;
+    total+=written;
+  }
+  return total;
+}
+
+qint64 QuaZipFile::memoryUsage() const
+{
+  if(!isOpen())
+    return 0;
+  qint64 result=sizeof(QuaZipFilePrivate)+p->writeBuffer.capacity();
+  if(openMode()&ReadOnly) {
+    result+=UNZIP_BUFFER_SIZE;
+    if(!p->raw)
+      result+=QuaZIODevice::inflateMemoryUsage(MAX_WBITS);
+  } else {
+    result+=ZIP_BUFFER_SIZE;
+    if(!p->raw&&p->method==Z_DEFLATED)
+      result+=QuaZIODevice::deflateMemoryUsage(p->windowBits, p->memLevel);
   }
+  return result;
+}
+
+int QuaZipFile::getWriteBufferThreshold() const
+{
+  return p->writeBufferThreshold;
+}
+
+void QuaZipFile::setWriteBufferThreshold(int threshold)
+{
+  p->writeBufferThreshold=threshold<0 ? 0 : threshold;
+  if((openMode()&WriteOnly)&&p->writeBuffer.size()>=p->writeBufferThreshold)
+    p->flushWriteBuffer();
+}
+
+bool QuaZipFile::isAutoStoreEnabled() const
+{
+  return p->autoStore;
+}
+
+void QuaZipFile::setAutoStoreEnabled(bool enabled)
+{
+  p->autoStore=enabled;
+}
+
+QuaZCompressibility::Decision QuaZipFile::getStoreDecision() const
+{
+  return p->storeDecision;
 }
 
 QString QuaZipFile::getFileName() const
@@ -25,11 +25,13 @@ Original ZIP package is copyrighted by Gilles Vollant, see
 quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
+#include <QByteArrayList>
 #include <QIODevice>
 
 #include "quazip_global.h"
 #include "quazip.h"
 #include "quazipnewinfo.h"
+#include "quazcompressibility.h"
 
 class QuaZipFilePrivate;
 
@@ -286,9 +288,11 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
     /** Returns \c true on success, \c false otherwise.
      * Call getZipError() to get error code.
      *
-     * \note Since ZIP/UNZIP API provides buffered reading only,
-     * QuaZipFile does not support unbuffered reading. So do not pass
-     * QIODevice::Unbuffered flag in \a mode, or open will fail.
+     * Pass QIODevice::Unbuffered in \a mode to have read() go straight
+     * to unzReadCurrentFile() without the 16 KB buffer of QIODevice.
+     * This saves a copy for bulk reads of large blocks, while many small
+     * reads or getChar() calls are faster with the buffer. Writes are
+     * never buffered by QIODevice, see setWriteBufferThreshold().
      **/
     virtual bool open(OpenMode mode);
     /// Opens a file for reading.
@@ -313,6 +317,15 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      **/
     bool open(OpenMode mode, int *method, int *level, bool raw,
         const char *password = NULL);
+    /// Reads the whole file without opening it.
+    /** The file must be closed. Works like open() for reading, followed
+     * by readAll() and close(), but allocates the result once and reads
+     * it in a single pass, see QuaZip::readCurrentFile().
+     *
+     * Returns an empty array on error, call getZipError() to get the
+     * error code. A CRC mismatch is reported as \c UNZ_CRCERROR.
+     **/
+    QByteArray readAtOnce(const char *password = NULL);
     /// Opens a file for writing.
     /** \a info argument specifies information about file. It should at
      * least specify a correct file name. Also, it is a good idea to
@@ -326,8 +339,9 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * use the raw mode (see below).
      *
      * Arguments \a method and \a level specify compression method and
-     * level. The only method supported is Z_DEFLATED, but you may also
-     * specify 0 for no compression. If all of the files in the archive
+     * level. The methods supported are Z_DEFLATED, 0 for no compression,
+     * and the methods with a codec in zipcodec.h, such as Z_ZSTD when
+     * built with HAVE_ZSTD, see zipFindCodec(). If all of the files in the archive
      * use both method 0 and either level 0 is explicitly specified or
      * data descriptor writing is disabled with
      * QuaZip::setDataDescriptorWritingEnabled(), then the
@@ -338,8 +352,17 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
      * If \a raw is \c true, no compression is performed. In this case,
      * \a crc and uncompressedSize field of the \a info are required.
      *
+     * With \ref setAutoStoreEnabled() "automatic storing" enabled, the
+     * entry may only be opened in the archive by the first writes or by
+     * close(), which then report the errors that open() would.
+     *
      * Arguments \a windowBits, \a memLevel, \a strategy provide zlib
-     * algorithms tuning. See deflateInit2() in zlib.
+     * algorithms tuning. See deflateInit2() in zlib. ZIP entries are
+     * always raw deflate streams, so the sign of \a windowBits is
+     * ignored and it is kept from 9 to 15. Pass QuaZIODevice::LOW_MEMORY_WINDOW_BITS and
+     * QuaZIODevice::LOW_MEMORY_MEM_LEVEL to use the low memory profile.
+     *
+     * \sa memoryUsage()
      **/
     bool open(
         OpenMode mode, const QuaZipNewInfo& info,
@@ -349,6 +372,12 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
         int strategy = Z_DEFAULT_STRATEGY);
     /// Returns \c true, but \ref quazipfile-sequential "beware"!
     virtual bool isSequential() const;
+    /// Returns the number of bytes left to read.
+    /** The size of the file less the bytes read so far, so it works in
+     * the unbuffered mode as well. Returns 0 if the file is not open
+     * for reading.
+     **/
+    virtual qint64 bytesAvailable() const;
     /// Returns file size.
     /** This function returns csize() if the file is open for reading in
      * raw mode, usize() if it is open for reading in normal mode and
@@ -413,6 +442,65 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
     virtual void close();
     /// Returns the error code returned by the last ZIP/UNZIP API call.
     int getZipError() const;
+    /// Returns estimated memory used by the open file in bytes.
+    /** Includes the zlib state and the buffers of the underlying
+     * ZIP/UNZIP API. Returns 0 if the file is not open.
+     **/
+    qint64 memoryUsage() const;
+    /// Returns the write buffer threshold in bytes.
+    /** The default is 0, which means that writes are not buffered.
+     *
+     * \sa setWriteBufferThreshold()
+     **/
+    int getWriteBufferThreshold() const;
+    /// Sets the write buffer threshold.
+    /** Writes smaller than \a threshold bytes are collected in an
+     * internal buffer, which is passed to the ZIP API as a whole as soon
+     * as it reaches \a threshold bytes. Larger writes go directly,
+     * after the buffered data. This reduces the per-call overhead when
+     * a lot of small chunks are written. The buffered data is also
+     * written on close().
+     **/
+    void setWriteBufferThreshold(int threshold);
+    /// Writes several data fragments at once.
+    /** Equivalent to writing each fragment in order.
+     *
+     * \return The total number of bytes written, or -1 on error. Call
+     * getZipError() to get the error code.
+     **/
+    qint64 writeFragments(const QByteArrayList &fragments);
+    /// Returns whether incompressible data is stored instead of deflated.
+    /** The default is \c false.
+     *
+     * \sa setAutoStoreEnabled()
+     **/
+    bool isAutoStoreEnabled() const;
+    /// Enables storing of incompressible data.
+    /** When enabled, a file opened for writing with the Z_DEFLATED
+     * method and not in the raw mode is stored with method 0 if
+     * QuaZCompressibility::decide() says so. The extension of the file
+     * name is checked in open(). Otherwise, the written data is kept in
+     * memory until QuaZCompressibility::SAMPLE_SIZE bytes are collected or
+     * the file is closed, and the decision is made from these bytes.
+     * The data is compressed only once either way.
+     *
+     * In the latter case, open() does not write the local header yet, so
+     * the errors of opening the entry in the archive, such as a write
+     * error, are reported by the write() that collects the sample, or by
+     * close(). The data descriptor setting of the QuaZip instance is
+     * taken when open() is called. No other file of the same archive
+     * should be opened for writing until this one is closed.
+     *
+     * Should be called before open().
+     *
+     * \sa getStoreDecision()
+     **/
+    void setAutoStoreEnabled(bool enabled);
+    /// Returns the decision made for the file last opened for writing.
+    /** Returns QuaZCompressibility::Compress if storing is not enabled,
+     * or the decision is not made yet.
+     **/
+    QuaZCompressibility::Decision getStoreDecision() const;
 };
 
 #endif
@@ -0,0 +1,299 @@
+#include "quazipnamefilter.h"
+
+#include "private/quazipnamematcher.h"
+
+#include <QRegExp>
+#include <QSharedData>
+#include <QTextCodec>
+#include <QVector>
+
+namespace {
+const int MIB_UTF8 = 106;
+
+struct Condition {
+    enum Kind
+    {
+        Prefix,
+        Wildcard,
+        RegularExpression
+    };
+
+    Kind kind;
+    QString pattern;
+    Qt::CaseSensitivity cs;
+    QRegExp wildcard;
+    QRegularExpression re;
+
+    bool matches(const QString &name) const
+    {
+        switch (kind) {
+            case Prefix:
+                return name.startsWith(pattern, cs);
+            case Wildcard:
+                return wildcard.exactMatch(name);
+            case RegularExpression:
+                break;
+        }
+        return re.match(name).hasMatch();
+    }
+};
+
+/// Whether '*', '?', '/' and ASCII letters are single bytes in the codec.
+bool isAsciiCompatible(QTextCodec *codec)
+{
+    int mib = codec->mibEnum();
+    if (mib == MIB_UTF8)
+        return true;
+
+    // single byte encodings, where any byte is a whole character
+    if (mib >= 3 && mib <= 13) // US-ASCII and ISO-8859-1 to 10
+        return true;
+    if (mib >= 109 && mib <= 112) // ISO-8859-13 to 16
+        return true;
+    if (mib >= 2250 && mib <= 2258) // windows-1250 to 1258
+        return true;
+    switch (mib) {
+        case 2009: // IBM850
+        case 2011: // IBM437
+        case 2027: // macintosh
+        case 2084: // KOI8-R
+        case 2086: // IBM866
+        case 2088: // KOI8-U
+            return true;
+    }
+    return false;
+}
+
+bool isAscii(const QString &string)
+{
+    for (QChar c : string) {
+        if (c.unicode() >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+inline char toLowerAscii(char c)
+{
+    return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c;
+}
+
+inline bool sameByte(char a, char b, bool caseInsensitive)
+{
+    return a == b
+        || (caseInsensitive && toLowerAscii(a) == toLowerAscii(b));
+}
+
+/// Size of the character at \a s, at least one byte.
+inline int charSize(const char *s, int size, bool utf8)
+{
+    int result = 1;
+    if (utf8) {
+        while (result < size && (quint8(s[result]) & 0xC0) == 0x80)
+            ++result;
+    }
+    return result;
+}
+
+bool matchPrefix(const QByteArray &prefix, const char *name, int size,
+    bool caseInsensitive)
+{
+    if (size < prefix.size())
+        return false;
+
+    for (int i = 0; i < prefix.size(); ++i) {
+        if (!sameByte(prefix.at(i), name[i], caseInsensitive))
+            return false;
+    }
+    return true;
+}
+
+/// Matches '*' and '?', backtracking to the last '*' on mismatch.
+bool matchWildcard(const QByteArray &pattern, const char *name, int size,
+    bool caseInsensitive, bool utf8)
+{
+    const char *p = pattern.constData();
+    int patternSize = pattern.size();
+    int pi = 0;
+    int si = 0;
+    int starPattern = -1;
+    int starName = 0;
+    while (si < size) {
+        if (pi < patternSize && p[pi] == '*') {
+            starPattern = ++pi;
+            starName = si;
+            continue;
+        }
+        if (pi < patternSize && p[pi] == '?') {
+            ++pi;
+            si += charSize(name + si, size - si, utf8);
+            continue;
+        }
+        if (pi < patternSize && sameByte(p[pi], name[si], caseInsensitive)) {
+            ++pi;
+            ++si;
+            continue;
+        }
+        if (starPattern < 0)
+            return false;
+
+        pi = starPattern;
+        starName += charSize(name + starName, size - starName, utf8);
+        si = starName;
+    }
+
+    while (pi < patternSize && p[pi] == '*')
+        ++pi;
+    return pi == patternSize;
+}
+} // namespace
+
+/// \cond internal
+class QuaZipNameFilterPrivate : public QSharedData {
+public:
+    QVector<Condition> conditions;
+};
+/// \endcond
+
+QuaZipNameFilter::QuaZipNameFilter()
+    : d(new QuaZipNameFilterPrivate)
+{
+}
+
+QuaZipNameFilter::QuaZipNameFilter(const QuaZipNameFilter &other)
+    : d(other.d)
+{
+}
+
+QuaZipNameFilter::~QuaZipNameFilter()
+{
+}
+
+QuaZipNameFilter &QuaZipNameFilter::operator=(const QuaZipNameFilter &other)
+{
+    d = other.d;
+    return *this;
+}
+
+QuaZipNameFilter QuaZipNameFilter::prefix(
+    const QString &prefix, Qt::CaseSensitivity cs)
+{
+    Condition condition;
+    condition.kind = Condition::Prefix;
+    condition.pattern = prefix;
+    condition.cs = cs;
+
+    QuaZipNameFilter result;
+    result.d->conditions.append(condition);
+    return result;
+}
+
+QuaZipNameFilter QuaZipNameFilter::wildcard(
+    const QString &pattern, Qt::CaseSensitivity cs)
+{
+    Condition condition;
+    condition.kind = Condition::Wildcard;
+    condition.pattern = pattern;
+    condition.cs = cs;
+    condition.wildcard = QRegExp(pattern, cs, QRegExp::Wildcard);
+
+    QuaZipNameFilter result;
+    result.d->conditions.append(condition);
+    return result;
+}
+
+QuaZipNameFilter QuaZipNameFilter::regularExpression(
+    const QRegularExpression &re)
+{
+    Condition condition;
+    condition.kind = Condition::RegularExpression;
+    condition.pattern = re.pattern();
+    condition.cs = re.patternOptions() & QRegularExpression::CaseInsensitiveOption
+        ? Qt::CaseInsensitive
+        : Qt::CaseSensitive;
+    condition.re = re;
+
+    QuaZipNameFilter result;
+    result.d->conditions.append(condition);
+    return result;
+}
+
+QuaZipNameFilter QuaZipNameFilter::operator&(
+    const QuaZipNameFilter &other) const
+{
+    QuaZipNameFilter result(*this);
+    result.d->conditions += other.d->conditions;
+    return result;
+}
+
+bool QuaZipNameFilter::matchesAll() const
+{
+    return d->conditions.isEmpty();
+}
+
+bool QuaZipNameFilter::matches(const QString &name) const
+{
+    for (const auto &condition : d->conditions) {
+        if (!condition.matches(name))
+            return false;
+    }
+    return true;
+}
+
+QuaZipNameMatcher::QuaZipNameMatcher(
+    const QuaZipNameFilter &filter, QTextCodec *codec)
+    : codec(codec)
+    , utf8(codec->mibEnum() == MIB_UTF8)
+{
+    // copied one by one, so that each matcher has its own QRegExp state
+    for (const auto &condition : filter.d->conditions) {
+        this->filter.d->conditions.append(condition);
+    }
+
+    bool compatible = isAsciiCompatible(codec);
+    const auto &conditions = this->filter.d->conditions;
+    for (int i = 0; i < conditions.size(); ++i) {
+        const Condition &condition = conditions.at(i);
+        bool caseInsensitive = condition.cs == Qt::CaseInsensitive;
+        bool byBytes = compatible
+            && (!caseInsensitive || isAscii(condition.pattern));
+        if (condition.kind == Condition::Wildcard) {
+            byBytes = byBytes && !condition.pattern.contains('[')
+                && !condition.pattern.contains('\\');
+        }
+        if (condition.kind == Condition::RegularExpression || !byBytes) {
+            decodedConditions.append(i);
+            continue;
+        }
+
+        ByteCondition byteCondition;
+        byteCondition.isPrefix = condition.kind == Condition::Prefix;
+        byteCondition.caseInsensitive = caseInsensitive;
+        byteCondition.pattern = codec->fromUnicode(condition.pattern);
+        byteConditions.append(byteCondition);
+    }
+}
+
+bool QuaZipNameMatcher::matches(const char *name, int size) const
+{
+    for (const auto &condition : byteConditions) {
+        bool matched = condition.isPrefix
+            ? matchPrefix(condition.pattern, name, size,
+                  condition.caseInsensitive)
+            : matchWildcard(condition.pattern, name, size,
+                  condition.caseInsensitive, utf8);
+        if (!matched)
+            return false;
+    }
+
+    if (decodedConditions.isEmpty())
+        return true;
+
+    QString decoded = codec->toUnicode(name, size);
+    const auto &conditions = filter.d->conditions;
+    for (int i : decodedConditions) {
+        if (!conditions.at(i).matches(decoded))
+            return false;
+    }
+    return true;
+}
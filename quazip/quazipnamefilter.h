@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QSharedDataPointer>
+#include <QString>
+
+#include "quazip_global.h"
+
+class QuaZipNameFilterPrivate;
+
+/// Filter for the names of the entries of an archive
+/**
+  A filter is made of prefix, wildcard and regular expression conditions,
+  combined with operator&(). For example, all JSON files under \c data/:
+  \code
+  auto filter = QuaZipNameFilter::prefix("data/")
+      & QuaZipNameFilter::wildcard("*.json");
+  zip.forEachFile(filter, [](const QuaZipEntryView &entry) { ... });
+  \endcode
+
+  QuaZip::forEachFile(), QuaZipEntryTable::matching() and
+  JlCompress::extractFiles() prepare the filter once for the file name
+  codec of the archive. Prefixes and simple wildcards are then checked
+  on the raw bytes of the names in the central directory, so the names
+  that do not match are never decoded. Regular expressions, wildcards
+  with character sets and codecs that are not compatible with ASCII
+  need the decoded name, which is only decoded for the entries that
+  passed the other conditions.
+
+  \sa QDir::match()
+*/
+class QUAZIP_EXPORT QuaZipNameFilter {
+    friend class QuaZipNameMatcher;
+
+public:
+    /// Constructs a filter that matches all names.
+    QuaZipNameFilter();
+    QuaZipNameFilter(const QuaZipNameFilter &other);
+    ~QuaZipNameFilter();
+    QuaZipNameFilter &operator=(const QuaZipNameFilter &other);
+
+    /// Matches the names that start with \a prefix.
+    static QuaZipNameFilter prefix(
+        const QString &prefix, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+    /// Matches the whole names against a wildcard \a pattern.
+    /**
+      The pattern supports \c *, \c ? and character sets like QDir::match().
+      Note that \c * matches '/' too, so "*.json" matches JSON files in
+      all directories.
+    */
+    static QuaZipNameFilter wildcard(
+        const QString &pattern, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+    /// Matches the names where \a re finds a match.
+    /**
+      Use anchors to match whole names.
+    */
+    static QuaZipNameFilter regularExpression(const QRegularExpression &re);
+
+    /// Returns a filter that matches the names matched by both filters.
+    QuaZipNameFilter operator&(const QuaZipNameFilter &other) const;
+    /// Whether the filter has no conditions.
+    bool matchesAll() const;
+    /// Checks a decoded name.
+    bool matches(const QString &name) const;
+
+private:
+    QSharedDataPointer<QuaZipNameFilterPrivate> d;
+};
@@ -124,6 +124,13 @@ void QuaZipNewInfo::setPermissions(QFile::Permissions permissions)
     QuaZipNewInfo_setPermissions(this, permissions, name.endsWith('/'));
 }
 
+void QuaZipNewInfo::setFileStatus(const QDateTime &lastModified,
+        QFile::Permissions permissions, bool isDir, bool isSymLink)
+{
+    dateTime = lastModified;
+    QuaZipNewInfo_setPermissions(this, permissions, isDir, isSymLink);
+}
+
 void QuaZipNewInfo::setFileNTFSTimes(const QString &fileName)
 {
     QFileInfo fi(fileName);
@@ -144,6 +144,14 @@ struct QUAZIP_EXPORT QuaZipNewInfo {
     otherwise.
     */
   void setPermissions(QFile::Permissions permissions);
+  /// Sets the timestamp and the permissions of a file examined before.
+  /**
+    Does what the QuaZipNewInfo(const QString&, const QString&)
+    constructor does for an existing file, for callers that already
+    have the status of the file and do not want it read again.
+    */
+  void setFileStatus(const QDateTime &lastModified,
+      QFile::Permissions permissions, bool isDir, bool isSymLink = false);
   /// Sets the NTFS times from an existing file.
   /**
    * If the file doesn't exist, a warning is printed to the stderr and nothing
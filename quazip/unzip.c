@@ -78,6 +78,11 @@
 typedef uLongf z_crc_t;
 #endif
 #include "unzip.h"
+#include "zipcodec.h"
+
+#ifdef HAVE_LIBDEFLATE
+#include <libdeflate.h>
+#endif
 
 #ifdef STDC
 #  include <stddef.h>
@@ -161,6 +166,8 @@ typedef struct
     uLong compression_method;   /* compression method (0==store) */
     ZPOS64_T byte_before_the_zipfile;/* byte before the zipfile, (>0 for sfx)*/
     int   raw;
+    const zip_codec* codec;     /* codec of a method other than deflate */
+    voidpf codec_state;         /* state of the codec while decompressing */
 } file_in_zip64_read_info_s;
 
 
@@ -195,6 +202,9 @@ typedef struct
     unsigned long keys[3];     /* keys defining the pseudo-random sequence */
     const z_crc_t FAR * pcrc_32_tab;
 #    endif
+#    ifdef HAVE_LIBDEFLATE
+    struct libdeflate_decompressor* decompressor; /* for unzInflateBuffer */
+#    endif
 } unz64_s;
 
 
@@ -432,7 +442,7 @@ local ZPOS64_T unz64local_SearchCentralDir(const zlib_filefunc64_32_def* pzlib_f
     if (uMaxBack>uSizeFile)
         uMaxBack = uSizeFile;
 
-    buf = (unsigned char*)ALLOC(BUFREADCOMMENT+4);
+    buf = (unsigned char*)ZALLOC64(*pzlib_filefunc_def,BUFREADCOMMENT+4);
     if (buf==NULL)
         return 0;
 
@@ -467,7 +477,7 @@ local ZPOS64_T unz64local_SearchCentralDir(const zlib_filefunc64_32_def* pzlib_f
         if (uPosFound!=0)
             break;
     }
-    TRYFREE(buf);
+    ZTRYFREE64(*pzlib_filefunc_def,buf);
     return uPosFound;
 }
 
@@ -500,7 +510,7 @@ local ZPOS64_T unz64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
     if (uMaxBack>uSizeFile)
         uMaxBack = uSizeFile;
 
-    buf = (unsigned char*)ALLOC(BUFREADCOMMENT+4);
+    buf = (unsigned char*)ZALLOC64(*pzlib_filefunc_def,BUFREADCOMMENT+4);
     if (buf==NULL)
         return 0;
 
@@ -535,7 +545,7 @@ local ZPOS64_T unz64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
         if (uPosFound!=0)
             break;
     }
-    TRYFREE(buf);
+    ZTRYFREE64(*pzlib_filefunc_def,buf);
     if (uPosFound == 0)
         return 0;
 
@@ -612,7 +622,10 @@ extern unzFile unzOpenInternal (voidpf file,
     us.z_filefunc.zseek32_file = NULL;
     us.z_filefunc.ztell32_file = NULL;
     if (pzlib_filefunc64_32_def==NULL)
+    {
         fill_qiodevice64_filefunc(&us.z_filefunc.zfile_func64);
+        fill_default_allocfunc(&us.z_filefunc.zalloc_mem);
+    }
     else
         us.z_filefunc = *pzlib_filefunc64_32_def;
     us.is64bitOpenFunction = is64bitOpenFunction;
@@ -759,9 +772,12 @@ extern unzFile unzOpenInternal (voidpf file,
     us.central_pos = central_pos;
     us.pfile_in_zip_read = NULL;
     us.encrypted = 0;
+#    ifdef HAVE_LIBDEFLATE
+    us.decompressor = NULL;
+#    endif
 
 
-    s=(unz64_s*)ALLOC(sizeof(unz64_s));
+    s=(unz64_s*)ZALLOC64(us.z_filefunc,sizeof(unz64_s));
     if( s != NULL)
     {
         *s=us;
@@ -793,6 +809,7 @@ extern unzFile ZEXPORT unzOpen2_64 (voidpf file,
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        fill_default_allocfunc(&zlib_filefunc64_32_def_fill.zalloc_mem);
         return unzOpenInternal(file, &zlib_filefunc64_32_def_fill, 1, UNZ_DEFAULT_FLAGS);
     }
     else
@@ -828,7 +845,11 @@ extern int ZEXPORT unzClose (unzFile file)
         ZCLOSE64(s->z_filefunc, s->filestream);
     else
         ZFAKECLOSE64(s->z_filefunc, s->filestream);
-    TRYFREE(s);
+#    ifdef HAVE_LIBDEFLATE
+    if (s->decompressor != NULL)
+        libdeflate_free_decompressor(s->decompressor);
+#    endif
+    ZTRYFREE64(s->z_filefunc,s);
     return UNZ_OK;
 }
 
@@ -1436,7 +1457,8 @@ local int unz64local_CheckCurrentFileCoherencyHeader (unz64_s* s, uInt* piSizeVa
 /* #ifdef HAVE_BZIP2 */
                          (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
 /* #endif */
-                         (s->cur_file_info.compression_method!=Z_DEFLATED))
+                         (s->cur_file_info.compression_method!=Z_DEFLATED) &&
+                         (zipFindCodec((int)s->cur_file_info.compression_method)==NULL))
         err=UNZ_BADZIPFILE;
 
     if (unz64local_getLong(&s->z_filefunc, s->filestream,&uData) != UNZ_OK) /* date/time */
@@ -1507,11 +1529,11 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     if (unz64local_CheckCurrentFileCoherencyHeader(s,&iSizeVar, &offset_local_extrafield,&size_local_extrafield)!=UNZ_OK)
         return UNZ_BADZIPFILE;
 
-    pfile_in_zip_read_info = (file_in_zip64_read_info_s*)ALLOC(sizeof(file_in_zip64_read_info_s));
+    pfile_in_zip_read_info = (file_in_zip64_read_info_s*)ZALLOC64(s->z_filefunc,sizeof(file_in_zip64_read_info_s));
     if (pfile_in_zip_read_info==NULL)
         return UNZ_INTERNALERROR;
 
-    pfile_in_zip_read_info->read_buffer=(char*)ALLOC(UNZ_BUFSIZE);
+    pfile_in_zip_read_info->read_buffer=(char*)ZALLOC64(s->z_filefunc,UNZ_BUFSIZE);
     pfile_in_zip_read_info->offset_local_extrafield = offset_local_extrafield;
     pfile_in_zip_read_info->size_local_extrafield = size_local_extrafield;
     pfile_in_zip_read_info->pos_local_extrafield=0;
@@ -1519,7 +1541,7 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
 
     if (pfile_in_zip_read_info->read_buffer==NULL)
     {
-        TRYFREE(pfile_in_zip_read_info);
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info);
         return UNZ_INTERNALERROR;
     }
 
@@ -1539,13 +1561,20 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
         }
     }
 
+    pfile_in_zip_read_info->codec=NULL;
+    pfile_in_zip_read_info->codec_state=NULL;
     if ((s->cur_file_info.compression_method!=0) &&
 /* #ifdef HAVE_BZIP2 */
         (s->cur_file_info.compression_method!=Z_BZIP2ED) &&
 /* #endif */
         (s->cur_file_info.compression_method!=Z_DEFLATED))
-
-        err=UNZ_BADZIPFILE;
+    {
+        pfile_in_zip_read_info->codec =
+            zipFindCodec((int)s->cur_file_info.compression_method);
+        if ((pfile_in_zip_read_info->codec==NULL) ||
+            (!raw && pfile_in_zip_read_info->codec->decompress_init==NULL))
+            err=UNZ_BADZIPFILE;
+    }
 
     pfile_in_zip_read_info->crc32_wait=s->cur_file_info.crc;
     pfile_in_zip_read_info->crc32=0;
@@ -1576,7 +1605,7 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
         pfile_in_zip_read_info->stream_initialised=Z_BZIP2ED;
       else
       {
-        TRYFREE(pfile_in_zip_read_info);
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info);
         return err;
       }
 #else
@@ -1585,9 +1614,9 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     }
     else if ((s->cur_file_info.compression_method==Z_DEFLATED) && (!raw))
     {
-      pfile_in_zip_read_info->stream.zalloc = (alloc_func)0;
-      pfile_in_zip_read_info->stream.zfree = (free_func)0;
-      pfile_in_zip_read_info->stream.opaque = (voidpf)0;
+      pfile_in_zip_read_info->stream.zalloc = call_zlib_alloc;
+      pfile_in_zip_read_info->stream.zfree = call_zlib_free;
+      pfile_in_zip_read_info->stream.opaque = (voidpf)&pfile_in_zip_read_info->z_filefunc.zalloc_mem;
       pfile_in_zip_read_info->stream.next_in = 0;
       pfile_in_zip_read_info->stream.avail_in = 0;
 
@@ -1596,8 +1625,8 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
         pfile_in_zip_read_info->stream_initialised=Z_DEFLATED;
       else
       {
-        TRYFREE(pfile_in_zip_read_info->read_buffer);
-        TRYFREE(pfile_in_zip_read_info);
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info->read_buffer);
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info);
         return err;
       }
         /* windowBits is passed < 0 to tell that there is no zlib header.
@@ -1608,6 +1637,24 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
          * size of both compressed and uncompressed data
          */
     }
+    else if ((pfile_in_zip_read_info->codec!=NULL) && (err==UNZ_OK) && (!raw))
+    {
+      pfile_in_zip_read_info->stream.next_in = 0;
+      pfile_in_zip_read_info->stream.avail_in = 0;
+      pfile_in_zip_read_info->stream.total_in = 0;
+
+      err=pfile_in_zip_read_info->codec->decompress_init(
+              &pfile_in_zip_read_info->codec_state,
+              &pfile_in_zip_read_info->z_filefunc.zalloc_mem);
+      if (err == Z_OK)
+        pfile_in_zip_read_info->stream_initialised=(uLong)s->cur_file_info.compression_method;
+      else
+      {
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info->read_buffer);
+        ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info);
+        return err;
+      }
+    }
     pfile_in_zip_read_info->rest_read_compressed =
             s->cur_file_info.compressed_size ;
     pfile_in_zip_read_info->rest_read_uncompressed =
@@ -1682,6 +1729,18 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64( unzFile file)
 
 /** Addition for GDAL : END */
 
+extern ZPOS64_T ZEXPORT unzGetCurrentFileHeaderPos64(unzFile file)
+{
+    unz64_s* s;
+    if (file==NULL)
+        return 0;
+    s=(unz64_s*)file;
+    if (!s->current_file_ok)
+        return 0;
+    return s->cur_file_info_internal.offset_curfile +
+           s->byte_before_the_zipfile;
+}
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -1730,6 +1789,54 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 
     while (pfile_in_zip_read_info->stream.avail_out>0)
     {
+        if (((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw)) &&
+            (pfile_in_zip_read_info->stream.avail_in==0) &&
+            (pfile_in_zip_read_info->rest_read_compressed>0) &&
+            (pfile_in_zip_read_info->stream.avail_out>=UNZ_BUFSIZE))
+        {
+            /* large read of stored or raw data: read right into buf,
+               no copy through read_buffer */
+            uInt uReadThis = pfile_in_zip_read_info->stream.avail_out;
+            if (pfile_in_zip_read_info->rest_read_compressed<uReadThis)
+                uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
+            if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                      pfile_in_zip_read_info->filestream,
+                      pfile_in_zip_read_info->pos_in_zipfile +
+                         pfile_in_zip_read_info->byte_before_the_zipfile,
+                         ZLIB_FILEFUNC_SEEK_SET)!=0)
+                return UNZ_ERRNO;
+            if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                      pfile_in_zip_read_info->filestream,
+                      pfile_in_zip_read_info->stream.next_out,
+                      uReadThis)!=uReadThis)
+                return UNZ_ERRNO;
+
+#            ifndef NOUNCRYPT
+            if(s->encrypted)
+            {
+                uInt i;
+                for(i=0;i<uReadThis;i++)
+                  pfile_in_zip_read_info->stream.next_out[i] =
+                      zdecode(s->keys,s->pcrc_32_tab,
+                              pfile_in_zip_read_info->stream.next_out[i]);
+            }
+#            endif
+
+            pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+            pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uReadThis;
+            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
+                                pfile_in_zip_read_info->stream.next_out,
+                                uReadThis);
+            pfile_in_zip_read_info->rest_read_uncompressed-=uReadThis;
+            pfile_in_zip_read_info->stream.avail_out -= uReadThis;
+            pfile_in_zip_read_info->stream.next_out += uReadThis;
+            pfile_in_zip_read_info->stream.total_out += uReadThis;
+            iRead += uReadThis;
+            continue;
+        }
+
         if ((pfile_in_zip_read_info->stream.avail_in==0) &&
             (pfile_in_zip_read_info->rest_read_compressed>0))
         {
@@ -1774,7 +1881,7 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 
         if ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw))
         {
-            uInt uDoCopy,i ;
+            uInt uDoCopy;
 
             if ((pfile_in_zip_read_info->stream.avail_in == 0) &&
                 (pfile_in_zip_read_info->rest_read_compressed == 0))
@@ -1786,9 +1893,8 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             else
                 uDoCopy = pfile_in_zip_read_info->stream.avail_in ;
 
-            for (i=0;i<uDoCopy;i++)
-                *(pfile_in_zip_read_info->stream.next_out+i) =
-                        *(pfile_in_zip_read_info->stream.next_in+i);
+            memcpy(pfile_in_zip_read_info->stream.next_out,
+                   pfile_in_zip_read_info->stream.next_in, uDoCopy);
 
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uDoCopy;
 
@@ -1846,6 +1952,34 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
               break;
 #endif
         } /* end Z_BZIP2ED */
+        else if (pfile_in_zip_read_info->codec!=NULL)
+        {
+            uInt uAvailOutBefore,uOutThis;
+            const Bytef *bufBefore;
+
+            uAvailOutBefore = pfile_in_zip_read_info->stream.avail_out;
+            bufBefore = pfile_in_zip_read_info->stream.next_out;
+
+            err=pfile_in_zip_read_info->codec->decompress(
+                    pfile_in_zip_read_info->codec_state,
+                    &pfile_in_zip_read_info->stream);
+
+            uOutThis = uAvailOutBefore - pfile_in_zip_read_info->stream.avail_out;
+
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
+
+            pfile_in_zip_read_info->crc32
+                    = crc32(pfile_in_zip_read_info->crc32,bufBefore, uOutThis);
+
+            pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
+
+            iRead += uOutThis;
+
+            if (err==Z_STREAM_END)
+                return (iRead==0) ? UNZ_EOF : iRead;
+            if (err!=Z_OK)
+                break;
+        }
         else
         {
             uInt uAvailOutBefore,uAvailOutAfter;
@@ -1886,6 +2020,204 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 }
 
 
+/*
+  Decompress a whole raw deflate buffer in one call.
+*/
+extern int ZEXPORT unzInflateBuffer (unzFile file, voidp dest, uLong destLen,
+                                     const void* source, uLong sourceLen,
+                                     uLong* outLen)
+{
+    unz64_s* s;
+    if (file==NULL || (dest==NULL && destLen>0) || (source==NULL && sourceLen>0))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+
+#ifdef HAVE_LIBDEFLATE
+    {
+        size_t actual;
+        enum libdeflate_result result;
+
+        if (s->decompressor == NULL)
+        {
+            s->decompressor = libdeflate_alloc_decompressor();
+            if (s->decompressor == NULL)
+                return Z_MEM_ERROR;
+        }
+
+        result = libdeflate_deflate_decompress(s->decompressor,
+                                               source, (size_t)sourceLen,
+                                               dest, (size_t)destLen,
+                                               &actual);
+        if (result == LIBDEFLATE_BAD_DATA)
+            return Z_DATA_ERROR;
+        if (result != LIBDEFLATE_SUCCESS)
+            return Z_BUF_ERROR;
+        if (outLen != NULL)
+            *outLen = (uLong)actual;
+        return UNZ_OK;
+    }
+#else
+    {
+        z_stream stream;
+        int err;
+
+        stream.zalloc = call_zlib_alloc;
+        stream.zfree = call_zlib_free;
+        stream.opaque = (voidpf)&s->z_filefunc.zalloc_mem;
+        stream.next_in = (z_const Bytef*)source;
+        stream.avail_in = 0;
+        err = inflateInit2(&stream, -MAX_WBITS);
+        if (err != Z_OK)
+            return err;
+
+        stream.next_out = (Bytef*)dest;
+        stream.avail_out = 0;
+        do
+        {
+            /* usually one call, more only for buffers over 4 GB */
+            uLong in_left = sourceLen - stream.total_in;
+            uLong out_left = destLen - stream.total_out;
+            if (stream.avail_in == 0)
+                stream.avail_in = in_left > (uInt)-1 ? (uInt)-1 : (uInt)in_left;
+            if (stream.avail_out == 0)
+                stream.avail_out = out_left > (uInt)-1 ? (uInt)-1 : (uInt)out_left;
+            err = inflate(&stream, Z_FINISH);
+        } while (err == Z_OK || (err == Z_BUF_ERROR &&
+                 stream.total_in < sourceLen && stream.total_out < destLen));
+
+        if (outLen != NULL)
+            *outLen = stream.total_out;
+        inflateEnd(&stream);
+        if (err == Z_STREAM_END)
+            return UNZ_OK;
+        if (err == Z_NEED_DICT)
+            return Z_DATA_ERROR;
+        return err;
+    }
+#endif
+}
+
+
+local uLong unz64local_crc32_64 (uLong crc, const void* buf, ZPOS64_T len)
+{
+    const Bytef* p = (const Bytef*)buf;
+    while (len > 0)
+    {
+        uInt chunk = len > 0x40000000 ? 0x40000000 : (uInt)len;
+        crc = crc32(crc, p, chunk);
+        p += chunk;
+        len -= chunk;
+    }
+    return crc;
+}
+
+local int unz64local_ReadCurrentFileLoop (unzFile file, voidp buf,
+                                          ZPOS64_T len, const char* password)
+{
+    ZPOS64_T done = 0;
+    int err = unzOpenCurrentFile3(file, NULL, NULL, 0, password);
+    if (err != UNZ_OK)
+        return err;
+
+    while (done < len)
+    {
+        unsigned chunk = len - done > 0x40000000 ? 0x40000000 : (unsigned)(len - done);
+        int read = unzReadCurrentFile(file, (Bytef*)buf + done, chunk);
+        if (read <= 0)
+        {
+            err = read < 0 ? read : UNZ_BADZIPFILE;
+            break;
+        }
+        done += (ZPOS64_T)read;
+    }
+
+    if (err == UNZ_OK)
+        return unzCloseCurrentFile(file);
+    unzCloseCurrentFile(file);
+    return err;
+}
+
+/*
+  Read the whole current file with one read of the compressed data.
+*/
+extern int ZEXPORT unzReadCurrentFileAtOnce (unzFile file, voidp buf,
+                                             ZPOS64_T len, const char* password)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    ZPOS64_T compressed_size;
+    uLong method;
+    voidp compressed;
+    uLong out_len = 0;
+    int err;
+
+    if (file==NULL || (buf==NULL && len>0))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (!s->current_file_ok || s->pfile_in_zip_read!=NULL)
+        return UNZ_PARAMERROR;
+    if (len != s->cur_file_info.uncompressed_size)
+        return UNZ_PARAMERROR;
+
+    method = s->cur_file_info.compression_method;
+    compressed_size = s->cur_file_info.compressed_size;
+    if ((password != NULL) || ((s->cur_file_info.flag & 1) != 0) ||
+        ((method != 0) && (method != Z_DEFLATED)) ||
+        (compressed_size != (uLong)compressed_size) || (len != (uLong)len))
+        return unz64local_ReadCurrentFileLoop(file, buf, len, password);
+
+    err = unzOpenCurrentFile3(file, NULL, NULL, 1, NULL);
+    if (err != UNZ_OK)
+        return err;
+    pfile_in_zip_read_info = s->pfile_in_zip_read;
+
+    if (method == 0)
+    {
+        /* stored data goes right into buf */
+        if (compressed_size != len)
+            err = UNZ_BADZIPFILE;
+        compressed = buf;
+    }
+    else
+    {
+        compressed = ZALLOC64(s->z_filefunc, compressed_size);
+        if (compressed == NULL && compressed_size > 0)
+            err = UNZ_INTERNALERROR;
+    }
+
+    if (err == UNZ_OK && compressed_size > 0)
+    {
+        if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                    pfile_in_zip_read_info->filestream,
+                    pfile_in_zip_read_info->pos_in_zipfile +
+                        pfile_in_zip_read_info->byte_before_the_zipfile,
+                    ZLIB_FILEFUNC_SEEK_SET) != 0)
+            err = UNZ_ERRNO;
+        else if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                         pfile_in_zip_read_info->filestream,
+                         compressed, (uLong)compressed_size) != compressed_size)
+            err = UNZ_ERRNO;
+    }
+
+    if (err == UNZ_OK && method == Z_DEFLATED)
+    {
+        err = unzInflateBuffer(file, buf, (uLong)len,
+                               compressed, (uLong)compressed_size, &out_len);
+        if (err == UNZ_OK && out_len != len)
+            err = UNZ_BADZIPFILE;
+    }
+
+    if (compressed != buf)
+        ZTRYFREE64(s->z_filefunc, compressed);
+    unzCloseCurrentFile(file);
+
+    if (err == UNZ_OK &&
+        unz64local_crc32_64(crc32(0L, Z_NULL, 0), buf, len) != s->cur_file_info.crc)
+        err = UNZ_CRCERROR;
+    return err;
+}
+
+
 /*
   Give the current position in uncompressed data
 */
@@ -2027,9 +2359,12 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
     }
 
 
-    TRYFREE(pfile_in_zip_read_info->read_buffer);
+    ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info->read_buffer);
     pfile_in_zip_read_info->read_buffer = NULL;
-    if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATED)
+    if ((pfile_in_zip_read_info->codec != NULL) &&
+        (pfile_in_zip_read_info->stream_initialised != 0))
+        pfile_in_zip_read_info->codec->decompress_end(pfile_in_zip_read_info->codec_state);
+    else if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATED)
         inflateEnd(&pfile_in_zip_read_info->stream);
 #ifdef HAVE_BZIP2
     else if (pfile_in_zip_read_info->stream_initialised == Z_BZIP2ED)
@@ -2038,7 +2373,7 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
 
 
     pfile_in_zip_read_info->stream_initialised = 0;
-    TRYFREE(pfile_in_zip_read_info);
+    ZTRYFREE64(s->z_filefunc,pfile_in_zip_read_info);
 
     s->pfile_in_zip_read=NULL;
 
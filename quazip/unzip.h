@@ -342,6 +342,13 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64 OF((unzFile file));
 
 /** Addition for GDAL : END */
 
+extern ZPOS64_T ZEXPORT unzGetCurrentFileHeaderPos64 OF((unzFile file));
+/*
+  Get the position of the local header of the current file in the archive
+  file, without opening the current file. Return 0 if there is no current
+  file. Useful to read several files in the order of their data.
+*/
+
 
 /***************************************************************************/
 /* for reading the content of the current zipfile, you can open it, read data
@@ -410,6 +417,45 @@ extern int ZEXPORT unzReadCurrentFile OF((unzFile file,
     (UNZ_ERRNO for IO error, or zLib error for uncompress error)
 */
 
+extern int ZEXPORT unzInflateBuffer OF((unzFile file,
+                      voidp dest,
+                      uLong destLen,
+                      const void* source,
+                      uLong sourceLen,
+                      uLong* outLen));
+/*
+  Decompress raw deflate data held entirely in memory with one call,
+    without the refill loop of unzReadCurrentFile.
+  dest must have room for all the data, for example the uncompressed size
+    from the central directory.
+  Uses libdeflate when built with HAVE_LIBDEFLATE, inflate() otherwise.
+    The libdeflate decompressor is kept with the file until unzClose,
+    so a file must not be used by several threads at once.
+  *outLen receives the decompressed size if outLen is not NULL.
+
+  return UNZ_OK if the data was decompressed
+  return Z_BUF_ERROR if dest is too small or the data is truncated
+  return Z_DATA_ERROR if the data is corrupted
+*/
+
+extern int ZEXPORT unzReadCurrentFileAtOnce OF((unzFile file,
+                      voidp buf,
+                      ZPOS64_T len,
+                      const char* password));
+/*
+  Read the whole current file, which must not be opened, into buf.
+  len must be the uncompressed size from unzGetCurrentFileInfo64.
+  Stored and deflated entries are read with a single read of the
+    compressed size, deflated ones are then decompressed with
+    unzInflateBuffer. Other methods and encrypted entries go through
+    unzReadCurrentFile.
+
+  return UNZ_OK if the file was read and the CRC is good
+  return UNZ_CRCERROR if the CRC is not good
+  return UNZ_PARAMERROR if len is not the uncompressed size
+  return <0 with error code otherwise
+*/
+
 extern z_off_t ZEXPORT unztell OF((unzFile file));
 
 extern ZPOS64_T ZEXPORT unztell64 OF((unzFile file));
@@ -37,6 +37,7 @@
 typedef uLongf z_crc_t;
 #endif
 #include "zip.h"
+#include "zipcodec.h"
 
 #ifdef STDC
 #  include <stddef.h>
@@ -134,6 +135,7 @@ typedef struct linkedlist_data_s
 {
     linkedlist_datablock_internal* first_block;
     linkedlist_datablock_internal* last_block;
+    zlib_allocfunc_def zalloc_mem;
 } linkedlist_data;
 
 
@@ -157,6 +159,8 @@ typedef struct
 
     int  method;                /* compression method of file currenty wr.*/
     int  raw;                   /* 1 for directly writing raw data */
+    const zip_codec* codec;     /* codec of a method other than deflate */
+    voidpf codec_state;         /* state of the codec while compressing */
     Byte buffered_data[Z_BUFSIZE];/* buffer contain compressed data to be writ*/
     uLong dosDate;
     uLong crc32;
@@ -198,11 +202,11 @@ typedef struct
 #include "minizip_crypt.h"
 #endif
 
-local linkedlist_datablock_internal* allocate_new_datablock()
+local linkedlist_datablock_internal* allocate_new_datablock(linkedlist_data* ll)
 {
     linkedlist_datablock_internal* ldi;
     ldi = (linkedlist_datablock_internal*)
-                 ALLOC(sizeof(linkedlist_datablock_internal));
+                 ZALLOC64(*ll, sizeof(linkedlist_datablock_internal));
     if (ldi!=NULL)
     {
         ldi->next_datablock = NULL ;
@@ -212,24 +216,25 @@ local linkedlist_datablock_internal* allocate_new_datablock()
     return ldi;
 }
 
-local void free_datablock(linkedlist_datablock_internal* ldi)
+local void free_datablock(linkedlist_data* ll, linkedlist_datablock_internal* ldi)
 {
     while (ldi!=NULL)
     {
         linkedlist_datablock_internal* ldinext = ldi->next_datablock;
-        TRYFREE(ldi);
+        ZTRYFREE64(*ll, ldi);
         ldi = ldinext;
     }
 }
 
-local void init_linkedlist(linkedlist_data* ll)
+local void init_linkedlist(linkedlist_data* ll, const zlib_allocfunc_def* pzlib_allocfunc_def)
 {
     ll->first_block = ll->last_block = NULL;
+    ll->zalloc_mem = *pzlib_allocfunc_def;
 }
 
 local void free_linkedlist(linkedlist_data* ll)
 {
-    free_datablock(ll->first_block);
+    free_datablock(ll, ll->first_block);
     ll->first_block = ll->last_block = NULL;
 }
 
@@ -244,7 +249,7 @@ local int add_data_in_datablock(linkedlist_data* ll, const void* buf, uLong len)
 
     if (ll->last_block == NULL)
     {
-        ll->first_block = ll->last_block = allocate_new_datablock();
+        ll->first_block = ll->last_block = allocate_new_datablock(ll);
         if (ll->first_block == NULL)
             return ZIP_INTERNALERROR;
     }
@@ -260,7 +265,7 @@ local int add_data_in_datablock(linkedlist_data* ll, const void* buf, uLong len)
 
         if (ldi->avail_in_this_block==0)
         {
-            ldi->next_datablock = allocate_new_datablock();
+            ldi->next_datablock = allocate_new_datablock(ll);
             if (ldi->next_datablock == NULL)
                 return ZIP_INTERNALERROR;
             ldi = ldi->next_datablock ;
@@ -506,7 +511,7 @@ local ZPOS64_T zip64local_SearchCentralDir(const zlib_filefunc64_32_def* pzlib_f
   if (uMaxBack>uSizeFile)
     uMaxBack = uSizeFile;
 
-  buf = (unsigned char*)ALLOC(BUFREADCOMMENT+4);
+  buf = (unsigned char*)ZALLOC64(*pzlib_filefunc_def,BUFREADCOMMENT+4);
   if (buf==NULL)
     return 0;
 
@@ -542,7 +547,7 @@ local ZPOS64_T zip64local_SearchCentralDir(const zlib_filefunc64_32_def* pzlib_f
       if (uPosFound!=0)
         break;
   }
-  TRYFREE(buf);
+  ZTRYFREE64(*pzlib_filefunc_def,buf);
   return uPosFound;
 }
 
@@ -570,7 +575,7 @@ local ZPOS64_T zip64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
   if (uMaxBack>uSizeFile)
     uMaxBack = uSizeFile;
 
-  buf = (unsigned char*)ALLOC(BUFREADCOMMENT+4);
+  buf = (unsigned char*)ZALLOC64(*pzlib_filefunc_def,BUFREADCOMMENT+4);
   if (buf==NULL)
     return 0;
 
@@ -608,7 +613,7 @@ local ZPOS64_T zip64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
         break;
   }
 
-  TRYFREE(buf);
+  ZTRYFREE64(*pzlib_filefunc_def,buf);
   if (uPosFound == 0)
     return 0;
 
@@ -815,7 +820,7 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
 
   if (size_comment>0)
   {
-    pziinit->globalcomment = (char*)ALLOC(size_comment+1);
+    pziinit->globalcomment = (char*)ZALLOC64(pziinit->z_filefunc,size_comment+1);
     if (pziinit->globalcomment)
     {
       size_comment = ZREAD64(pziinit->z_filefunc, pziinit->filestream, pziinit->globalcomment,size_comment);
@@ -829,7 +834,7 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
   {
     ZPOS64_T size_central_dir_to_read = size_central_dir;
     size_t buf_size = SIZEDATA_INDATABLOCK;
-    void* buf_read = (void*)ALLOC(buf_size);
+    void* buf_read = (void*)ZALLOC64(pziinit->z_filefunc,buf_size);
     if (ZSEEK64(pziinit->z_filefunc, pziinit->filestream, offset_central_dir + byte_before_the_zipfile, ZLIB_FILEFUNC_SEEK_SET) != 0)
       err=ZIP_ERRNO;
 
@@ -847,7 +852,7 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
 
       size_central_dir_to_read-=read_this;
     }
-    TRYFREE(buf_read);
+    ZTRYFREE64(pziinit->z_filefunc,buf_read);
   }
   pziinit->begin_pos = byte_before_the_zipfile;
   pziinit->number_entry = number_entry_CD;
@@ -874,7 +879,10 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.z_filefunc.zseek32_file = NULL;
     ziinit.z_filefunc.ztell32_file = NULL;
     if (pzlib_filefunc64_32_def==NULL)
+    {
         fill_qiodevice64_filefunc(&ziinit.z_filefunc.zfile_func64);
+        fill_default_allocfunc(&ziinit.z_filefunc.zalloc_mem);
+    }
     else
         ziinit.z_filefunc = *pzlib_filefunc64_32_def;
 
@@ -895,11 +903,11 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.ci.stream_initialised = 0;
     ziinit.number_entry = 0;
     ziinit.add_position_when_writting_offset = 0;
-    init_linkedlist(&(ziinit.central_dir));
+    init_linkedlist(&(ziinit.central_dir), &ziinit.z_filefunc.zalloc_mem);
 
 
 
-    zi = (zip64_internal*)ALLOC(sizeof(zip64_internal));
+    zi = (zip64_internal*)ZALLOC64(ziinit.z_filefunc,sizeof(zip64_internal));
     if (zi==NULL)
     {
         if ((ziinit.flags & ZIP_AUTO_CLOSE) != 0) {
@@ -928,9 +936,10 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     if (err != ZIP_OK)
     {
 #    ifndef NO_ADDFILEINEXISTINGZIP
-        TRYFREE(ziinit.globalcomment);
+        ZTRYFREE64(ziinit.z_filefunc,ziinit.globalcomment);
 #    endif /* !NO_ADDFILEINEXISTINGZIP*/
-        TRYFREE(zi);
+        free_linkedlist(&ziinit.central_dir);
+        ZTRYFREE64(ziinit.z_filefunc,zi);
         return NULL;
     }
     else
@@ -960,6 +969,7 @@ extern zipFile ZEXPORT zipOpen2_64 (voidpf file, int append, zipcharpc* globalco
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        fill_default_allocfunc(&zlib_filefunc64_32_def_fill.zalloc_mem);
         return zipOpen3(file, append, globalcomment, &zlib_filefunc64_32_def_fill, ZIP_DEFAULT_FLAGS);
     }
     else
@@ -1092,6 +1102,7 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     uInt i;
     int err = ZIP_OK;
     uLong version_to_extract;
+    const zip_codec* codec;
 
 #    ifdef NOCRYPT
     if (password != NULL)
@@ -1101,13 +1112,17 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     if (file == NULL)
         return ZIP_PARAMERROR;
 
+    codec = NULL;
+    if ((method!=0) && (method!=Z_DEFLATED)
 #ifdef HAVE_BZIP2
-    if ((method!=0) && (method!=Z_DEFLATED) && (method!=Z_BZIP2ED))
-      return ZIP_PARAMERROR;
-#else
-    if ((method!=0) && (method!=Z_DEFLATED))
-      return ZIP_PARAMERROR;
+            && (method!=Z_BZIP2ED)
 #endif
+       )
+    {
+      codec = zipFindCodec(method);
+      if ((codec == NULL) || (!raw && codec->compress_init == NULL))
+        return ZIP_PARAMERROR;
+    }
 
     zi = (zip64_internal*)file;
 
@@ -1124,6 +1139,10 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     {
         version_to_extract = 10;
     }
+    else if ((codec != NULL) && (codec->version_needed > 20))
+    {
+        version_to_extract = codec->version_needed;
+    }
     else
     {
         version_to_extract = 20;
@@ -1165,6 +1184,8 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
 
     zi->ci.crc32 = 0;
     zi->ci.method = method;
+    zi->ci.codec = codec;
+    zi->ci.codec_state = NULL;
     zi->ci.encrypt = 0;
     zi->ci.stream_initialised = 0;
     zi->ci.pos_in_buffered_data = 0;
@@ -1174,7 +1195,7 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     zi->ci.size_centralheader = SIZECENTRALHEADER + size_filename + size_extrafield_global + size_comment;
     zi->ci.size_centralExtraFree = 32; /* Extra space we have reserved in case we need to add ZIP64 extra info data */
 
-    zi->ci.central_header = (char*)ALLOC((uInt)zi->ci.size_centralheader + zi->ci.size_centralExtraFree);
+    zi->ci.central_header = (char*)ZALLOC64(zi->z_filefunc,(uInt)zi->ci.size_centralheader + zi->ci.size_centralExtraFree);
     if(!zi->ci.central_header) {
       return (Z_MEM_ERROR);
     }
@@ -1256,9 +1277,9 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
     {
         if(zi->ci.method == Z_DEFLATED)
         {
-          zi->ci.stream.zalloc = (alloc_func)0;
-          zi->ci.stream.zfree = (free_func)0;
-          zi->ci.stream.opaque = (voidpf)0;
+          zi->ci.stream.zalloc = call_zlib_alloc;
+          zi->ci.stream.zfree = call_zlib_free;
+          zi->ci.stream.opaque = (voidpf)&zi->z_filefunc.zalloc_mem;
 
           if (windowBits>0)
               windowBits = -windowBits;
@@ -1283,6 +1304,13 @@ extern int ZEXPORT zipOpenNewFileInZip4_64 (zipFile file, const char* filename,
         }
 
     }
+    else if ((err==ZIP_OK) && (zi->ci.codec != NULL) && (!zi->ci.raw))
+    {
+        err = zi->ci.codec->compress_init(&zi->ci.codec_state, level,
+                                          &zi->z_filefunc.zalloc_mem);
+        if (err==Z_OK)
+            zi->ci.stream_initialised = zi->ci.method;
+    }
 
 #    ifndef NOCRYPT
     zi->ci.crypt_header_size = 0;
@@ -1520,6 +1548,12 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
               err=deflate(&zi->ci.stream,  Z_NO_FLUSH);
               zi->ci.pos_in_buffered_data += uAvailOutBefore - zi->ci.stream.avail_out;
           }
+          else if ((zi->ci.codec != NULL) && (!zi->ci.raw))
+          {
+              uInt uAvailOutBefore = zi->ci.stream.avail_out;
+              err=zi->ci.codec->compress(zi->ci.codec_state, &zi->ci.stream, Z_NO_FLUSH);
+              zi->ci.pos_in_buffered_data += uAvailOutBefore - zi->ci.stream.avail_out;
+          }
           else
           {
               uInt copy_this,i;
@@ -1585,6 +1619,25 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
                                 zi->ci.pos_in_buffered_data += uAvailOutBefore - zi->ci.stream.avail_out;
                         }
                 }
+    else if ((zi->ci.codec != NULL) && (!zi->ci.raw))
+    {
+        while (err==ZIP_OK)
+        {
+            uLong uAvailOutBefore;
+            if (zi->ci.stream.avail_out == 0)
+            {
+                if (zip64FlushWriteBuffer(zi) == ZIP_ERRNO)
+                    err = ZIP_ERRNO;
+                zi->ci.stream.avail_out = (uInt)Z_BUFSIZE;
+                zi->ci.stream.next_out = zi->ci.buffered_data;
+            }
+            if (err != ZIP_OK)
+                break;
+            uAvailOutBefore = zi->ci.stream.avail_out;
+            err=zi->ci.codec->compress(zi->ci.codec_state, &zi->ci.stream, Z_FINISH);
+            zi->ci.pos_in_buffered_data += uAvailOutBefore - zi->ci.stream.avail_out;
+        }
+    }
     else if ((zi->ci.method == Z_BZIP2ED) && (!zi->ci.raw))
     {
 #ifdef HAVE_BZIP2
@@ -1628,6 +1681,13 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
             err = tmp_err;
         zi->ci.stream_initialised = 0;
     }
+    else if ((zi->ci.codec != NULL) && (!zi->ci.raw))
+    {
+        if (zi->ci.stream_initialised != 0)
+            zi->ci.codec->compress_end(zi->ci.codec_state);
+        zi->ci.codec_state = NULL;
+        zi->ci.stream_initialised = 0;
+    }
 #ifdef HAVE_BZIP2
     else if((zi->ci.method == Z_BZIP2ED) && (!zi->ci.raw))
     {
@@ -1738,7 +1798,7 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
     if (err==ZIP_OK)
         err = add_data_in_datablock(&zi->central_dir, zi->ci.central_header, (uLong)zi->ci.size_centralheader);
 
-    free(zi->ci.central_header);
+    ZTRYFREE64(zi->z_filefunc,zi->ci.central_header);
 
     if (err==ZIP_OK)
     {
@@ -2010,9 +2070,9 @@ extern int ZEXPORT zipClose (zipFile file, const char* global_comment)
     }
 
 #ifndef NO_ADDFILEINEXISTINGZIP
-    TRYFREE(zi->globalcomment);
+    ZTRYFREE64(zi->z_filefunc,zi->globalcomment);
 #endif
-    TRYFREE(zi);
+    ZTRYFREE64(zi->z_filefunc,zi);
 
     return err;
 }
@@ -2031,7 +2091,7 @@ extern int ZEXPORT zipRemoveExtraInfoBlock (char* pData, int* dataLen, short sHe
   if(pData == NULL || *dataLen < 4)
     return ZIP_PARAMERROR;
 
-  pNewHeader = (char*)ALLOC(*dataLen);
+  pNewHeader = (char*)call_zalloc(NULL,*dataLen);
   if(!pNewHeader) {
     return Z_MEM_ERROR;
   }
@@ -2073,7 +2133,7 @@ extern int ZEXPORT zipRemoveExtraInfoBlock (char* pData, int* dataLen, short sHe
   else
     retVal = ZIP_ERRNO;
 
-  TRYFREE(pNewHeader);
+  call_zfree(NULL,pNewHeader);
 
   return retVal;
 }
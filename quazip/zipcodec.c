@@ -0,0 +1,207 @@
+/* zipcodec.c -- compression methods other than stored and deflate
+
+   Part of QuaZIP, the same terms of use as for zip.h apply.
+*/
+
+#include <string.h>
+
+#include "zlib.h"
+#include "zip.h"
+#include "zipcodec.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#ifndef local
+#  define local static
+#endif
+
+#ifdef HAVE_ZSTD
+
+/* the ZIP headers keep the CRC and sizes, so zstd frames do not need them */
+
+local void zstd_update_stream(z_stream* stream,
+                              const ZSTD_inBuffer* in, const ZSTD_outBuffer* out)
+{
+    stream->next_in += in->pos;
+    stream->avail_in -= (uInt)in->pos;
+    stream->total_in += (uLong)in->pos;
+    stream->next_out += out->pos;
+    stream->avail_out -= (uInt)out->pos;
+    stream->total_out += (uLong)out->pos;
+}
+
+local int zstd_compress_init(voidpf* state, int level,
+                             const zlib_allocfunc_def* alloc)
+{
+    ZSTD_CCtx* cctx;
+    (void)alloc; /* custom allocation is not a part of the stable zstd API */
+
+    cctx = ZSTD_createCCtx();
+    if (cctx == NULL)
+        return Z_MEM_ERROR;
+
+    if (level == Z_DEFAULT_COMPRESSION)
+        level = ZSTD_CLEVEL_DEFAULT;
+
+    if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level))
+            || ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 0)))
+    {
+        ZSTD_freeCCtx(cctx);
+        return Z_STREAM_ERROR;
+    }
+
+    *state = cctx;
+    return Z_OK;
+}
+
+local int zstd_compress(voidpf state, z_stream* stream, int flush)
+{
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    size_t ret;
+
+    in.src = stream->next_in;
+    in.size = stream->avail_in;
+    in.pos = 0;
+    out.dst = stream->next_out;
+    out.size = stream->avail_out;
+    out.pos = 0;
+
+    ret = ZSTD_compressStream2((ZSTD_CCtx*)state, &out, &in,
+                               flush == Z_FINISH ? ZSTD_e_end : ZSTD_e_continue);
+    zstd_update_stream(stream, &in, &out);
+
+    if (ZSTD_isError(ret))
+        return Z_STREAM_ERROR;
+    if (flush == Z_FINISH && ret == 0)
+        return Z_STREAM_END;
+    return Z_OK;
+}
+
+local void zstd_compress_end(voidpf state)
+{
+    ZSTD_freeCCtx((ZSTD_CCtx*)state);
+}
+
+local int zstd_decompress_init(voidpf* state, const zlib_allocfunc_def* alloc)
+{
+    ZSTD_DCtx* dctx;
+    (void)alloc;
+
+    dctx = ZSTD_createDCtx();
+    if (dctx == NULL)
+        return Z_MEM_ERROR;
+
+    *state = dctx;
+    return Z_OK;
+}
+
+local int zstd_decompress(voidpf state, z_stream* stream)
+{
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    size_t ret;
+
+    in.src = stream->next_in;
+    in.size = stream->avail_in;
+    in.pos = 0;
+    out.dst = stream->next_out;
+    out.size = stream->avail_out;
+    out.pos = 0;
+
+    ret = ZSTD_decompressStream((ZSTD_DCtx*)state, &out, &in);
+    zstd_update_stream(stream, &in, &out);
+
+    if (ZSTD_isError(ret))
+        return Z_DATA_ERROR;
+    if (ret == 0)
+        return Z_STREAM_END;
+    if (in.pos == 0 && out.pos == 0)
+        return Z_BUF_ERROR;
+    return Z_OK;
+}
+
+local void zstd_decompress_end(voidpf state)
+{
+    ZSTD_freeDCtx((ZSTD_DCtx*)state);
+}
+
+local const zip_codec zstd_codec =
+{
+    Z_ZSTD,
+    63,
+    zstd_compress_init,
+    zstd_compress,
+    zstd_compress_end,
+    zstd_decompress_init,
+    zstd_decompress,
+    zstd_decompress_end
+};
+
+#endif /* HAVE_ZSTD */
+
+local const zip_codec* codecs[ZIP_MAX_CODECS] =
+{
+#ifdef HAVE_ZSTD
+    &zstd_codec,
+#endif
+    NULL
+};
+
+local int codec_count =
+#ifdef HAVE_ZSTD
+    1;
+#else
+    0;
+#endif
+
+local int zip_codec_index(int method)
+{
+    int i;
+    for (i = 0; i < codec_count; i++)
+    {
+        if (codecs[i]->method == method)
+            return i;
+    }
+    return -1;
+}
+
+extern int ZEXPORT zipRegisterCodec (const zip_codec* codec)
+{
+    int i;
+
+    if (codec == NULL || codec->method == 0 || codec->method == Z_DEFLATED)
+        return ZIP_PARAMERROR;
+
+    i = zip_codec_index(codec->method);
+    if (i < 0)
+    {
+        if (codec_count == ZIP_MAX_CODECS)
+            return ZIP_PARAMERROR;
+        i = codec_count++;
+    }
+
+    codecs[i] = codec;
+    return ZIP_OK;
+}
+
+extern int ZEXPORT zipUnregisterCodec (int method)
+{
+    int i = zip_codec_index(method);
+    if (i < 0)
+        return ZIP_PARAMERROR;
+
+    codec_count--;
+    memmove(&codecs[i], &codecs[i + 1],
+            (size_t)(codec_count - i) * sizeof(codecs[0]));
+    codecs[codec_count] = NULL;
+    return ZIP_OK;
+}
+
+extern const zip_codec* ZEXPORT zipFindCodec (int method)
+{
+    int i = zip_codec_index(method);
+    return i < 0 ? NULL : codecs[i];
+}
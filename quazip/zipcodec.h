@@ -0,0 +1,80 @@
+/* zipcodec.h -- compression methods other than stored and deflate
+
+   Part of QuaZIP, the same terms of use as for zip.h apply.
+
+   A codec implements a ZIP compression method for zip.c and unzip.c.
+   Deflate (8) and bzip2 (12, with HAVE_BZIP2) are built in. Zstandard (93)
+   is registered by default when built with HAVE_ZSTD. Other codecs can be
+   added with zipRegisterCodec().
+
+   The codec functions work on the next_in, avail_in, total_in, next_out,
+   avail_out and total_out fields of a z_stream, like deflate() and
+   inflate() do. Other fields of the z_stream are not used.
+*/
+
+#ifndef _zipcodec_H
+#define _zipcodec_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ZLIB_H
+#include "zlib.h"
+#endif
+
+#ifndef _ZLIBIOAPI_H
+#include "ioapi.h"
+#endif
+
+#define Z_ZSTD 93
+
+/* the maximum number of codecs registered with zipRegisterCodec() */
+#define ZIP_MAX_CODECS 16
+
+typedef struct zip_codec_s
+{
+    int method;                 /* compression method in the ZIP headers */
+    uLong version_needed;       /* version needed to extract, 63 for zstd */
+
+    /* Starts compression, stores the codec state in *state.
+       alloc gives the memory functions of the archive.
+       Returns Z_OK or a negative error code.
+       NULL if the codec can only decompress. */
+    int (*compress_init) OF((voidpf* state, int level,
+                             const zlib_allocfunc_def* alloc));
+    /* Compresses the input, flush is Z_NO_FLUSH or Z_FINISH.
+       Returns Z_OK, Z_STREAM_END when Z_FINISH is complete,
+       or a negative error code. */
+    int (*compress) OF((voidpf state, z_stream* stream, int flush));
+    void (*compress_end) OF((voidpf state));
+
+    /* Starts decompression, same as compress_init. */
+    int (*decompress_init) OF((voidpf* state,
+                               const zlib_allocfunc_def* alloc));
+    /* Decompresses the input. Returns Z_OK, Z_STREAM_END at the end of
+       the compressed data, Z_BUF_ERROR if no progress was possible,
+       or a negative error code. */
+    int (*decompress) OF((voidpf state, z_stream* stream));
+    void (*decompress_end) OF((voidpf state));
+} zip_codec;
+
+/* Adds a codec, replacing a codec registered before for the same method.
+   The codec structure is not copied and must stay valid.
+   Not thread safe: register codecs before opening archives.
+   Returns ZIP_OK, or ZIP_PARAMERROR if the method is 0 or Z_DEFLATED,
+   or too many codecs are registered. */
+extern int ZEXPORT zipRegisterCodec OF((const zip_codec* codec));
+
+/* Removes the codec of the method, including a built-in one.
+   Returns ZIP_OK, or ZIP_PARAMERROR if there is no such codec. */
+extern int ZEXPORT zipUnregisterCodec OF((int method));
+
+/* Returns the codec of the method, or NULL. */
+extern const zip_codec* ZEXPORT zipFindCodec OF((int method));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _zipcodec_H */
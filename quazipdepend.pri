@@ -20,6 +20,8 @@ win32 {
 }
 
 unix:LIBS += -lz
+quazip_zstd: LIBS += -lzstd
+quazip_libdeflate: LIBS += -ldeflate
 LIBS += -L$$QUAZIP_LIBPATH
 LIBS += -l$$QUAZIP_LIBNAME
 
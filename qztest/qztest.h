@@ -25,11 +25,16 @@ Original ZIP package is copyrighted by Gilles Vollant and contributors,
 see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
+#include <QByteArray>
 #include <QIODevice>
 #include <QString>
 #include <QStringList>
 #include <QTextCodec>
 
+#include "quazip/quazallocator.h"
+
+#include <cstdlib>
+
 extern bool createTestFiles(const QStringList &fileNames,
                             int size = -1,
                             const QString &dir = "tmp");
@@ -47,4 +52,66 @@ extern bool createTestArchive(QIODevice *ioDevice,
                               QTextCodec *codec,
                               const QString &dir = "tmp");
 
+/// Sequential device that gives only the bytes made available so far.
+class SequentialSource : public QIODevice {
+public:
+    explicit SequentialSource(const QByteArray &data, QObject *parent = nullptr)
+        : QIODevice(parent)
+        , data(data)
+        , offset(0)
+        , available(data.size())
+    {
+    }
+
+    /// Limits the bytes that can be read, emulating a slow socket.
+    void setAvailable(int count) { available = qMin(count, data.size()); }
+
+    virtual bool isSequential() const override { return true; }
+    virtual qint64 bytesAvailable() const override
+    {
+        return available - offset + QIODevice::bytesAvailable();
+    }
+
+protected:
+    virtual qint64 readData(char *out, qint64 maxSize) override
+    {
+        int count = int(qMin(maxSize, qint64(available - offset)));
+        memcpy(out, data.constData() + offset, size_t(count));
+        offset += count;
+        return count;
+    }
+    virtual qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    QByteArray data;
+    int offset;
+    int available;
+};
+
+/// Allocator that counts the allocations it has served.
+class CountingAllocator : public QuaZAllocator {
+public:
+    CountingAllocator()
+        : allocations(0)
+        , deallocations(0)
+    {
+    }
+
+    virtual void *allocate(size_t size) override
+    {
+        ++allocations;
+        return std::malloc(size);
+    }
+    virtual void deallocate(void *address) override
+    {
+        if (address) {
+            ++deallocations;
+            std::free(address);
+        }
+    }
+
+    int allocations;
+    int deallocations;
+};
+
 #endif // QUAZIP_TEST_QZTEST_H
@@ -108,6 +108,40 @@ void TestJlCompress::compressFiles()
     curDir.remove(zipName);
 }
 
+void TestJlCompress::compressFilesLarge()
+{
+    // bigger than a read and, together, than the data read ahead
+    QString zipName = "jllargefiles.zip";
+    QStringList fileNames;
+    fileNames << "large1.txt" << "large2.txt" << "large3.txt";
+    QStringList realNames;
+    realNames << "tmp/large1.txt" << "tmp/large2.txt" << "tmp/large3.txt";
+    if (!createTestFiles(fileNames, 3 * 1024 * 1024 + 7)) {
+        QFAIL("Can't create test files");
+    }
+    QVERIFY(JlCompress::compressFiles(zipName, realNames));
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QCOMPARE(zip.getFileNameList(),
+             QStringList() << "large1.txt" << "large2.txt" << "large3.txt");
+    foreach (QString realName, realNames) {
+        QVERIFY(zip.setCurrentFile(QFileInfo(realName).fileName()));
+        QuaZipFile zipFile(&zip);
+        QVERIFY(zipFile.open(QIODevice::ReadOnly));
+        QFile file(realName);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(zipFile.readAll(), file.readAll());
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    }
+    zip.close();
+    // a missing file fails the whole archive
+    QVERIFY(!JlCompress::compressFiles(zipName,
+                QStringList() << realNames << "tmp/missing.txt"));
+    QVERIFY(!QFileInfo::exists(zipName));
+    removeTestFiles(fileNames);
+}
+
 void TestJlCompress::compressDir_data()
 {
     QTest::addColumn<QString>("zipName");
@@ -161,6 +195,124 @@ void TestJlCompress::compressDir()
     curDir.remove(zipName);
 }
 
+void TestJlCompress::compressDirScanner()
+{
+    // the default filters are listed by the scanner, Readable needs QDir
+    QStringList fileNames;
+    fileNames << "B.txt" << "a.txt" << ".hidden" << "Sub/z.txt" << "sub2/"
+              << "Sub/deep/A.txt" << "Sub/deep/b.txt" << "Sub/.hiddendir/x.txt";
+    if (!createTestFiles(fileNames, -1, "compressDirScanner_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    QFile::setPermissions("compressDirScanner_tmp/a.txt",
+                          QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner
+                          | QFile::ReadGroup);
+    QVERIFY(JlCompress::compressDir("jlscanner.zip", "compressDirScanner_tmp",
+                                    true));
+    QVERIFY(JlCompress::compressDir("jlscanner_qdir.zip", "compressDirScanner_tmp",
+                                    true, QDir::Readable));
+    QuaZip scanned("jlscanner.zip");
+    QuaZip walked("jlscanner_qdir.zip");
+    QVERIFY(scanned.open(QuaZip::mdUnzip));
+    QVERIFY(walked.open(QuaZip::mdUnzip));
+    QList<QuaZipFileInfo64> scannedInfo = scanned.getFileInfoList64();
+    QList<QuaZipFileInfo64> walkedInfo = walked.getFileInfoList64();
+    QCOMPARE(scannedInfo.size(), walkedInfo.size());
+    QStringList names;
+    for (int i = 0; i < scannedInfo.size(); ++i) {
+        names << scannedInfo.at(i).name;
+        QCOMPARE(scannedInfo.at(i).name, walkedInfo.at(i).name);
+        QCOMPARE(scannedInfo.at(i).dateTime, walkedInfo.at(i).dateTime);
+        QCOMPARE(scannedInfo.at(i).externalAttr, walkedInfo.at(i).externalAttr);
+    }
+    QVERIFY(!names.contains(".hidden"));
+    QVERIFY(!names.contains("Sub/.hiddendir/"));
+    QVERIFY(names.contains("sub2/"));
+    scanned.close();
+    walked.close();
+#ifdef Q_OS_LINUX
+    // a link back to the root is not followed again
+    QString loop = "compressDirScanner_tmp/Sub/loop";
+    QVERIFY(QFile::link(QDir("compressDirScanner_tmp").absolutePath(), loop));
+    QVERIFY(JlCompress::compressDir("jlscanner.zip", "compressDirScanner_tmp",
+                                    true));
+    QVERIFY(scanned.open(QuaZip::mdUnzip));
+    QCOMPARE(scanned.getFileNameList(), names);
+    scanned.close();
+    QFile::remove(loop);
+#endif
+    removeTestFiles(fileNames, "compressDirScanner_tmp");
+    QDir().remove("jlscanner.zip");
+    QDir().remove("jlscanner_qdir.zip");
+}
+
+void TestJlCompress::compressDirPolicy()
+{
+    QString zipName = "jlpolicy.zip";
+    QStringList fileNames;
+    fileNames << "app.log" << "bin/tool.exe" << "media/clip.mp4"
+              << "readme.txt";
+    if (!createTestFiles(fileNames, -1, "compressDirPolicy_tmp")) {
+        QFAIL("Can't create test files");
+    }
+
+    QuaZipCompressionPolicy policy;
+    policy.addRule("*.LOG", {Z_DEFLATED, Z_BEST_COMPRESSION});
+    policy.addRule("bin/*", {Z_DEFLATED, Z_BEST_SPEED});
+    policy.addMimeRule("video/*", {0});
+    policy.addSizeRule(1024 * 1024, -1, {0});
+    QCOMPARE(policy.rules().size(), 4);
+
+    // the size and MIME rules do not match a small text file
+    QFileInfo readme("compressDirPolicy_tmp/readme.txt");
+    QCOMPARE(policy.settingsFor(readme, "readme.txt").method, Z_DEFLATED);
+    QuaZipCompressionPolicy::Rule textRule;
+    textRule.mimeType = "text/plain";
+    textRule.maxSize = readme.size();
+    QVERIFY(QuaZipCompressionPolicy::matches(textRule, readme, "readme.txt"));
+    textRule.maxSize = readme.size() - 1;
+    QVERIFY(!QuaZipCompressionPolicy::matches(textRule, readme, "readme.txt"));
+    // files read before are matched without the file system
+    QCOMPARE(policy.settingsFor("missing/clip.mp4", "clip.mp4", 10,
+                                QByteArray()).method, 0);
+    QCOMPARE(policy.settingsFor("missing/big.txt", "big.txt", 2 * 1024 * 1024,
+                                QByteArray("text")).method, 0);
+    QCOMPARE(policy.settingsFor("missing/small.txt", "small.txt", 10,
+                                QByteArray("text")).method, Z_DEFLATED);
+
+    QVERIFY(JlCompress::compressDir(zipName, "compressDirPolicy_tmp", true,
+        QDir::Filters(), policy));
+
+    QMap<QString, int> expectedMethods;
+    expectedMethods["app.log"] = Z_DEFLATED;
+    expectedMethods["bin/tool.exe"] = Z_DEFLATED;
+    expectedMethods["media/clip.mp4"] = 0;
+    expectedMethods["readme.txt"] = Z_DEFLATED;
+    QMap<QString, int> expectedLevels;
+    expectedLevels["app.log"] = Z_BEST_COMPRESSION;
+    expectedLevels["bin/tool.exe"] = Z_BEST_SPEED;
+    expectedLevels["readme.txt"] = 6;
+
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    for (auto it = expectedMethods.cbegin(); it != expectedMethods.cend();
+         ++it) {
+        QVERIFY(zip.setCurrentFile(it.key()));
+        QuaZipFile file(&zip);
+        int method = -1;
+        int level = -1;
+        QVERIFY(file.open(QIODevice::ReadOnly, &method, &level, false));
+        QCOMPARE(method, it.value());
+        if (method == Z_DEFLATED)
+            QCOMPARE(level, expectedLevels.value(it.key()));
+        file.close();
+    }
+    zip.close();
+
+    removeTestFiles(fileNames, "compressDirPolicy_tmp");
+    QDir().remove(zipName);
+}
+
 void TestJlCompress::extractFile_data()
 {
     QTest::addColumn<QString>("zipName");
@@ -217,6 +369,18 @@ void TestJlCompress::extractFile()
             fileToExtract);
     QCOMPARE(destInfo.size(), srcInfo.size());
     QCOMPARE(destInfo.permissions(), srcInfo.permissions());
+#if defined(Q_OS_LINUX) || QT_VERSION >= 0x050A00
+    if (!fileToExtract.endsWith("/")) {
+        // the time of the entry is set, like extractDir() does
+        QuaZip zip(zipName);
+        QuaZipFileInfo64 entryInfo;
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QVERIFY(zip.setCurrentFile(fileToExtract));
+        QVERIFY(zip.getCurrentFileInfo(&entryInfo));
+        zip.close();
+        QCOMPARE(destInfo.lastModified(), entryInfo.dateTime);
+    }
+#endif
     curDir.remove("jlext/jlfile/" + destName);
     // now test the QIODevice* overload
     QFile zipFile(zipName);
@@ -252,6 +416,10 @@ void TestJlCompress::extractFiles_data()
             QStringList() << "test0.txt" << "testdir1/test1.txt"
             << "testdir2/test2.txt" << "testdir2/subdir/test2sub.txt")
         << (QStringList() << "testdir2/test2.txt" << "testdir1/test1.txt");
+    QTest::newRow("scattered") << "jlextscattered.zip" << (
+            QStringList() << "a.txt" << "b.txt" << "c.txt" << "d.txt"
+            << "e.txt")
+        << (QStringList() << "e.txt" << "b.txt" << "d.txt" << "a.txt");
 }
 
 void TestJlCompress::extractFiles()
@@ -269,8 +437,13 @@ void TestJlCompress::extractFiles()
     if (!JlCompress::compressDir(zipName, "tmp")) {
         QFAIL("Couldn't create test archive");
     }
-    QVERIFY(!JlCompress::extractFiles(zipName, filesToExtract,
-                "jlext/jlfiles").isEmpty());
+    QStringList extracted = JlCompress::extractFiles(zipName, filesToExtract,
+                "jlext/jlfiles");
+    QCOMPARE(extracted.size(), filesToExtract.size());
+    for (int i = 0; i < filesToExtract.size(); ++i) {
+        QCOMPARE(extracted.at(i),
+                QDir("jlext/jlfiles").absoluteFilePath(filesToExtract.at(i)));
+    }
     foreach (QString fileName, filesToExtract) {
         QFileInfo fileInfo("jlext/jlfiles/" + fileName);
         QFileInfo extInfo("tmp/" + fileName);
@@ -298,6 +471,38 @@ void TestJlCompress::extractFiles()
     curDir.remove(zipName);
 }
 
+void TestJlCompress::extractFilesFiltered()
+{
+    QString zipName = "jlfiltered.zip";
+    QStringList fileNames;
+    fileNames << "data/a.json" << "data/sub/b.json" << "data/c.txt"
+              << "other/d.json";
+    QDir curDir;
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!JlCompress::compressDir(zipName, "tmp")) {
+        QFAIL("Couldn't create test archive");
+    }
+    QuaZipNameFilter filter = QuaZipNameFilter::prefix("data/")
+        & QuaZipNameFilter::wildcard("*.json");
+    QStringList extracted = JlCompress::extractFiles(zipName, filter,
+            "jlext/jlfiltered");
+    extracted.sort();
+    QStringList expected;
+    expected << QDir("jlext/jlfiltered").absoluteFilePath("data/a.json")
+             << QDir("jlext/jlfiltered").absoluteFilePath("data/sub/b.json");
+    QCOMPARE(extracted, expected);
+    foreach (QString fileName, extracted) {
+        QVERIFY(QFileInfo(fileName).exists());
+    }
+    QVERIFY(!QFileInfo("jlext/jlfiltered/data/c.txt").exists());
+    QVERIFY(!QFileInfo("jlext/jlfiltered/other/d.json").exists());
+    QVERIFY(QDir("jlext/jlfiltered").removeRecursively());
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
 void TestJlCompress::extractDir_data()
 {
     QTest::addColumn<QString>("zipName");
@@ -34,12 +34,16 @@ private slots:
     void compressFile();
     void compressFiles_data();
     void compressFiles();
+    void compressFilesLarge();
     void compressDir_data();
     void compressDir();
+    void compressDirPolicy();
+    void compressDirScanner();
     void extractFile_data();
     void extractFile();
     void extractFiles_data();
     void extractFiles();
+    void extractFilesFiltered();
     void extractDir_data();
     void extractDir();
     void zeroPermissions();
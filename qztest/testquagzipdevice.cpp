@@ -23,9 +23,11 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "testquagzipdevice.h"
+#include "qztest.h"
 
 #include "quazip/quagzipdevice.h"
 
+#include <QBuffer>
 #include <QTemporaryDir>
 #include <QDateTime>
 #include <QtTest/QtTest>
@@ -365,3 +367,85 @@ TestQuaGzipDevice::Gzip::~Gzip()
         gzclose(file);
     }
 }
+
+void TestQuaGzipDevice::readSequentialBounded()
+{
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i)
+        data.append(char('a' + i % 26));
+
+    QByteArray compressed;
+    QBuffer compressedBuffer(&compressed);
+    QuaGzipDevice writeDevice(&compressedBuffer);
+    writeDevice.setOriginalFileName(QStringLiteral("data.txt"));
+    QVERIFY(writeDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(writeDevice.write(data), qint64(data.size()));
+    writeDevice.close();
+    QVERIFY(!writeDevice.hasError());
+    int compressedSize = compressed.size();
+    compressed.append("TAIL");
+
+    SequentialSource source(compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+    source.setAvailable(compressedSize / 2);
+
+    QuaGzipDevice gzDevice(&source);
+    gzDevice.setTransactionalReadEnabled(false);
+    QVERIFY(gzDevice.open(QIODevice::ReadOnly));
+
+    QByteArray uncompressed(data.size(), 0);
+    qint64 firstPart = gzDevice.read(uncompressed.data(), data.size());
+    QVERIFY(firstPart >= 0);
+    QVERIFY(firstPart < data.size());
+    QVERIFY(!gzDevice.hasError());
+    QVERIFY(!gzDevice.atEnd());
+
+    source.setAvailable(compressed.size());
+    qint64 secondPart =
+        gzDevice.read(uncompressed.data() + firstPart, data.size() - firstPart);
+    QCOMPARE(firstPart + secondPart, qint64(data.size()));
+    QCOMPARE(uncompressed, data);
+    QVERIFY(gzDevice.headerIsProcessed());
+    QCOMPARE(gzDevice.originalFileName(), QStringLiteral("data.txt"));
+    QVERIFY(gzDevice.atEnd());
+    QCOMPARE(gzDevice.trailingInput(), QByteArrayLiteral("TAIL"));
+    QVERIFY(!source.isTransactionStarted());
+    gzDevice.close();
+    QVERIFY(!gzDevice.hasError());
+}
+
+void TestQuaGzipDevice::lowMemory()
+{
+    QByteArray data;
+    for (int i = 0; i < 10000; ++i) {
+        data += QByteArray::number(i * 7 % 1000) + ",";
+    }
+
+    QBuffer buffer;
+    QuaGzipDevice writeDevice(&buffer);
+    QBuffer defaultBuffer;
+    QuaGzipDevice defaultDevice(&defaultBuffer);
+    writeDevice.setLowMemoryProfile();
+    QCOMPARE(writeDevice.windowBits(),
+        int(QuaZIODevice::LOW_MEMORY_WINDOW_BITS));
+    QCOMPARE(
+        writeDevice.memLevel(), int(QuaZIODevice::LOW_MEMORY_MEM_LEVEL));
+    QVERIFY(writeDevice.open(QIODevice::WriteOnly));
+    QVERIFY(defaultDevice.open(QIODevice::WriteOnly));
+    QVERIFY(writeDevice.memoryUsage() < defaultDevice.memoryUsage());
+    defaultDevice.close();
+    QCOMPARE(writeDevice.write(data), qint64(data.size()));
+    writeDevice.close();
+    QVERIFY(!writeDevice.hasError());
+
+    QByteArray compressed = buffer.buffer();
+    QCOMPARE(quint8(compressed.at(0)), quint8(0x1f));
+    QCOMPARE(quint8(compressed.at(1)), quint8(0x8b));
+
+    QBuffer readBuffer(&compressed);
+    QuaGzipDevice readDevice(&readBuffer);
+    readDevice.setLowMemoryProfile();
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+    QVERIFY(!readDevice.hasError());
+}
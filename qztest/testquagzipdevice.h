@@ -36,4 +36,6 @@ private slots:
     void read();
     void write_data();
     void write();
+    void readSequentialBounded();
+    void lowMemory();
 };
@@ -24,10 +24,14 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "testquaziodevice.h"
+#include "qztest.h"
 #include "quazip/quaziodevice.h"
+#include "quazip/quazdictionary.h"
+#include "quazip/quazcompression.h"
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QSignalSpy>
 #include <QtTest/QtTest>
 
 #include <zlib.h>
@@ -199,3 +203,520 @@ void TestQuaZIODevice::write()
     QCOMPARE(zins.avail_out, uInt(0));
     QCOMPARE(outBuf, data);
 }
+
+void TestQuaZIODevice::readSequentialBounded()
+{
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i)
+        data.append(char('a' + i % 26));
+
+    QByteArray compressed;
+    QBuffer compressedBuffer(&compressed);
+    QuaZIODevice writeDevice(&compressedBuffer);
+    QVERIFY(writeDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(writeDevice.write(data), qint64(data.size()));
+    writeDevice.close();
+    QVERIFY(!writeDevice.hasError());
+    int compressedSize = compressed.size();
+    compressed.append("TAIL");
+
+    SequentialSource source(compressed);
+    QVERIFY(source.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+    source.setAvailable(compressedSize / 2);
+
+    QuaZIODevice testDevice(&source);
+    QVERIFY(testDevice.isTransactionalReadEnabled());
+    testDevice.setTransactionalReadEnabled(false);
+    QVERIFY(testDevice.open(QIODevice::ReadOnly));
+    QVERIFY(testDevice.isSequential());
+
+    QByteArray uncompressed(data.size(), 0);
+    qint64 firstPart = testDevice.read(uncompressed.data(), data.size());
+    QVERIFY(firstPart >= 0);
+    QVERIFY(firstPart < data.size());
+    QVERIFY(!testDevice.hasError());
+    QVERIFY(!testDevice.atEnd());
+    QVERIFY(testDevice.trailingInput().isEmpty());
+
+    source.setAvailable(compressed.size());
+    qint64 secondPart = testDevice.read(
+        uncompressed.data() + firstPart, data.size() - firstPart);
+    QCOMPARE(firstPart + secondPart, qint64(data.size()));
+    QCOMPARE(uncompressed, data);
+    QCOMPARE(testDevice.read(1), QByteArray());
+    QVERIFY(!testDevice.hasError());
+    QVERIFY(testDevice.atEnd());
+    QCOMPARE(testDevice.size(), qint64(data.size()));
+    QCOMPARE(testDevice.trailingInput(), QByteArrayLiteral("TAIL"));
+    QVERIFY(!source.isTransactionStarted());
+    testDevice.close();
+    QVERIFY(!testDevice.hasError());
+}
+
+void TestQuaZIODevice::writeBuffered()
+{
+    QByteArray data;
+    QBuffer buffer;
+    QuaZIODevice testDevice(&buffer);
+    QCOMPARE(testDevice.writeBufferThreshold(), 0);
+    testDevice.setWriteBufferThreshold(1024);
+    QVERIFY(testDevice.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 1000; ++i) {
+        QByteArray message = QByteArray::number(i) + ": message\n";
+        QCOMPARE(testDevice.write(message), qint64(message.size()));
+        data += message;
+    }
+    QCOMPARE(testDevice.size(), qint64(data.size()));
+    QByteArrayList fragments;
+    fragments << "small " << QByteArray(5000, 'x') << " tail\n";
+    QCOMPARE(testDevice.writeFragments(fragments), qint64(5012));
+    data += fragments.join();
+    testDevice.setCompressionLevel(Z_BEST_COMPRESSION);
+    QCOMPARE(testDevice.write("after level change"), qint64(18));
+    data += "after level change";
+    QCOMPARE(testDevice.size(), qint64(data.size()));
+    testDevice.close();
+    QVERIFY(!testDevice.hasError());
+
+    QByteArray uncompressed(data.size(), 0);
+    z_stream zins;
+    memset(&zins, 0, sizeof(zins));
+    QCOMPARE(inflateInit(&zins), Z_OK);
+    zins.next_in = reinterpret_cast<Bytef *>(buffer.buffer().data());
+    zins.avail_in = uInt(buffer.size());
+    zins.next_out = reinterpret_cast<Bytef *>(uncompressed.data());
+    zins.avail_out = uInt(uncompressed.size());
+    QCOMPARE(inflate(&zins, Z_FINISH), Z_STREAM_END);
+    inflateEnd(&zins);
+    QCOMPARE(uncompressed, data);
+}
+
+static QByteArray inflateAvailable(const QByteArray &compressed)
+{
+    QByteArray result(65536, 0);
+    z_stream zins;
+    memset(&zins, 0, sizeof(zins));
+    inflateInit(&zins);
+    zins.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(compressed.data()));
+    zins.avail_in = uInt(compressed.size());
+    zins.next_out = reinterpret_cast<Bytef *>(result.data());
+    zins.avail_out = uInt(result.size());
+    inflate(&zins, Z_SYNC_FLUSH);
+    result.resize(int(zins.total_out));
+    inflateEnd(&zins);
+    return result;
+}
+
+void TestQuaZIODevice::flush_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("partial") << int(QuaZIODevice::PartialFlush);
+    QTest::newRow("sync") << int(QuaZIODevice::SyncFlush);
+    QTest::newRow("full") << int(QuaZIODevice::FullFlush);
+}
+
+void TestQuaZIODevice::flush()
+{
+    QFETCH(int, mode);
+    QBuffer buffer;
+    QuaZIODevice testDevice(&buffer);
+    testDevice.setWriteBufferThreshold(1024);
+    QVERIFY(testDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(testDevice.write("first message"), qint64(13));
+    QCOMPARE(buffer.size(), qint64(0));
+    QVERIFY(testDevice.flush(QuaZIODevice::FlushMode(mode)));
+    QVERIFY(buffer.size() > 0);
+    if (mode != QuaZIODevice::PartialFlush) {
+        QCOMPARE(inflateAvailable(buffer.buffer()),
+            QByteArrayLiteral("first message"));
+    }
+    QCOMPARE(testDevice.write(", second message"), qint64(16));
+    QVERIFY(testDevice.flush(QuaZIODevice::FlushMode(mode)));
+    QCOMPARE(inflateAvailable(buffer.buffer()),
+        QByteArrayLiteral("first message, second message"));
+    testDevice.close();
+    QVERIFY(!testDevice.hasError());
+}
+
+void TestQuaZIODevice::autoFlush()
+{
+    QBuffer buffer;
+    QuaZIODevice testDevice(&buffer);
+    QCOMPARE(testDevice.autoFlushMode(), QuaZIODevice::NoFlush);
+    testDevice.setAutoFlush(QuaZIODevice::SyncFlush, 50, 100);
+    QCOMPARE(testDevice.autoFlushInterval(), 50);
+    QCOMPARE(testDevice.autoFlushBytes(), qint64(100));
+    QVERIFY(testDevice.open(QIODevice::WriteOnly));
+
+    // flushed by the timer
+    QCOMPARE(testDevice.write("timer"), qint64(5));
+    QCOMPARE(buffer.size(), qint64(0));
+    QTRY_VERIFY(buffer.size() > 0);
+    QCOMPARE(inflateAvailable(buffer.buffer()), QByteArrayLiteral("timer"));
+
+    // flushed by the byte threshold
+    testDevice.setAutoFlush(QuaZIODevice::SyncFlush, 0, 100);
+    QByteArray data("timer");
+    for (int i = 0; i < 9; ++i) {
+        QByteArray message = QByteArray::number(i) + ": message\n";
+        QCOMPARE(testDevice.write(message), qint64(message.size()));
+        data += message;
+    }
+    QCOMPARE(inflateAvailable(buffer.buffer()), data);
+    testDevice.close();
+    QVERIFY(!testDevice.hasError());
+}
+
+static QByteArray jsonMessage(int i)
+{
+    return QByteArray("{\"id\":") + QByteArray::number(i) +
+        ",\"method\":\"telemetry.report\",\"params\":{\"temperature\":" +
+        QByteArray::number(20 + i % 7) + ",\"status\":\"ok\"}}";
+}
+
+static QByteArray compressWithDictionary(
+    const QByteArray &data, const QByteArray &dictionary)
+{
+    QBuffer buffer;
+    QuaZIODevice device(&buffer);
+    device.setDictionary(dictionary);
+    if (!device.open(QIODevice::WriteOnly))
+        return QByteArray();
+    device.write(data);
+    device.close();
+    return buffer.buffer();
+}
+
+void TestQuaZIODevice::dictionary()
+{
+    QByteArray dictionary("\"method\":\"telemetry.report\",\"params\":");
+    QByteArray data = jsonMessage(1);
+    QByteArray compressed = compressWithDictionary(data, dictionary);
+    QVERIFY(!compressed.isEmpty());
+    QVERIFY(compressed.size() < compressWithDictionary(data, {}).size());
+
+    {
+        QBuffer buffer(&compressed);
+        QuaZIODevice testDevice(&buffer);
+        testDevice.setDictionary(dictionary);
+        QCOMPARE(testDevice.dictionary(), dictionary);
+        QVERIFY(testDevice.open(QIODevice::ReadOnly));
+        QCOMPARE(testDevice.readAll(), data);
+        QVERIFY(!testDevice.hasError());
+    }
+    {
+        QBuffer buffer(&compressed);
+        QuaZIODevice testDevice(&buffer);
+        quint32 requestedId = 0;
+        testDevice.setDictionaryResolver([&](quint32 id) {
+            requestedId = id;
+            return dictionary;
+        });
+        QVERIFY(testDevice.open(QIODevice::ReadOnly));
+        QCOMPARE(testDevice.readAll(), data);
+        QCOMPARE(requestedId, QuaZDictionary::id(dictionary));
+        QVERIFY(!testDevice.hasError());
+    }
+    {
+        QBuffer buffer(&compressed);
+        QuaZIODevice testDevice(&buffer);
+        QVERIFY(testDevice.open(QIODevice::ReadOnly));
+        QByteArray buf(data.size(), 0);
+        QCOMPARE(testDevice.read(buf.data(), buf.size()), qint64(-1));
+        QVERIFY(testDevice.hasError());
+    }
+}
+
+void TestQuaZIODevice::trainDictionary()
+{
+    QByteArrayList samples;
+    for (int i = 0; i < 100; ++i) {
+        samples << jsonMessage(i);
+    }
+    QByteArray dictionary = QuaZDictionary::train(samples, 256);
+    QVERIFY(!dictionary.isEmpty());
+    QVERIFY(dictionary.size() <= 256);
+    QVERIFY(dictionary.contains("telemetry.report"));
+    QCOMPARE(QuaZDictionary::train(samples, 256), dictionary);
+
+    QByteArray data = jsonMessage(1000);
+    QVERIFY(compressWithDictionary(data, dictionary).size() <
+        compressWithDictionary(data, {}).size());
+
+    QVERIFY(QuaZDictionary::train({"abcdefghij", "klmnopqrst"}).isEmpty());
+}
+
+void TestQuaZIODevice::windowBits_data()
+{
+    QTest::addColumn<int>("windowBits");
+    QTest::addColumn<int>("memLevel");
+    QTest::newRow("zlib") << 15 << 9;
+    QTest::newRow("small") << 9 << 1;
+    QTest::newRow("raw") << -15 << 8;
+    QTest::newRow("raw low memory") << -int(QuaZIODevice::LOW_MEMORY_WINDOW_BITS)
+                                    << int(QuaZIODevice::LOW_MEMORY_MEM_LEVEL);
+    QTest::newRow("raw smallest") << -9 << 1;
+}
+
+void TestQuaZIODevice::windowBits()
+{
+    QFETCH(int, windowBits);
+    QFETCH(int, memLevel);
+    QByteArray data;
+    for (int i = 0; i < 10000; ++i) {
+        data += QByteArray::number(i * 7 % 1000) + ",";
+    }
+
+    QBuffer buffer;
+    QuaZIODevice writeDevice(&buffer);
+    writeDevice.setWindowBits(windowBits);
+    writeDevice.setMemLevel(memLevel);
+    QCOMPARE(writeDevice.windowBits(), windowBits);
+    QCOMPARE(writeDevice.memLevel(), memLevel);
+    QVERIFY(writeDevice.open(QIODevice::WriteOnly));
+    QVERIFY(writeDevice.memoryUsage() >=
+        QuaZIODevice::deflateMemoryUsage(windowBits, memLevel));
+    QCOMPARE(writeDevice.write(data), qint64(data.size()));
+    writeDevice.close();
+    QVERIFY(!writeDevice.hasError());
+
+    // 8 is rejected by zlib for raw deflate, so it is raised
+    QuaZIODevice clampedDevice(&buffer);
+    clampedDevice.setWindowBits(windowBits < 0 ? -8 : 8);
+    QCOMPARE(clampedDevice.windowBits(), windowBits < 0 ? -9 : 9);
+
+    // the raw stream has no zlib header
+    QByteArray compressed = buffer.buffer();
+    int header = quint8(compressed.at(0)) * 256 + quint8(compressed.at(1));
+    bool hasZlibHeader = (header >> 8 & 0x0F) == Z_DEFLATED && header % 31 == 0;
+    QCOMPARE(hasZlibHeader, windowBits > 0);
+
+    QBuffer readBuffer(&compressed);
+    QuaZIODevice readDevice(&readBuffer);
+    readDevice.setWindowBits(windowBits);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+    QVERIFY(!readDevice.hasError());
+    QVERIFY(readDevice.memoryUsage() >=
+        QuaZIODevice::inflateMemoryUsage(windowBits));
+}
+
+void TestQuaZIODevice::allocator()
+{
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i) {
+        data += QByteArray::number(i) + ",";
+    }
+
+    CountingAllocator allocator;
+    QBuffer buffer;
+    QuaZIODevice writeDevice(&buffer);
+    QVERIFY(writeDevice.allocator() == nullptr);
+    writeDevice.setAllocator(&allocator);
+    QVERIFY(writeDevice.allocator() == &allocator);
+    QVERIFY(writeDevice.open(QIODevice::WriteOnly));
+    QVERIFY(allocator.allocations > 0);
+    QCOMPARE(writeDevice.write(data), qint64(data.size()));
+    writeDevice.close();
+    QVERIFY(!writeDevice.hasError());
+    QCOMPARE(allocator.deallocations, allocator.allocations);
+
+    int writeAllocations = allocator.allocations;
+    QByteArray compressed = buffer.buffer();
+    QBuffer readBuffer(&compressed);
+    QuaZIODevice readDevice(&readBuffer);
+    readDevice.setAllocator(&allocator);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+    readDevice.close();
+    QVERIFY(allocator.allocations > writeAllocations);
+    QCOMPARE(allocator.deallocations, allocator.allocations);
+
+    // the global allocator is used when none is set
+    CountingAllocator globalAllocator;
+    QuaZAllocator::setGlobalAllocator(&globalAllocator);
+    QBuffer globalBuffer;
+    QuaZIODevice globalDevice(&globalBuffer);
+    QVERIFY(globalDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(globalDevice.write(data), qint64(data.size()));
+    globalDevice.close();
+    QuaZAllocator::setGlobalAllocator(nullptr);
+    QVERIFY(globalAllocator.allocations > 0);
+    QCOMPARE(globalAllocator.deallocations, globalAllocator.allocations);
+}
+
+namespace {
+/// Buffer that reports a large amount of data waiting to be written.
+class SlowBuffer : public QBuffer {
+public:
+    virtual qint64 bytesToWrite() const override
+    {
+        return QuaZIODevice::ADAPTIVE_BACKPRESSURE_LIMIT + 1;
+    }
+};
+} // namespace
+
+void TestQuaZIODevice::adaptiveCompression()
+{
+    QBuffer buffer;
+    QuaZIODevice device(&buffer);
+    QVERIFY(!device.isAdaptiveCompression());
+    device.setAdaptiveCompression(8, 2, 0);
+    QVERIFY(device.isAdaptiveCompression());
+    QCOMPARE(device.adaptiveMinLevel(), 2);
+    QCOMPARE(device.adaptiveMaxLevel(), 8);
+    QCOMPARE(device.adaptiveInterval(), 0);
+    QCOMPARE(device.adaptiveMaxLoad(), qreal(0.5));
+    // the default level is moved into the bounds
+    QCOMPARE(device.compressionLevel(), 6);
+    device.setAdaptiveCompression(1, 3, 0);
+    QCOMPARE(device.compressionLevel(), 3);
+
+    QByteArray data;
+    QVERIFY(device.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 200; ++i) {
+        QByteArray line = QByteArray::number(i * 31 % 1000) + " message\n";
+        data += line;
+        QCOMPARE(device.write(line), qint64(line.size()));
+        QVERIFY(device.compressionLevel() >= 1);
+        QVERIFY(device.compressionLevel() <= 3);
+    }
+    auto stats = device.adaptiveCompressionStats();
+    QVERIFY(stats.samples > 0);
+    QVERIFY(stats.load >= 0 && stats.load <= 1);
+    device.close();
+    QVERIFY(!device.hasError());
+
+    device.disableAdaptiveCompression();
+    QVERIFY(!device.isAdaptiveCompression());
+
+    QBuffer readBuffer(&buffer.buffer());
+    QuaZIODevice readDevice(&readBuffer);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+}
+
+void TestQuaZIODevice::adaptiveBackpressure()
+{
+    SlowBuffer buffer;
+    QuaZIODevice device(&buffer);
+    // compression never takes more than all of the time
+    device.setAdaptiveCompression(1, 9, 0, 1.0);
+    device.setCompressionLevel(1);
+    QSignalSpy spy(&device, &QuaZIODevice::compressionLevelAdapted);
+
+    QByteArray data;
+    QVERIFY(device.open(QIODevice::WriteOnly));
+    for (int i = 0; i < 20; ++i) {
+        QByteArray line = QByteArray::number(i) + " message\n";
+        data += line;
+        QCOMPARE(device.write(line), qint64(line.size()));
+    }
+    QCOMPARE(device.compressionLevel(), 9);
+    QCOMPARE(spy.count(), 8);
+    QCOMPARE(spy.last().at(0).toInt(), 9);
+    QCOMPARE(spy.last().at(1).value<QuaZIODevice::AdaptiveDecision>(),
+        QuaZIODevice::RaiseLevelForBackpressure);
+    auto stats = device.adaptiveCompressionStats();
+    QCOMPARE(stats.raised, 8);
+    QCOMPARE(stats.lowered, 0);
+    QCOMPARE(stats.decision, QuaZIODevice::KeepLevel);
+    QCOMPARE(stats.bytesToWrite,
+        qint64(QuaZIODevice::ADAPTIVE_BACKPRESSURE_LIMIT + 1));
+    device.close();
+    QVERIFY(!device.hasError());
+
+    QBuffer readBuffer(&buffer.buffer());
+    QuaZIODevice readDevice(&readBuffer);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+}
+
+void TestQuaZIODevice::memoryCompression_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("level");
+    QTest::addColumn<int>("size");
+    QTest::newRow("deflate") << int(QuaZCompression::Deflate) << 6 << 100000;
+    QTest::newRow("zlib") << int(QuaZCompression::Zlib)
+                          << int(Z_DEFAULT_COMPRESSION) << 100000;
+    QTest::newRow("gzip") << int(QuaZCompression::Gzip) << 9 << 100000;
+    QTest::newRow("stored") << int(QuaZCompression::Zlib) << 0 << 100000;
+    QTest::newRow("small") << int(QuaZCompression::Gzip) << 1 << 10;
+    QTest::newRow("empty") << int(QuaZCompression::Zlib) << 1 << 0;
+}
+
+void TestQuaZIODevice::memoryCompression()
+{
+    QFETCH(int, format);
+    QFETCH(int, level);
+    QFETCH(int, size);
+    auto zformat = QuaZCompression::Format(format);
+    QByteArray data;
+    for (int i = 0; data.size() < size; ++i) {
+        data += QByteArray::number(i * 7 % 1000) + ",";
+    }
+    data.truncate(size);
+
+    bool ok = false;
+    QByteArray compressed = QuaZCompression::compress(data, zformat, level, &ok);
+    QVERIFY(ok);
+    QVERIFY(!compressed.isEmpty());
+    QVERIFY(compressed.size() <= QuaZCompression::compressBound(size, zformat, level));
+    // the pooled stream gives the same result the second time
+    QCOMPARE(QuaZCompression::compress(data, zformat, level), compressed);
+    // and after it was used with another level
+    QVERIFY(!QuaZCompression::compress(data, zformat,
+        level == Z_BEST_COMPRESSION ? Z_BEST_SPEED : Z_BEST_COMPRESSION).isEmpty());
+    QCOMPARE(QuaZCompression::compress(data, zformat, level), compressed);
+
+    if (zformat == QuaZCompression::Gzip) {
+        QVERIFY(compressed.startsWith("\x1F\x8B"));
+    } else {
+        QBuffer buffer(&compressed);
+        QuaZIODevice device(&buffer);
+        device.setWindowBits(zformat == QuaZCompression::Zlib ? MAX_WBITS : -MAX_WBITS);
+        QVERIFY(device.open(QIODevice::ReadOnly));
+        QCOMPARE(device.readAll(), data);
+    }
+
+    // without a hint, with a right one and with a too small one
+    ok = false;
+    QCOMPARE(QuaZCompression::uncompress(compressed, zformat, -1, &ok), data);
+    QVERIFY(ok);
+    QCOMPARE(QuaZCompression::uncompress(compressed, zformat, size), data);
+    QCOMPARE(QuaZCompression::uncompress(compressed, zformat, 1), data);
+
+    QByteArray out(size + 10, Qt::Uninitialized);
+    QCOMPARE(QuaZCompression::uncompress(compressed.constData(),
+                 compressed.size(), out.data(), out.size(), zformat),
+        qint64(size));
+    QCOMPARE(out.left(size), data);
+    if (size > 0) {
+        QCOMPARE(QuaZCompression::uncompress(compressed.constData(),
+                     compressed.size(), out.data(), size - 1, zformat),
+            qint64(-1));
+    }
+
+    QByteArray packed(int(QuaZCompression::compressBound(size, zformat, level)),
+        Qt::Uninitialized);
+    qint64 packedSize = QuaZCompression::compress(data.constData(), size,
+        packed.data(), packed.size(), zformat, level);
+    QCOMPARE(packedSize, qint64(compressed.size()));
+    QCOMPARE(QuaZCompression::compress(data.constData(), size, packed.data(),
+                 1, zformat, level),
+        qint64(-1));
+
+    // truncated data
+    ok = true;
+    QVERIFY(QuaZCompression::uncompress(compressed.left(compressed.size() - 1),
+        zformat, -1, &ok).isEmpty());
+    QVERIFY(!ok);
+
+    QVERIFY(!QuaZCompression::compress(data, zformat, 42, &ok).size());
+    QVERIFY(!ok);
+
+    QuaZCompression::releaseThreadStreams();
+    QCOMPARE(QuaZCompression::uncompress(compressed, zformat), data);
+}
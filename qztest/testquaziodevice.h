@@ -35,6 +35,20 @@ private slots:
     void readMany();
     void write_data();
     void write();
+    void readSequentialBounded();
+    void writeBuffered();
+    void flush_data();
+    void flush();
+    void autoFlush();
+    void dictionary();
+    void trainDictionary();
+    void windowBits_data();
+    void windowBits();
+    void allocator();
+    void adaptiveCompression();
+    void adaptiveBackpressure();
+    void memoryCompression_data();
+    void memoryCompression();
 
 private:
     void initData();
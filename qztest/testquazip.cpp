@@ -39,8 +39,17 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include <QtTest/QtTest>
 
+#include <random>
+
 #include <quazip/quazip.h>
 #include <quazip/JlCompress.h>
+#include <quazip/quazipbuilder.h>
+#include <quazip/quazipentrytable.h>
+#include <quazip/quazipentryview.h>
+#include <quazip/quazipextractor.h>
+#include <quazip/quazipnamefilter.h>
+
+Q_DECLARE_METATYPE(QuaZipNameFilter)
 
 void TestQuaZip::getFileList_data()
 {
@@ -98,6 +107,44 @@ void TestQuaZip::getFileList()
         QCOMPARE(static_cast<qint64>(destList64[i].uncompressedSize),
                 srcInfo[destList64[i].name].size());
     }
+    // and the entry table
+    QuaZipEntryTable table = testZip.getEntryTable();
+    QCOMPARE(table.count(), destList64.size());
+    for (int i = 0; i < table.count(); i++) {
+        const QuaZipFileInfo64 &info = destList64.at(i);
+        QCOMPARE(table.name(i), info.name);
+        QCOMPARE(table.rawName(i), info.name.toLocal8Bit());
+        QCOMPARE(table.isDir(i), info.name.endsWith('/'));
+        QCOMPARE(table.method(i), info.method);
+        QCOMPARE(table.flags(i), info.flags);
+        QCOMPARE(table.crc(i), info.crc);
+        QCOMPARE(table.compressedSize(i), info.compressedSize);
+        QCOMPARE(table.uncompressedSize(i), info.uncompressedSize);
+        QCOMPARE(table.externalAttr(i), info.externalAttr);
+        QCOMPARE(table.dateTime(i), info.dateTime);
+        QCOMPARE(table.extra(&testZip, i), info.extra);
+        QCOMPARE(table.comment(&testZip, i), info.comment);
+    }
+    // and the visitor
+    int visited = 0;
+    QVERIFY(testZip.forEachFile([&](const QuaZipEntryView &entry) {
+        const QuaZipFileInfo64 &info = destList64.at(visited);
+        if (entry.index() != visited || entry.name() != info.name
+                || entry.uncompressedSize() != info.uncompressedSize
+                || entry.crc() != info.crc
+                || entry.dateTime() != info.dateTime
+                || entry.extra() != info.extra) {
+            return false;
+        }
+        ++visited;
+        return true;
+    }));
+    QCOMPARE(visited, destList64.size());
+    visited = 0;
+    QVERIFY(testZip.forEachFile([&visited](const QuaZipEntryView &) {
+        return ++visited < 2;
+    }));
+    QCOMPARE(visited, qMin(2, destList64.size()));
     // test that we didn't mess up the current file
     QCOMPARE(testZip.getCurrentFileName(), firstFile);
     testZip.close();
@@ -439,3 +486,304 @@ void TestQuaZip::testSequential()
     receivedFile.close();
     receivedZip.close();
 }
+
+void TestQuaZip::inflateBuffer()
+{
+    QByteArray data;
+    for (int i = 0; i < 10000; ++i) {
+        data += QByteArray::number(i) + "\n";
+    }
+
+    QBuffer buffer;
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile zipFile(&zip);
+    QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("test.txt")));
+    QCOMPARE(zipFile.write(data), qint64(data.size()));
+    zipFile.close();
+    zip.close();
+
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QVERIFY(zip.goToFirstFile());
+    QuaZipFile rawFile(&zip);
+    int method = 0;
+    QVERIFY(rawFile.open(QIODevice::ReadOnly, &method, NULL, true));
+    QCOMPARE(method, int(Z_DEFLATED));
+    QByteArray compressed = rawFile.readAll();
+    rawFile.close();
+
+    QByteArray result(data.size(), Qt::Uninitialized);
+    uLong resultSize = 0;
+    QCOMPARE(unzInflateBuffer(zip.getUnzFile(), result.data(),
+                 uLong(result.size()), compressed.constData(),
+                 uLong(compressed.size()), &resultSize),
+        UNZ_OK);
+    QCOMPARE(resultSize, uLong(data.size()));
+    QCOMPARE(result, data);
+
+    // destination too small
+    QCOMPARE(unzInflateBuffer(zip.getUnzFile(), result.data(),
+                 uLong(result.size() - 1), compressed.constData(),
+                 uLong(compressed.size()), NULL),
+        int(Z_BUF_ERROR));
+
+    // truncated input, libdeflate reports it as bad data
+    QVERIFY(unzInflateBuffer(zip.getUnzFile(), result.data(),
+                uLong(result.size()), compressed.constData(),
+                uLong(compressed.size() / 2), NULL)
+        != UNZ_OK);
+
+    // invalid block type
+    QByteArray corrupted = compressed;
+    corrupted[0] = char(0x07);
+    QCOMPARE(unzInflateBuffer(zip.getUnzFile(), result.data(),
+                 uLong(result.size()), corrupted.constData(),
+                 uLong(corrupted.size()), NULL),
+        int(Z_DATA_ERROR));
+    zip.close();
+}
+
+void TestQuaZip::builder()
+{
+    QMap<QString, QByteArray> entries;
+    for (int i = 0; i < 50; ++i) {
+        QByteArray report;
+        for (int j = 0; j < 1000 * i; ++j) {
+            report += QByteArray::number(i * j % 97) + ";";
+        }
+        entries.insert(QString("reports/%1.csv").arg(i, 2, 10, QChar('0')), report);
+    }
+    // seeded, so that the same data is built on each run
+    std::mt19937 random(1);
+    QByteArray noise;
+    for (int i = 0; i < 10000; ++i) {
+        noise += char(random());
+    }
+    entries.insert("noise.bin", noise);
+    entries.insert("reports/", QByteArray());
+
+    QuaZipBuilder builder;
+    builder.setDateTime(QDateTime(QDate(2020, 5, 17), QTime(12, 30, 10)));
+    bool ok = false;
+    QByteArray archive = builder.build(entries, &ok);
+    QVERIFY(ok);
+
+    // the same bytes, with or without threads
+    builder.setThreadPool(NULL);
+    QCOMPARE(builder.build(entries), archive);
+
+    QBuffer buffer(&archive);
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QCOMPARE(zip.getEntriesCount(), entries.size());
+    QStringList names = zip.getFileNameList();
+    QCOMPARE(names, entries.keys());
+    for (bool more = zip.goToFirstFile(); more; more = zip.goToNextFile()) {
+        QuaZipFileInfo64 info;
+        QVERIFY(zip.getCurrentFileInfo(&info));
+        QCOMPARE(info.dateTime, builder.dateTime());
+        if (info.name == "noise.bin")
+            QCOMPARE(info.method, quint16(0));
+        else if (info.name == "reports/49.csv")
+            QCOMPARE(info.method, quint16(Z_DEFLATED));
+
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), entries.value(info.name));
+        file.close();
+        QCOMPARE(file.getZipError(), UNZ_OK);
+    }
+    zip.close();
+    QCOMPARE(zip.getZipError(), UNZ_OK);
+
+    // the name length does not fit the headers
+    QMap<QString, QByteArray> longName;
+    longName.insert(QString(0x10000, QChar('a')), QByteArray("data"));
+    QTest::ignoreMessage(QtWarningMsg, "QuaZipBuilder::build(): entry name is too long");
+    QVERIFY(builder.build(longName, &ok).isEmpty());
+    QVERIFY(!ok);
+}
+
+void TestQuaZip::nameFilter_data()
+{
+    QTest::addColumn<QuaZipNameFilter>("filter");
+    QTest::addColumn<QStringList>("expected");
+    QTest::newRow("all") << QuaZipNameFilter()
+        << (QStringList() << "data/" << "data/a.json" << "data/sub/B.JSON"
+            << "data/c.txt" << "other/d.json" << QString::fromUtf8("data/\xc3\xa9t\xc3\xa9.json"));
+    QTest::newRow("prefix") << QuaZipNameFilter::prefix("other/")
+        << (QStringList() << "other/d.json");
+    QTest::newRow("prefix and wildcard")
+        << (QuaZipNameFilter::prefix("data/")
+            & QuaZipNameFilter::wildcard("*.json"))
+        << (QStringList() << "data/a.json" << QString::fromUtf8("data/\xc3\xa9t\xc3\xa9.json"));
+    QTest::newRow("case insensitive")
+        << QuaZipNameFilter::wildcard("*.json", Qt::CaseInsensitive)
+        << (QStringList() << "data/a.json" << "data/sub/B.JSON"
+            << "other/d.json" << QString::fromUtf8("data/\xc3\xa9t\xc3\xa9.json"));
+    QTest::newRow("question mark")
+        << QuaZipNameFilter::wildcard(QString::fromUtf8("data/?t?.json"))
+        << (QStringList() << QString::fromUtf8("data/\xc3\xa9t\xc3\xa9.json"));
+    QTest::newRow("character set")
+        << QuaZipNameFilter::wildcard("*/[a-c].*")
+        << (QStringList() << "data/a.json" << "data/c.txt");
+    QTest::newRow("regular expression")
+        << QuaZipNameFilter::regularExpression(
+            QRegularExpression("^data/[^/]+\\.txt$"))
+        << (QStringList() << "data/c.txt");
+    QTest::newRow("none") << QuaZipNameFilter::prefix("missing/")
+        << QStringList();
+}
+
+void TestQuaZip::nameFilter()
+{
+    QFETCH(QuaZipNameFilter, filter);
+    QFETCH(QStringList, expected);
+    QStringList fileNames;
+    fileNames << "data/" << "data/a.json" << "data/sub/B.JSON" << "data/c.txt"
+              << "other/d.json" << QString::fromUtf8("data/\xc3\xa9t\xc3\xa9.json");
+    QString zipName = "nameFilter.zip";
+    QDir curDir;
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames, QTextCodec::codecForName("UTF-8"))) {
+        QFAIL("Couldn't create test archive");
+    }
+    removeTestFiles(fileNames);
+    QuaZip zip(zipName);
+    zip.setFileNameCodec("UTF-8");
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QStringList visited;
+    QVERIFY(zip.forEachFile(filter, [&visited](const QuaZipEntryView &entry) {
+        visited << entry.name();
+        return true;
+    }));
+    QCOMPARE(visited, expected);
+    QuaZipEntryTable table = zip.getEntryTable();
+    QStringList matching;
+    foreach (int index, table.matching(filter)) {
+        matching << table.name(index);
+    }
+    QCOMPARE(matching, expected);
+    QStringList decoded;
+    foreach (QString name, fileNames) {
+        if (filter.matches(name))
+            decoded << name;
+    }
+    QCOMPARE(decoded, expected);
+    zip.close();
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::filePos()
+{
+    QStringList fileNames;
+    fileNames << "first.txt" << "second.txt" << "third.txt";
+    QString zipName = "filePos.zip";
+    QDir curDir;
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Couldn't create test archive");
+    }
+    removeTestFiles(fileNames);
+    QuaZip zip(zipName);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QList<unz64_file_pos> positions;
+    QList<quint64> headers;
+    QVERIFY(zip.forEachFile([&](const QuaZipEntryView &entry) {
+        positions << entry.filePos();
+        headers << entry.headerPos();
+        return true;
+    }));
+    QCOMPARE(positions.size(), fileNames.size());
+    QCOMPARE(headers.first(), quint64(0));
+    QVERIFY(headers.at(1) > headers.at(0));
+    QVERIFY(headers.at(2) > headers.at(1));
+    for (int i = fileNames.size() - 1; i >= 0; --i) {
+        QVERIFY(zip.goToFilePos(positions.at(i)));
+        QCOMPARE(zip.getCurrentFileName(), fileNames.at(i));
+        unz64_file_pos pos;
+        QVERIFY(zip.getCurrentFilePos(&pos));
+        QCOMPARE(pos.pos_in_zip_directory, positions.at(i).pos_in_zip_directory);
+        QCOMPARE(pos.num_of_file, positions.at(i).num_of_file);
+    }
+    zip.close();
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::extractor()
+{
+    QMap<QString, QByteArray> entries;
+    QByteArray text;
+    for (int i = 0; i < 100000; ++i) {
+        text += QByteArray::number(i % 1013) + "\n";
+    }
+    entries.insert("big.txt", text);
+    std::mt19937 random(1);
+    QByteArray noise;
+    for (int i = 0; i < 300000; ++i) {
+        noise += char(random());
+    }
+    entries.insert("data/noise.bin", noise);
+    entries.insert("data/empty.txt", QByteArray());
+    entries.insert("data/sub/", QByteArray());
+    QuaZipBuilder builder;
+    builder.setDateTime(QDateTime(QDate(2021, 3, 4), QTime(5, 6, 8)));
+    QByteArray archive = builder.build(entries);
+    QVERIFY(!archive.isEmpty());
+
+    QDir dir("extractor");
+    quint64 bigDataPos = 0;
+    {
+        QBuffer buffer(&archive);
+        QuaZip zip(&buffer);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QuaZipExtractor extractor(&zip);
+        // smaller than the entries, so that the stages wait for each other
+        extractor.setBufferSize(64 * 1024);
+        QVERIFY(zip.forEachFile([&](const QuaZipEntryView &entry) {
+            if (entry.name() == "big.txt")
+                bigDataPos = entry.headerPos() + 30 + entry.rawName().size();
+            extractor.addFile(entry.filePos(), dir.absoluteFilePath(entry.name()));
+            return true;
+        }));
+        QCOMPARE(extractor.count(), entries.size());
+        QVERIFY(extractor.extract());
+        zip.close();
+    }
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        if (it.key().endsWith('/')) {
+            QVERIFY(QFileInfo(dir.filePath(it.key())).isDir());
+            continue;
+        }
+        QFile file(dir.filePath(it.key()));
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QCOMPARE(file.readAll(), it.value());
+#if defined(Q_OS_LINUX) || QT_VERSION >= 0x050A00
+        QCOMPARE(QFileInfo(file).lastModified(), builder.dateTime());
+#endif
+    }
+    QVERIFY(dir.removeRecursively());
+
+    // a corrupted entry fails the whole extraction
+    QVERIFY(bigDataPos > 0);
+    archive[int(bigDataPos) + 100] = char(archive.at(int(bigDataPos) + 100) ^ 0x55);
+    {
+        QBuffer buffer(&archive);
+        QuaZip zip(&buffer);
+        QVERIFY(zip.open(QuaZip::mdUnzip));
+        QuaZipExtractor extractor(&zip);
+        QVERIFY(zip.forEachFile([&](const QuaZipEntryView &entry) {
+            extractor.addFile(entry.filePos(), dir.absoluteFilePath(entry.name()));
+            return true;
+        }));
+        QVERIFY(!extractor.extract());
+        zip.close();
+    }
+    QVERIFY(!QFileInfo::exists(dir.filePath("big.txt")));
+    QVERIFY(!QFileInfo::exists(dir.filePath("data/noise.bin")));
+    dir.removeRecursively();
+}
@@ -50,6 +50,12 @@ private slots:
     void saveFileBug();
 #endif
     void testSequential();
+    void inflateBuffer();
+    void builder();
+    void nameFilter_data();
+    void nameFilter();
+    void filePos();
+    void extractor();
 };
 
 #endif // QUAZIP_TEST_QUAZIP_H
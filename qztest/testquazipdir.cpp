@@ -24,9 +24,11 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "testquazipdir.h"
 #include "qztest.h"
+#include <QTextCodec>
 #include <QtTest/QtTest>
 #include <quazip/quazip.h>
 #include <quazip/quazipdir.h>
+#include <quazip/quazipfile.h>
 
 void TestQuaZipDir::entryList_data()
 {
@@ -346,3 +348,90 @@ void TestQuaZipDir::filePath()
     zip.close();
     curDir.remove(zipName);
 }
+
+void TestQuaZipDir::dirIndex()
+{
+    QString zipName = "dirIndex.zip";
+    QStringList fileNames;
+    fileNames << "root.txt" << "a/b/c/deep.txt" << "a/b/file.txt"
+              << "a/b/c/deeper/last.txt" << "a/other.txt" << "a/b/empty/";
+    if (!createTestFiles(fileNames, 100)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Couldn't create test archive");
+    }
+    removeTestFiles(fileNames);
+    QuaZip zip(zipName);
+    QDir curDir;
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QVERIFY(zip.setCurrentFile("a/other.txt"));
+    QuaZipDir dir(&zip);
+    QVERIFY(dir.exists("a/b/c/deeper"));
+    QVERIFY(dir.exists("a/b/c/deep.txt"));
+    QVERIFY(!dir.exists("a/b/c/missing.txt"));
+    QVERIFY(!dir.cd("a/missing"));
+    QVERIFY(dir.cd("a/b"));
+    QCOMPARE(dir.count(), 3u);
+    QCOMPARE(dir.entryList(QDir::NoFilter, QDir::Unsorted),
+             QStringList() << "c/" << "file.txt" << "empty/");
+    QCOMPARE(dir[1], QString::fromLatin1("file.txt"));
+    QList<QuaZipFileInfo64> infos = dir.entryInfoList64(
+            QStringList() << "file*", QDir::Files);
+    QCOMPARE(infos.size(), 1);
+    QCOMPARE(infos.at(0).name, QString::fromLatin1("file.txt"));
+    QCOMPARE(infos.at(0).uncompressedSize, static_cast<quint64>(100));
+    // the listing kept for count() follows the settings
+    dir.setFilter(QDir::Files);
+    QCOMPARE(dir.count(), 1u);
+    QCOMPARE(dir[0], QString::fromLatin1("file.txt"));
+    dir.setFilter(QDir::NoFilter);
+    dir.setSorting(QDir::Name | QDir::Reversed);
+    QCOMPARE(dir[0], QString::fromLatin1("file.txt"));
+    QCOMPARE(dir[2], QString::fromLatin1("c/"));
+    dir.setSorting(QDir::NoSort);
+    QVERIFY(dir.cd("c"));
+    QCOMPARE(dir.count(), 2u);
+    QCOMPARE(dir.entryList(QDir::Dirs), QStringList() << "deeper/");
+    // listing does not move the current file
+    QCOMPARE(zip.getCurrentFileName(), QString::fromLatin1("a/other.txt"));
+    zip.close();
+    curDir.remove(zipName);
+    // the listing kept for count() follows the file name codec
+    QStringList russianNames;
+    russianNames << QString::fromUtf8("тест.txt");
+    if (!createTestFiles(russianNames)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!createTestArchive(zipName, russianNames,
+                           QTextCodec::codecForName("IBM866"))) {
+        QFAIL("Couldn't create test archive");
+    }
+    removeTestFiles(russianNames);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QuaZipDir root(&zip);
+    QCOMPARE(root.count(), 1u);
+    QVERIFY(root[0] != russianNames[0]);
+    zip.setFileNameCodec("IBM866");
+    QCOMPARE(root[0], russianNames[0]);
+    zip.close();
+    curDir.remove(zipName);
+    // entries with the same name each report their own info
+    QuaZip dupZip(zipName);
+    QVERIFY(dupZip.open(QuaZip::mdCreate));
+    for (int size = 1; size <= 2; ++size) {
+        QuaZipFile dupFile(&dupZip);
+        QVERIFY(dupFile.open(QIODevice::WriteOnly, QuaZipNewInfo("dup.txt")));
+        dupFile.write(QByteArray(size, 'x'));
+        dupFile.close();
+    }
+    dupZip.close();
+    QVERIFY(dupZip.open(QuaZip::mdUnzip));
+    QuaZipDir dupDir(&dupZip);
+    infos = dupDir.entryInfoList64(QDir::Files, QDir::Unsorted);
+    QCOMPARE(infos.size(), 2);
+    QCOMPARE(infos.at(0).uncompressedSize, static_cast<quint64>(1));
+    QCOMPARE(infos.at(1).uncompressedSize, static_cast<quint64>(2));
+    dupZip.close();
+    curDir.remove(zipName);
+}
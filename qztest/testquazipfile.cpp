@@ -27,8 +27,10 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "qztest.h"
 
 #include <quazip/JlCompress.h>
+#include <quazip/quaziodevice.h>
 #include <quazip/quazipfile.h>
 #include <quazip/quazip.h>
+#include <quazip/zipcodec.h>
 
 #include <QFile>
 #include <QString>
@@ -461,3 +463,482 @@ void TestQuaZipFile::largeFile()
     fakeLargeZip.close();
     curDir.remove("tmp/large.zip");
 }
+
+void TestQuaZipFile::writeBuffered()
+{
+    QString zipName = "writeBuffered.zip";
+    QByteArray expected;
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        QCOMPARE(zipFile.getWriteBufferThreshold(), 0);
+        zipFile.setWriteBufferThreshold(4096);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly,
+                             QuaZipNewInfo("buffered.txt")));
+        for (int i = 0; i < 1000; ++i) {
+            QByteArray message = QByteArray::number(i) + ": message\n";
+            QCOMPARE(zipFile.write(message), qint64(message.size()));
+            expected += message;
+        }
+        QByteArrayList fragments;
+        fragments << "small " << QByteArray(10000, 'x') << " tail\n";
+        QCOMPARE(zipFile.writeFragments(fragments), qint64(10012));
+        expected += fragments.join();
+        QCOMPARE(zipFile.size(), qint64(expected.size()));
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        testZip.close();
+    }
+    QuaZipFile readFile(zipName, "buffered.txt");
+    QVERIFY(readFile.open(QIODevice::ReadOnly));
+    QCOMPARE(readFile.readAll(), expected);
+    readFile.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::lowMemory()
+{
+    QString zipName = "lowMemory.zip";
+    QByteArray data;
+    for (int i = 0; i < 10000; ++i) {
+        data += QByteArray::number(i * 7 % 1000) + ",";
+    }
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        QCOMPARE(zipFile.memoryUsage(), qint64(0));
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("default.txt")));
+        qint64 defaultUsage = zipFile.memoryUsage();
+        QVERIFY(zipFile.write(data) == data.size());
+        zipFile.close();
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("low.txt"),
+            NULL, 0, Z_DEFLATED, Z_DEFAULT_COMPRESSION, false,
+            QuaZIODevice::LOW_MEMORY_WINDOW_BITS,
+            QuaZIODevice::LOW_MEMORY_MEM_LEVEL));
+        QVERIFY(zipFile.memoryUsage() < defaultUsage);
+        QVERIFY(zipFile.write(data) == data.size());
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        testZip.close();
+    }
+    QuaZipFile readFile(zipName, "low.txt");
+    QVERIFY(readFile.open(QIODevice::ReadOnly));
+    QVERIFY(readFile.memoryUsage() > 0);
+    QCOMPARE(readFile.readAll(), data);
+    readFile.close();
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::allocator()
+{
+    QString zipName = "allocator.zip";
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i) {
+        data += QByteArray::number(i) + ",";
+    }
+    CountingAllocator allocator;
+    {
+        QuaZip testZip(zipName);
+        testZip.setAllocator(&allocator);
+        QVERIFY(testZip.getAllocator() == &allocator);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("test.txt")));
+        QVERIFY(zipFile.write(data) == data.size());
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    QVERIFY(allocator.allocations > 0);
+    QCOMPARE(allocator.deallocations, allocator.allocations);
+
+    int writeAllocations = allocator.allocations;
+    {
+        QuaZip testZip(zipName);
+        testZip.setAllocator(&allocator);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QVERIFY(testZip.setCurrentFile("test.txt"));
+        QuaZipFile zipFile(&testZip);
+        QVERIFY(zipFile.open(QIODevice::ReadOnly));
+        QCOMPARE(zipFile.readAll(), data);
+        zipFile.close();
+        testZip.close();
+    }
+    QVERIFY(allocator.allocations > writeAllocations);
+    QCOMPARE(allocator.deallocations, allocator.allocations);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::autoStore_data()
+{
+    QByteArray text;
+    for (int i = 0; i < 10000; ++i) {
+        text += QByteArray::number(i * 7 % 1000) + ",";
+    }
+    QByteArray random;
+    quint32 seed = 12345;
+    for (int i = 0; i < 100000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        random += char(seed >> 24);
+    }
+
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<int>("decision");
+    QTest::newRow("text") << "text.txt" << text
+        << int(QuaZCompressibility::Compress);
+    QTest::newRow("extension") << "photo.JPG" << text
+        << int(QuaZCompressibility::StoreByExtension);
+    QTest::newRow("magic") << "image.bin"
+        << QByteArray("\x89PNG\r\n\x1A\n") + text
+        << int(QuaZCompressibility::StoreByMagic);
+    QTest::newRow("random") << "random.bin" << random
+        << int(QuaZCompressibility::StoreBySample);
+    QTest::newRow("short random") << "short.bin" << random.left(1000)
+        << int(QuaZCompressibility::StoreBySample);
+    QTest::newRow("empty") << "empty.bin" << QByteArray()
+        << int(QuaZCompressibility::Compress);
+}
+
+void TestQuaZipFile::autoStore()
+{
+    QFETCH(QString, fileName);
+    QFETCH(QByteArray, data);
+    QFETCH(int, decision);
+    QString zipName = "autoStore.zip";
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        QVERIFY(!zipFile.isAutoStoreEnabled());
+        zipFile.setAutoStoreEnabled(true);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo(fileName)));
+        for (int pos = 0; pos < data.size(); pos += 1000) {
+            QByteArray chunk = data.mid(pos, 1000);
+            QCOMPARE(zipFile.write(chunk), qint64(chunk.size()));
+        }
+        QCOMPARE(zipFile.pos(), qint64(data.size()));
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        QCOMPARE(int(zipFile.getStoreDecision()), decision);
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    QuaZipFile readFile(zipName, fileName);
+    int method = -1;
+    QVERIFY(readFile.open(QIODevice::ReadOnly, &method, NULL, false));
+    QCOMPARE(method,
+        decision == QuaZCompressibility::Compress ? Z_DEFLATED : 0);
+    QCOMPARE(readFile.readAll(), data);
+    readFile.close();
+    QDir().remove(zipName);
+}
+
+namespace {
+// Codec that stores bytes inverted, to test the codec registry
+const int INVERT_METHOD = 200;
+
+int invertInit(voidpf *state, int, const zlib_allocfunc_def *)
+{
+    *state = NULL;
+    return Z_OK;
+}
+
+int invertDecompressInit(voidpf *state, const zlib_allocfunc_def *)
+{
+    *state = NULL;
+    return Z_OK;
+}
+
+int invertDecompress(voidpf, z_stream *stream)
+{
+    uInt count = qMin(stream->avail_in, stream->avail_out);
+    if (count == 0)
+        return Z_BUF_ERROR;
+    for (uInt i = 0; i < count; ++i) {
+        stream->next_out[i] = Bytef(~stream->next_in[i]);
+    }
+    stream->next_in += count;
+    stream->avail_in -= count;
+    stream->total_in += count;
+    stream->next_out += count;
+    stream->avail_out -= count;
+    stream->total_out += count;
+    return Z_OK;
+}
+
+int invertCompress(voidpf state, z_stream *stream, int flush)
+{
+    if (stream->avail_in == 0)
+        return flush == Z_FINISH ? Z_STREAM_END : Z_OK;
+    int result = invertDecompress(state, stream);
+    return result == Z_BUF_ERROR ? Z_OK : result;
+}
+
+void invertEnd(voidpf)
+{
+}
+
+const zip_codec invertCodec = {INVERT_METHOD, 20, invertInit, invertCompress,
+    invertEnd, invertDecompressInit, invertDecompress, invertEnd};
+
+bool writeAndRead(int method, const QByteArray &data, int *readMethod,
+    QByteArray *compressed)
+{
+    QString zipName = "codec.zip";
+    {
+        QuaZip testZip(zipName);
+        if (!testZip.open(QuaZip::mdCreate))
+            return false;
+        QuaZipFile zipFile(&testZip);
+        if (!zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("test.txt"),
+                NULL, 0, method, Z_DEFAULT_COMPRESSION)) {
+            return false;
+        }
+        if (zipFile.write(data) != data.size())
+            return false;
+        zipFile.close();
+        testZip.close();
+        if (zipFile.getZipError() != ZIP_OK || testZip.getZipError() != ZIP_OK)
+            return false;
+    }
+    QuaZip testZip(zipName);
+    if (!testZip.open(QuaZip::mdUnzip) || !testZip.goToFirstFile())
+        return false;
+    QuaZipFile rawFile(&testZip);
+    if (!rawFile.open(QIODevice::ReadOnly, readMethod, NULL, true))
+        return false;
+    *compressed = rawFile.readAll();
+    rawFile.close();
+    QuaZipFile readFile(&testZip);
+    if (!readFile.open(QIODevice::ReadOnly))
+        return false;
+    QByteArray result = readFile.readAll();
+    readFile.close();
+    testZip.close();
+    QDir().remove(zipName);
+    return readFile.getZipError() == UNZ_OK && result == data;
+}
+} // namespace
+
+void TestQuaZipFile::codec()
+{
+    QByteArray data;
+    for (int i = 0; i < 100000; ++i) {
+        data += char('a' + i % 26);
+    }
+
+    QVERIFY(zipFindCodec(INVERT_METHOD) == NULL);
+    QCOMPARE(zipRegisterCodec(&invertCodec), ZIP_OK);
+    QVERIFY(zipFindCodec(INVERT_METHOD) == &invertCodec);
+    QCOMPARE(zipRegisterCodec(NULL), ZIP_PARAMERROR);
+
+    int method = -1;
+    QByteArray compressed;
+    bool ok = writeAndRead(INVERT_METHOD, data, &method, &compressed);
+    QCOMPARE(zipUnregisterCodec(INVERT_METHOD), ZIP_OK);
+    QVERIFY(ok);
+    QCOMPARE(method, INVERT_METHOD);
+    QCOMPARE(compressed.size(), data.size());
+    QCOMPARE(quint8(compressed.at(0)), quint8(~'a'));
+
+    // an unknown method can not be written anymore
+    QVERIFY(zipFindCodec(INVERT_METHOD) == NULL);
+    QCOMPARE(zipUnregisterCodec(INVERT_METHOD), ZIP_PARAMERROR);
+    QVERIFY(!writeAndRead(INVERT_METHOD, data, &method, &compressed));
+    QDir().remove("codec.zip");
+}
+
+void TestQuaZipFile::zstd()
+{
+    if (zipFindCodec(Z_ZSTD) == NULL)
+        QSKIP("Built without zstd");
+
+    QByteArray data;
+    for (int i = 0; i < 100000; ++i) {
+        data += QByteArray::number(i * 7 % 1000) + ",";
+    }
+    int method = -1;
+    QByteArray compressed;
+    QVERIFY(writeAndRead(Z_ZSTD, data, &method, &compressed));
+    QCOMPARE(method, int(Z_ZSTD));
+    QVERIFY(compressed.size() < data.size() / 2);
+    // zstd frame magic number
+    QVERIFY(compressed.startsWith("\x28\xB5\x2F\xFD"));
+}
+
+void TestQuaZipFile::readAtOnce_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<QByteArray>("password");
+    QTest::addColumn<int>("size");
+    QTest::newRow("deflated") << int(Z_DEFLATED) << QByteArray() << 100000;
+    QTest::newRow("stored") << 0 << QByteArray() << 100000;
+    QTest::newRow("empty") << int(Z_DEFLATED) << QByteArray() << 0;
+    QTest::newRow("encrypted") << int(Z_DEFLATED) << QByteArray("secret")
+                               << 100000;
+}
+
+void TestQuaZipFile::readAtOnce()
+{
+    QFETCH(int, method);
+    QFETCH(QByteArray, password);
+    QFETCH(int, size);
+    const char *pass = password.isEmpty() ? NULL : password.constData();
+
+    QByteArray data;
+    for (int i = 0; data.size() < size; ++i) {
+        data += QByteArray::number(i * 31 % 977) + " ";
+    }
+    data.truncate(size);
+
+    QBuffer buffer;
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile zipFile(&zip);
+    QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("test.txt"), pass,
+        0, method));
+    QCOMPARE(zipFile.write(data), qint64(data.size()));
+    zipFile.close();
+    zip.close();
+
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QVERIFY(zip.goToFirstFile());
+    QByteArray result = zip.readCurrentFile(pass);
+    QCOMPARE(zip.getZipError(), UNZ_OK);
+    QCOMPARE(result, data);
+
+    QuaZipFile readFile(&zip);
+    QCOMPARE(readFile.readAtOnce(pass), data);
+    QCOMPARE(readFile.getZipError(), UNZ_OK);
+    QVERIFY(readFile.open(QIODevice::ReadOnly, pass));
+    QVERIFY(readFile.readAtOnce(pass).isEmpty());
+    readFile.close();
+    zip.close();
+
+    if (size == 0 || pass != NULL)
+        return;
+
+    // damage the first byte of the data after the local header
+    QByteArray archive = buffer.data();
+    int dataStart = 30 + quint8(archive.at(26)) + (quint8(archive.at(27)) << 8)
+        + quint8(archive.at(28)) + (quint8(archive.at(29)) << 8);
+    archive[dataStart] = char(archive.at(dataStart) ^ 0x01);
+    QBuffer damagedBuffer(&archive);
+    QuaZip damagedZip(&damagedBuffer);
+    QVERIFY(damagedZip.open(QuaZip::mdUnzip));
+    QVERIFY(damagedZip.goToFirstFile());
+    QVERIFY(damagedZip.readCurrentFile().isEmpty());
+    QVERIFY(damagedZip.getZipError() != UNZ_OK);
+    if (method == 0)
+        QCOMPARE(damagedZip.getZipError(), UNZ_CRCERROR);
+    damagedZip.close();
+}
+
+void TestQuaZipFile::largeReads_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::addColumn<bool>("raw");
+    QTest::addColumn<QByteArray>("password");
+    QTest::newRow("stored") << 0 << false << QByteArray();
+    QTest::newRow("stored encrypted") << 0 << false << QByteArray("secret");
+    QTest::newRow("raw") << int(Z_DEFLATED) << true << QByteArray();
+}
+
+void TestQuaZipFile::largeReads()
+{
+    QFETCH(int, method);
+    QFETCH(bool, raw);
+    QFETCH(QByteArray, password);
+    const char *pass = password.isEmpty() ? NULL : password.constData();
+
+    QByteArray data;
+    for (int i = 0; data.size() < 300000; ++i) {
+        data += QByteArray::number(i) + ",";
+    }
+
+    QBuffer buffer;
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile zipFile(&zip);
+    QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("test.txt"), pass,
+        0, method));
+    QCOMPARE(zipFile.write(data), qint64(data.size()));
+    zipFile.close();
+    zip.close();
+
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QVERIFY(zip.goToFirstFile());
+    QByteArray expected = data;
+    if (raw) {
+        QuaZipFile rawFile(&zip);
+        int rawMethod = 0;
+        QVERIFY(rawFile.open(QIODevice::ReadOnly, &rawMethod, NULL, true));
+        expected = rawFile.readAll();
+        rawFile.close();
+    }
+
+    // small reads go through the read buffer, large ones around it
+    QuaZipFile readFile(&zip);
+    int readMethod = 0;
+    QVERIFY(readFile.open(QIODevice::ReadOnly, &readMethod, NULL, raw, pass));
+    QByteArray result = readFile.read(100);
+    result += readFile.read(200000);
+    result += readFile.read(7);
+    result += readFile.readAll();
+    readFile.close();
+    QCOMPARE(readFile.getZipError(), UNZ_OK);
+    QCOMPARE(result.size(), expected.size());
+    QVERIFY(result == expected);
+    zip.close();
+}
+
+void TestQuaZipFile::unbuffered()
+{
+    QByteArray data;
+    for (int i = 0; data.size() < 100000; ++i) {
+        data += QByteArray::number(i) + "\n";
+    }
+
+    QBuffer buffer;
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QuaZipFile zipFile(&zip);
+    QVERIFY(zipFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered,
+        QuaZipNewInfo("test.txt")));
+    QCOMPARE(zipFile.write(data), qint64(data.size()));
+    zipFile.close();
+    QCOMPARE(zipFile.getZipError(), ZIP_OK);
+    zip.close();
+
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QVERIFY(zip.goToFirstFile());
+    QuaZipFile readFile(&zip);
+    QVERIFY(readFile.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+    QVERIFY(readFile.openMode() & QIODevice::Unbuffered);
+    QCOMPARE(readFile.bytesAvailable(), qint64(data.size()));
+    QVERIFY(!readFile.atEnd());
+
+    char c = 0;
+    QVERIFY(readFile.getChar(&c));
+    QCOMPARE(c, data.at(0));
+    QCOMPARE(readFile.bytesAvailable(), qint64(data.size() - 1));
+
+    QByteArray result(1);
+    result[0] = c;
+    while (!readFile.atEnd()) {
+        QByteArray block = readFile.read(30000);
+        QVERIFY(!block.isEmpty());
+        result += block;
+        QCOMPARE(readFile.bytesAvailable(), qint64(data.size() - result.size()));
+    }
+    QCOMPARE(readFile.getZipError(), UNZ_OK);
+    readFile.close();
+    QCOMPARE(readFile.getZipError(), UNZ_OK);
+    QVERIFY(result == data);
+    QCOMPARE(readFile.bytesAvailable(), qint64(0));
+    zip.close();
+}
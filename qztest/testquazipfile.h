@@ -42,6 +42,18 @@ private slots:
     void constructorDestructor();
     void setFileAttrs();
     void largeFile();
+    void writeBuffered();
+    void lowMemory();
+    void allocator();
+    void autoStore_data();
+    void autoStore();
+    void codec();
+    void zstd();
+    void readAtOnce_data();
+    void readAtOnce();
+    void largeReads_data();
+    void largeReads();
+    void unbuffered();
 };
 
 #endif // QUAZIP_TEST_QUAZIPFILE_H